@@ -0,0 +1,273 @@
+/*
+	Name: compressed_stream.c
+	Description: Host encoder of the µCNC compressed stream (ENABLE_STREAM_COMPRESSION) and round trip test.
+		The encoder is a greedy LZ77 with the µCNC decoder format (see config.h). Each line is encoded when it's complete (so a send and wait or character counting sender is never delayed) and can reference the last 255 chars sent.
+		As a filter (-e) the input is passed unchanged until a $Z line and then encoded. The realtime commands are sent as soon as they are read and a reset (ctrl-x) returns to the ASCII G-code.
+			The sender can keep counting the uncompressed chars since the µCNC RX buffer holds the decoded lines.
+		As a test the file is encoded and sent to the µCNC RX ISR and each decoded line is compared with the original line.
+		The encoded size gives the serial throughput gain at the same baud rate (when the stream is limited by the serial link).
+		The match length is limited to STREAM_COMPRESSION_MAX_MATCH (config.h) like the µCNC decoder (the lines with a longer match are discarded by the µCNC).
+
+	Build and run from this folder (add -DENCODER_MAX_MATCH=<length> to test another match length limit)
+		gcc -O2 -std=gnu99 -I../../uCNC -DBOARD=BOARD_VIRTUAL -D__SIMUL__ -DFORCE_SOFT_POLLING -DENABLE_STREAM_COMPRESSION compressed_stream.c ../../uCNC/[a-z]*.c -lm -o compressed_stream
+		./compressed_stream [file]
+		sender | ./compressed_stream -e > serial port
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "mcudefs.h"
+#include "mcu.h"
+#include "settings.h"
+#include "serial.h"
+#include "grbl_interface.h"
+#include "cnc.h"
+
+#define ENCODER_WINDOW 255
+#ifndef ENCODER_MAX_MATCH
+#define ENCODER_MAX_MATCH STREAM_COMPRESSION_MAX_MATCH
+#endif
+#define ENCODER_MIN_MATCH 3
+#define ENCODER_LINE_SIZE 1024
+
+//simulated MCU (the responses are discarded)
+VIRTUAL_MAP virtualmap;
+virtports_t virtualports = &virtualmap;
+static uint8_t eeprom[4096];
+
+void mcu_init(void) {}
+void mcu_enable_probe_isr(void) {}
+void mcu_disable_probe_isr(void) {}
+uint8_t mcu_get_analog(uint8_t channel) { return 0; }
+void mcu_set_pwm(uint8_t pwm, uint8_t value) {}
+uint8_t mcu_get_pwm(uint8_t pwm) { return 0; }
+void mcu_start_send(void)
+{
+    for (uint16_t i = 0; i < TX_BUFFER_SIZE; i++)
+    {
+        serial_tx_isr();
+    }
+}
+void mcu_stop_send(void) {}
+void mcu_putc(char c) {}
+char mcu_getc(void) { return 0; }
+void mcu_enable_interrupts(void) {}
+void mcu_disable_interrupts(void) {}
+void mcu_freq_to_clocks(float frequency, uint16_t *ticks, uint16_t *tick_reps)
+{
+    *ticks = (uint16_t)(1000000.0f / frequency);
+    *tick_reps = 1;
+}
+void mcu_start_step_ISR(uint16_t ticks, uint16_t tick_reps) {}
+void mcu_change_step_ISR(uint16_t ticks, uint16_t tick_reps) {}
+void mcu_step_stop_ISR(void) {}
+void mcu_delay_ms(uint16_t ms) {}
+uint8_t mcu_eeprom_getc(uint16_t address) { return eeprom[address & 4095]; }
+void mcu_eeprom_putc(uint16_t address, uint8_t value) { eeprom[address & 4095] = value; }
+void mcu_eeprom_erase(uint16_t address) {}
+
+//encoder (the last 255 chars sent followed by the line being encoded)
+static unsigned char encoder_data[ENCODER_WINDOW + ENCODER_LINE_SIZE];
+static int encoder_history;
+
+static void encoder_reset(void)
+{
+    encoder_history = 0;
+}
+
+//encodes the chars and returns the encoded size
+static int encoder_encode(const unsigned char *in, int len, unsigned char *out)
+{
+    int end = encoder_history + len;
+    int size = 0;
+    int i = encoder_history;
+
+    memcpy(&encoder_data[encoder_history], in, len);
+    while (i < end)
+    {
+        int best = 0;
+        int distance = 0;
+        //the match can overlap the chars being copied (the decoder copies char by char)
+        for (int d = 1; d <= ENCODER_WINDOW && d <= i; d++)
+        {
+            int l = 0;
+            while ((i + l) < end && l < ENCODER_MAX_MATCH && encoder_data[i + l - d] == encoder_data[i + l])
+            {
+                l++;
+            }
+
+            if (l > best)
+            {
+                best = l;
+                distance = d;
+            }
+        }
+
+        if (best >= ENCODER_MIN_MATCH)
+        {
+            out[size++] = 0x80 | best;
+            out[size++] = distance;
+            i += best;
+        }
+        else
+        {
+            //chars above 0x7F are escaped
+            if (encoder_data[i] & 0x80)
+            {
+                out[size++] = 0x80;
+            }
+            out[size++] = encoder_data[i++];
+        }
+    }
+
+    //keeps the last 255 chars
+    int keep = (end < ENCODER_WINDOW) ? end : ENCODER_WINDOW;
+    memmove(encoder_data, &encoder_data[end - keep], keep);
+    encoder_history = keep;
+    return size;
+}
+
+static int is_realtime(int c)
+{
+    return (c == CMD_CODE_RESET || c == CMD_CODE_FEED_HOLD || c == CMD_CODE_REPORT || c >= '~');
+}
+
+//encodes the input from the sender to the serial port
+static int encode_filter(void)
+{
+    unsigned char line[ENCODER_LINE_SIZE];
+    unsigned char out[2 * ENCODER_LINE_SIZE];
+    int len = 0;
+    int compressed = 0;
+    int c;
+
+    while ((c = getchar()) != EOF)
+    {
+        if (is_realtime(c))
+        {
+            //the realtime commands are not delayed until the end of the line
+            if (!compressed)
+            {
+                putchar(c);
+            }
+            else
+            {
+                unsigned char rt = (unsigned char)c;
+                fwrite(out, 1, encoder_encode(&rt, 1, out), stdout);
+            }
+
+            if (c == CMD_CODE_RESET)
+            {
+                compressed = 0;
+            }
+            fflush(stdout);
+            continue;
+        }
+
+        line[len++] = (unsigned char)c;
+        if (c != '\n' && c != '\r' && len < ENCODER_LINE_SIZE)
+        {
+            continue;
+        }
+
+        if (!compressed)
+        {
+            fwrite(line, 1, len, stdout);
+            //the next char after the $Z line is compressed
+            if (len >= 3 && line[0] == '$' && line[1] == 'Z' && (line[2] == '\n' || line[2] == '\r'))
+            {
+                compressed = 1;
+                encoder_reset();
+            }
+        }
+        else
+        {
+            fwrite(out, 1, encoder_encode(line, len, out), stdout);
+        }
+        fflush(stdout);
+        len = 0;
+    }
+
+    return 0;
+}
+
+//line as stored in the µCNC RX buffer (the realtime commands are removed and tabs are replaced)
+static int expected_line(const unsigned char *in, int len, unsigned char *line)
+{
+    int size = 0;
+    for (int i = 0; i < len; i++)
+    {
+        if (in[i] == '\r' || in[i] == '\n')
+        {
+            break;
+        }
+
+        if (!is_realtime(in[i]))
+        {
+            line[size++] = (in[i] == '\t') ? ' ' : in[i];
+        }
+    }
+
+    line[size] = EOL;
+    return size;
+}
+
+static int round_trip(const char *file)
+{
+    unsigned char line[ENCODER_LINE_SIZE];
+    unsigned char expected[ENCODER_LINE_SIZE];
+    unsigned char out[2 * ENCODER_LINE_SIZE];
+    uint32_t lines = 0;
+    uint32_t bytes = 0;
+    uint32_t encoded = 0;
+    uint32_t errors = 0;
+    FILE *fp = fopen(file, "r");
+    if (!fp)
+    {
+        printf("can't open %s\n", file);
+        return 1;
+    }
+
+    settings_reset();
+    cnc_init();
+    serial_inject_cmd((const unsigned char *)__romstr__("$Z\n"));
+    serial_get_line();
+    encoder_reset();
+
+    while (fgets((char *)line, ENCODER_LINE_SIZE, fp))
+    {
+        int len = strlen((char *)line);
+        int size = encoder_encode(line, len, out);
+        for (int i = 0; i < size; i++)
+        {
+            serial_rx_isr(out[i]);
+        }
+
+        expected_line(line, len, expected);
+        if (serial_rx_is_empty() || strcmp((char *)serial_get_line(), (char *)expected))
+        {
+            errors++;
+        }
+
+        lines++;
+        bytes += len;
+        encoded += size;
+    }
+    fclose(fp);
+
+    printf("%s: %u lines, %u bytes encoded in %u bytes (%.2fx), %u mismatched lines\n", file, lines, bytes, encoded, (double)bytes / encoded, errors);
+    printf("serial time at %d baud: %.3fs ASCII, %.3fs compressed\n", BAUD, bytes * 10.0 / BAUD, encoded * 10.0 / BAUD);
+    return (errors != 0);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && !strcmp(argv[1], "-e"))
+    {
+        return encode_filter();
+    }
+
+    return round_trip((argc > 1) ? argv[1] : "../gcode/sample.ngc");
+}
@@ -0,0 +1,205 @@
+/*
+	Name: input_shaping.c
+	Description: Host simulation of the input shapers (ZV, ZVD and MZV) of the interpolator (ENABLE_INPUT_SHAPING).
+		The µCNC core runs against a simulated MCU and a mass-spring-damper (the machine frame) follows the X stepper position generated by the step ISR.
+		Each motion is a G1 X motion (a fast 1mm motion close to a step input and 7mm motions with constant acceleration).
+		The shaped motion is computed at the end of each interpolator segment (10ms) and the reduction is lower than with a continuous shaper.
+		The residual vibration energy at the end of the motion is compared with and without the shaper (the shaper tuned to the frame frequency and with a 20% frequency error).
+
+	Build and run from this folder (-DINPUT_SHAPER sets the shaper: 1-ZV, 2-ZVD or 3-MZV)
+		gcc -O2 -std=gnu99 -I../../uCNC -DBOARD=BOARD_VIRTUAL -D__SIMUL__ -DFORCE_SOFT_POLLING -DF_STEP_MAX=65000 -DENABLE_INPUT_SHAPING -DINPUT_SHAPER=2 input_shaping.c ../../uCNC/[a-z]*.c -Wl,--wrap=io_controls_isr -lm -o input_shaping
+		./input_shaping
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "config.h"
+#include "mcudefs.h"
+#include "mcu.h"
+#include "settings.h"
+#include "serial.h"
+#include "interpolator.h"
+#include "cnc.h"
+#include "planner.h"
+#include "parser.h"
+
+#define FRAME_FREQUENCY 40.0
+#define FRAME_DAMPING 0.05
+#define SIM_DT 0.00001
+#define SIM_TIMER_FREQ 10000000.0
+#define SIM_MOTIONS 3
+#define SIM_SHAPERS 4
+
+//simulated MCU (the responses are discarded)
+VIRTUAL_MAP virtualmap;
+virtports_t virtualports = &virtualmap;
+static uint8_t eeprom[4096];
+static bool pulse_enabled;
+static uint32_t pulse_period;
+
+void mcu_init(void) {}
+void mcu_enable_probe_isr(void) {}
+void mcu_disable_probe_isr(void) {}
+uint8_t mcu_get_analog(uint8_t channel) { return 0; }
+void mcu_set_pwm(uint8_t pwm, uint8_t value) {}
+uint8_t mcu_get_pwm(uint8_t pwm) { return 0; }
+void mcu_start_send(void)
+{
+    for (uint16_t i = 0; i < TX_BUFFER_SIZE; i++)
+    {
+        serial_tx_isr();
+    }
+}
+void mcu_stop_send(void) {}
+void mcu_putc(char c) {}
+char mcu_getc(void) { return 0; }
+void mcu_enable_interrupts(void) {}
+void mcu_disable_interrupts(void) {}
+//the step ISR timer counts 0.1 microseconds
+void mcu_freq_to_clocks(float frequency, uint16_t *ticks, uint16_t *tick_reps)
+{
+    uint32_t period = (uint32_t)(SIM_TIMER_FREQ / frequency);
+    *tick_reps = (uint16_t)(period >> 16) + 1;
+    *ticks = (uint16_t)(period / *tick_reps);
+}
+void mcu_start_step_ISR(uint16_t ticks, uint16_t tick_reps)
+{
+    pulse_period = (uint32_t)ticks * tick_reps;
+    pulse_enabled = true;
+}
+void mcu_change_step_ISR(uint16_t ticks, uint16_t tick_reps) { mcu_start_step_ISR(ticks, tick_reps); }
+void mcu_step_stop_ISR(void) { pulse_enabled = false; }
+void mcu_delay_ms(uint16_t ms) {}
+uint8_t mcu_eeprom_getc(uint16_t address) { return eeprom[address & 4095]; }
+void mcu_eeprom_putc(uint16_t address, uint8_t value) { eeprom[address & 4095] = value; }
+void mcu_eeprom_erase(uint16_t address) {}
+
+//machine frame (position and speed in mm and mm/s) driven by the X stepper position
+static double frame_x;
+static double frame_v;
+static double frame_time;
+static double sim_time;
+
+static void frame_update(double time)
+{
+    uint32_t steps[STEPPER_COUNT];
+    double w = 2.0 * M_PI * FRAME_FREQUENCY;
+    itp_get_rt_position(steps);
+    double u = (int32_t)steps[0] / g_settings.step_per_mm[0];
+    while (frame_time < time)
+    {
+        double a = w * w * (u - frame_x) - 2.0 * FRAME_DAMPING * w * frame_v;
+        frame_v += a * SIM_DT;
+        frame_x += frame_v * SIM_DT;
+        frame_time += SIM_DT;
+    }
+}
+
+extern void __real_io_controls_isr(void);
+void __wrap_io_controls_isr(void)
+{
+    if (pulse_enabled)
+    {
+        //the stepper position is kept until the next step ISR
+        frame_update(sim_time);
+        itp_step_isr();
+        itp_step_reset_isr();
+        sim_time += pulse_period * (1.0 / SIM_TIMER_FREQ);
+    }
+    else
+    {
+        frame_update(sim_time);
+        sim_time += SIM_DT;
+    }
+
+    __real_io_controls_isr();
+}
+
+static void sim_send_line(const char *line)
+{
+    while (*line)
+    {
+        serial_rx_isr((unsigned char)*line++);
+    }
+    serial_rx_isr('\n');
+    parser_read_command();
+}
+
+//runs the motion and returns the vibration energy (per unit of mass) at the end of the motion
+static double sim_run(float frequency, float distance, float acceleration)
+{
+    char line[64];
+    double w = 2.0 * M_PI * FRAME_FREQUENCY;
+
+    settings_reset();
+    cnc_init();
+    cnc_unlock();
+    sim_send_line("$100=750");
+    sim_send_line("$110=9000");
+    sprintf(line, "$120=%.0f", acceleration);
+    sim_send_line(line);
+    sprintf(line, "$150=%.1f", frequency);
+    sim_send_line(line);
+    sim_send_line("$160=0.1");
+    sprintf(line, "G1 X%.3f F9000", distance);
+    sim_send_line(line);
+
+    do
+    {
+        if (!cnc_doevents())
+        {
+            break;
+        }
+    } while (!planner_buffer_is_empty() || cnc_get_exec_state(EXEC_RUN));
+
+    frame_update(sim_time);
+    return (0.5 * frame_v * frame_v + 0.5 * w * w * (frame_x - distance) * (frame_x - distance));
+}
+
+int main(void)
+{
+    static const char *shaper_names[] = {"none", "ZV", "ZVD", "MZV"};
+    static const float distance[SIM_MOTIONS] = {1, 7, 7};
+    static const float acceleration[SIM_MOTIONS] = {50000, 1000, 2000};
+    static const float frequency[SIM_SHAPERS] = {0, FRAME_FREQUENCY, FRAME_FREQUENCY * 0.8, FRAME_FREQUENCY * 1.2};
+    //the energies are computed by the forked runs
+    double *energy = mmap(NULL, SIM_SHAPERS * SIM_MOTIONS * sizeof(double), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (energy == MAP_FAILED)
+    {
+        printf("out of memory\n");
+        return 1;
+    }
+
+    for (uint8_t s = 0; s < SIM_SHAPERS; s++)
+    {
+        for (uint8_t m = 0; m < SIM_MOTIONS; m++)
+        {
+            //each run starts with a fresh µCNC
+            fflush(stdout);
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                energy[s * SIM_MOTIONS + m] = sim_run(frequency[s], distance[m], acceleration[m]);
+                return 0;
+            }
+            waitpid(pid, NULL, 0);
+        }
+    }
+
+    printf("frame %.0fHz damping %.2f (shaper damping 0.1)\n", FRAME_FREQUENCY, FRAME_DAMPING);
+    printf("%-6s %-8s %14s %14s %14s\n", "shaper", "freq", "1mm fast", "1000mm/s^2", "2000mm/s^2");
+    printf("%-6s %-8s %14g %14g %14g\n", shaper_names[0], "-", energy[0], energy[1], energy[2]);
+    for (uint8_t s = 1; s < SIM_SHAPERS; s++)
+    {
+        double *e = &energy[s * SIM_MOTIONS];
+        printf("%-6s %-8.1f %13.2f%% %13.2f%% %13.2f%%\n", shaper_names[INPUT_SHAPER], frequency[s],
+               100.0 * e[0] / energy[0], 100.0 * e[1] / energy[1], 100.0 * e[2] / energy[1]);
+    }
+
+    printf("shaped energies are relative to the unshaped motion (2000mm/s^2 relative to the unshaped 1000mm/s^2)\n");
+    return 0;
+}
@@ -0,0 +1,74 @@
+/*
+	Name: kinematics_benchmark.c
+	Description: Host benchmark of the kinematics inverse computation (segments per second).
+		Each segment is the computation of the actuators position of a point of the path.
+
+	Build and run from this folder (MACHINE_KINEMATICS: 1-cartesian, 2-corexy, 4-delta, 5-scara)
+		gcc -O2 -std=gnu99 -I../../uCNC -DBOARD=BOARD_VIRTUAL -D__SIMUL__ -DMACHINE_KINEMATICS=4 kinematics_benchmark.c ../../uCNC/kinematics_*.c -lm -o kinematics_benchmark
+		./kinematics_benchmark
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include "config.h"
+#include "settings.h"
+#include "kinematics.h"
+
+#define BENCHMARK_SEGMENTS 10000000
+#define BENCHMARK_PATH_POINTS 4096
+
+//stubs of the functions used by the kinematics modules
+settings_t g_settings;
+uint8_t mc_home_axis(uint8_t axis, uint8_t axis_limit) { return 0; }
+uint8_t cnc_get_exec_state(uint8_t statemask) { return 0; }
+void itp_lock_stepper(uint8_t lockmask) {}
+
+int main(void)
+{
+    static float path[BENCHMARK_PATH_POINTS][AXIS_COUNT];
+    float axis[AXIS_COUNT];
+    uint32_t steps[STEPPER_COUNT];
+    uint32_t checksum = 0;
+    float max_error = 0;
+
+    for (uint8_t i = 0; i < STEPPER_COUNT; i++)
+    {
+        g_settings.step_per_mm[i] = 200;
+    }
+
+    //circle of 50mm radius centered at a reachable point of every machine
+    for (uint16_t s = 0; s < BENCHMARK_PATH_POINTS; s++)
+    {
+        float angle = (float)s * (6.2831853f / BENCHMARK_PATH_POINTS);
+        path[s][AXIS_X] = 150.0f + 50.0f * cosf(angle);
+        path[s][AXIS_Y] = 50.0f + 50.0f * sinf(angle);
+#if (MACHINE_KINEMATICS == MACHINE_DELTA)
+        path[s][AXIS_X] -= 150.0f;
+        path[s][AXIS_Y] -= 50.0f;
+        path[s][AXIS_Z] = -150.0f;
+#endif
+    }
+
+    clock_t start = clock();
+    for (uint32_t s = 0; s < BENCHMARK_SEGMENTS; s++)
+    {
+        kinematics_apply_inverse(path[s & (BENCHMARK_PATH_POINTS - 1)], steps);
+        checksum += steps[0];
+    }
+    double elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    //checks the inverse/forward round trip error (200 steps per mm or degree)
+    for (uint16_t s = 0; s < BENCHMARK_PATH_POINTS; s++)
+    {
+        kinematics_apply_inverse(path[s], steps);
+        kinematics_apply_forward(steps, axis);
+        for (uint8_t i = 0; i < AXIS_COUNT; i++)
+        {
+            max_error = fmaxf(max_error, fabsf(axis[i] - path[s][i]));
+        }
+    }
+
+    printf("kinematics %d: %.0f segments/s (checksum %u) round trip error %fmm\n", MACHINE_KINEMATICS, BENCHMARK_SEGMENTS / elapsed, checksum, max_error);
+    return 0;
+}
@@ -0,0 +1,160 @@
+/*
+	Name: line_checksum.c
+	Description: Host test of the line checksum (ENABLE_LINE_CHECKSUM) with the ASCII lines and the binary frames (ENABLE_BINARY_PROTOCOL).
+		The checksum of the ASCII lines is computed with the tabs as sent and the binary frames are not checked (the payload is binary and the frame has its own checksum).
+		The frames contain 0x09 bytes (a delta value and a payload length of 9) that must reach the parser unchanged.
+		The motion control runs in check mode ($C) and the position after each line is compared with the expected position.
+
+	Build and run from this folder
+		gcc -O2 -std=gnu99 -I../../uCNC -DBOARD=BOARD_VIRTUAL -D__SIMUL__ -DFORCE_SOFT_POLLING -DENABLE_LINE_CHECKSUM -DENABLE_BINARY_PROTOCOL line_checksum.c ../../uCNC/[a-z]*.c -lm -o line_checksum
+		./line_checksum
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "config.h"
+#include "mcudefs.h"
+#include "mcu.h"
+#include "settings.h"
+#include "serial.h"
+#include "cnc.h"
+#include "parser.h"
+#include "grbl_interface.h"
+#include "motion_control.h"
+
+#if !defined(ENABLE_LINE_CHECKSUM) || !defined(ENABLE_BINARY_PROTOCOL)
+#error "Build with -DENABLE_LINE_CHECKSUM -DENABLE_BINARY_PROTOCOL"
+#endif
+
+//simulated MCU (the responses are discarded)
+VIRTUAL_MAP virtualmap;
+virtports_t virtualports = &virtualmap;
+static uint8_t eeprom[4096];
+
+void mcu_init(void) {}
+void mcu_enable_probe_isr(void) {}
+void mcu_disable_probe_isr(void) {}
+uint8_t mcu_get_analog(uint8_t channel) { return 0; }
+void mcu_set_pwm(uint8_t pwm, uint8_t value) {}
+uint8_t mcu_get_pwm(uint8_t pwm) { return 0; }
+void mcu_start_send(void)
+{
+    for (uint16_t i = 0; i < TX_BUFFER_SIZE; i++)
+    {
+        serial_tx_isr();
+    }
+}
+void mcu_stop_send(void) {}
+void mcu_putc(char c) {}
+char mcu_getc(void) { return 0; }
+void mcu_enable_interrupts(void) {}
+void mcu_disable_interrupts(void) {}
+void mcu_freq_to_clocks(float frequency, uint16_t *ticks, uint16_t *tick_reps)
+{
+    *ticks = (uint16_t)(1000000.0f / frequency);
+    *tick_reps = 1;
+}
+void mcu_start_step_ISR(uint16_t ticks, uint16_t tick_reps) {}
+void mcu_change_step_ISR(uint16_t ticks, uint16_t tick_reps) {}
+void mcu_step_stop_ISR(void) {}
+void mcu_delay_ms(uint16_t ms) {}
+uint8_t mcu_eeprom_getc(uint16_t address) { return eeprom[address & 4095]; }
+void mcu_eeprom_putc(uint16_t address, uint8_t value) { eeprom[address & 4095] = value; }
+void mcu_eeprom_erase(uint16_t address) {}
+
+static uint32_t test_errors;
+
+static uint8_t test_send(const unsigned char *data, uint8_t size)
+{
+    uint8_t error = STATUS_OK;
+    for (uint8_t i = 0; i < size; i++)
+    {
+        serial_rx_isr(data[i]);
+    }
+
+    while (!serial_rx_is_empty())
+    {
+        error |= parser_read_command();
+    }
+
+    return error;
+}
+
+//sends an ASCII line (with the checksum if numbered)
+static uint8_t test_line(const char *line)
+{
+    unsigned char data[RX_BUFFER_SIZE];
+    uint8_t size = strlen(line);
+    memcpy(data, line, size);
+    if (line[0] == 'N')
+    {
+        uint8_t checksum = 0;
+        for (uint8_t i = 0; i < size; i++)
+        {
+            checksum ^= (unsigned char)line[i];
+        }
+        size += sprintf((char *)&data[size], "*%u", checksum);
+    }
+    data[size++] = '\n';
+    return test_send(data, size);
+}
+
+//sends a frame with the payload (the words as encoded by parser_fetch_frame)
+static uint8_t test_frame(const unsigned char *payload, uint8_t length)
+{
+    unsigned char frame[RX_BUFFER_SIZE];
+    frame[0] = STX;
+    frame[1] = length;
+    memcpy(&frame[2], payload, length);
+    frame[2 + length] = length;
+    for (uint8_t i = 0; i < length; i++)
+    {
+        frame[2 + length] ^= payload[i];
+    }
+    return test_send(frame, length + 3);
+}
+
+static void test_check(const char *name, uint8_t error, float x, float y, float z)
+{
+    float axis[AXIS_COUNT];
+    mc_get_position(axis);
+    bool pass = (error == STATUS_OK && fabsf(axis[0] - x) < 0.0005f && fabsf(axis[1] - y) < 0.0005f && fabsf(axis[2] - z) < 0.0005f);
+    printf("%-32s error %3u position %.3f %.3f %.3f (expected %.3f %.3f %.3f) %s\n", name, error, axis[0], axis[1], axis[2], x, y, z, (pass) ? "pass" : "FAIL");
+    if (!pass)
+    {
+        test_errors++;
+    }
+}
+
+int main(void)
+{
+    settings_reset();
+    cnc_init();
+    cnc_unlock();
+    if (test_line("$C") != STATUS_OK || !mc_get_checkmode())
+    {
+        printf("failed to enter check mode\n");
+        return 1;
+    }
+
+    //ASCII lines with tabs (the checksum is computed with the tabs as sent)
+    test_check("numbered line with tab", test_line("N1 G0\tX1"), 1, 0, 0);
+    test_check("unnumbered line with tab", test_line("G0\tY2"), 1, 2, 0);
+    test_check("binary mode", test_line("$B"), 1, 2, 0);
+
+    //X0.009 G0 (X delta 9 is the 0x09 byte and is sent before the G0 value that is a 0 byte)
+    const unsigned char delta9[] = {('X' - '@') | (4 << 5), 9, 'G' - '@', 0};
+    test_check("frame X0.009 G0 (0x09 value)", test_frame(delta9, sizeof(delta9)), 0.009f, 2, 0);
+
+    //G0 X1 Y0.1 Z0.002 (payload length 9)
+    const unsigned char length9[] = {'G' - '@', 0, ('X' - '@') | (5 << 5), 991 & 0xFF, 991 >> 8, ('Y' - '@') | (4 << 5), 100, ('Z' - '@') | (4 << 5), 2};
+    test_check("frame G0 X1 Y0.1 Z0.002 (length 9)", test_frame(length9, sizeof(length9)), 1, 0.1f, 0.002f);
+
+    //the empty frame returns to the ASCII G-code and the ASCII lines are still checked after the frames
+    test_check("empty frame", test_frame(NULL, 0), 1, 0.1f, 0.002f);
+    test_check("numbered line after frames", test_line("N2 G0\tX3"), 3, 0.1f, 0.002f);
+
+    printf("%u errors\n", test_errors);
+    return (test_errors) ? 1 : 0;
+}
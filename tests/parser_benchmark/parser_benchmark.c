@@ -0,0 +1,159 @@
+/*
+	Name: parser_benchmark.c
+	Description: Host benchmark of the G-code parser throughput (lines per second).
+		Each line is loaded in the RX buffer and parsed, validated and executed. The motion control runs in check mode ($C) so only the parser is measured.
+		The program is CAM like output (repeated modal motion lines with or without G1/F words) followed by lines that change the modal state.
+
+	Build and run from this folder (add -DENABLE_PARSER_FAST_PATH to test the modal motion fast path)
+		gcc -O2 -std=gnu99 -I../../uCNC -DBOARD=BOARD_VIRTUAL -D__SIMUL__ -DFORCE_SOFT_POLLING parser_benchmark.c ../../uCNC/[a-z]*.c -lm -o parser_benchmark
+		./parser_benchmark
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "config.h"
+#include "mcudefs.h"
+#include "mcu.h"
+#include "settings.h"
+#include "serial.h"
+#include "cnc.h"
+#include "parser.h"
+#include "grbl_interface.h"
+#include "motion_control.h"
+
+#define BENCHMARK_LINES 1000000
+#define BENCHMARK_PROGRAM_LINES 1024
+#define BENCHMARK_LINE_SIZE 64
+
+//simulated MCU (the responses are discarded)
+VIRTUAL_MAP virtualmap;
+virtports_t virtualports = &virtualmap;
+static uint8_t eeprom[4096];
+
+void mcu_init(void) {}
+void mcu_enable_probe_isr(void) {}
+void mcu_disable_probe_isr(void) {}
+uint8_t mcu_get_analog(uint8_t channel) { return 0; }
+void mcu_set_pwm(uint8_t pwm, uint8_t value) {}
+uint8_t mcu_get_pwm(uint8_t pwm) { return 0; }
+void mcu_start_send(void)
+{
+    for (uint16_t i = 0; i < TX_BUFFER_SIZE; i++)
+    {
+        serial_tx_isr();
+    }
+}
+void mcu_stop_send(void) {}
+void mcu_putc(char c) {}
+char mcu_getc(void) { return 0; }
+void mcu_enable_interrupts(void) {}
+void mcu_disable_interrupts(void) {}
+void mcu_freq_to_clocks(float frequency, uint16_t *ticks, uint16_t *tick_reps)
+{
+    *ticks = (uint16_t)(1000000.0f / frequency);
+    *tick_reps = 1;
+}
+void mcu_start_step_ISR(uint16_t ticks, uint16_t tick_reps) {}
+void mcu_change_step_ISR(uint16_t ticks, uint16_t tick_reps) {}
+void mcu_step_stop_ISR(void) {}
+void mcu_delay_ms(uint16_t ms) {}
+uint8_t mcu_eeprom_getc(uint16_t address) { return eeprom[address & 4095]; }
+void mcu_eeprom_putc(uint16_t address, uint8_t value) { eeprom[address & 4095] = value; }
+void mcu_eeprom_erase(uint16_t address) {}
+
+static char program[BENCHMARK_PROGRAM_LINES][BENCHMARK_LINE_SIZE];
+
+static uint8_t benchmark_line(const char *line)
+{
+    uint8_t error = STATUS_OK;
+    while (*line)
+    {
+        serial_rx_isr((unsigned char)*line++);
+    }
+    serial_rx_isr('\n');
+
+    while (!serial_rx_is_empty())
+    {
+        error |= parser_read_command();
+    }
+
+    return error;
+}
+
+int main(void)
+{
+    uint32_t errors = 0;
+
+    //pocket like toolpath with a modal state change every 64 lines
+    for (uint16_t i = 0; i < BENCHMARK_PROGRAM_LINES; i++)
+    {
+        float x = (float)(i % 97) * 0.731f - 20.0f;
+        float y = (float)(i % 61) * -0.417f + 5.0f;
+        float z = -(float)(i % 7) * 0.05f;
+        switch (i & 63)
+        {
+        case 0:
+            sprintf(program[i], "G0 Z%.3f", 2.0f);
+            break;
+        case 1:
+            sprintf(program[i], "G0 X%.3f Y%.3f", x, y);
+            break;
+        case 2:
+            sprintf(program[i], "G1 Z%.3f F300", z);
+            break;
+        case 3:
+            sprintf(program[i], "G1 X%.3f Y%.3f F1200", x, y);
+            break;
+        case 32:
+            sprintf(program[i], "G90 G54 M3 S1000");
+            break;
+        default:
+            switch (i & 3)
+            {
+            case 0:
+                sprintf(program[i], "X%.3f Y%.3f Z%.3f", x, y, z);
+                break;
+            case 1:
+                sprintf(program[i], "G1 X%.3f Y%.3f", x, y);
+                break;
+            case 2:
+                sprintf(program[i], "N%u X%.3f Y%.3f F%u", i, x, y, 1000 + (i % 5) * 50);
+                break;
+            default:
+                sprintf(program[i], "X%.3f", x);
+                break;
+            }
+            break;
+        }
+    }
+
+    settings_reset();
+    cnc_init();
+    cnc_unlock();
+    if (benchmark_line("$C") != STATUS_OK || !mc_get_checkmode())
+    {
+        printf("failed to enter check mode\n");
+        return 1;
+    }
+
+    clock_t start = clock();
+    for (uint32_t l = 0; l < BENCHMARK_LINES; l++)
+    {
+        if (benchmark_line(program[l & (BENCHMARK_PROGRAM_LINES - 1)]) != STATUS_OK)
+        {
+            errors++;
+        }
+    }
+    double elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    float axis[AXIS_COUNT];
+    mc_get_position(axis);
+#ifdef ENABLE_PARSER_FAST_PATH
+    printf("parser (fast path): ");
+#else
+    printf("parser: ");
+#endif
+    printf("%.0f lines/s (%u errors) end position %.3f %.3f %.3f\n", BENCHMARK_LINES / elapsed, errors, axis[0], axis[1], axis[2]);
+    return 0;
+}
@@ -0,0 +1,336 @@
+/*
+	Name: path_blending.c
+	Description: Host simulation of the G64 P<tolerance> path blending (ENABLE_G64_PATH_BLENDING).
+		The file is executed by the µCNC core (parser, mc_line, planner and step ISR) against a simulated MCU and the tool position is recorded at each step.
+		The exact stop path (G61) is the reference path. Each G64 run reports the cycle time (motion time) and the maximum distance of the tool to the reference path.
+		The distance is measured to the nearest reference step position (within the step resolution).
+		The F words of the file are replaced by the test feed (the default axis settings are set to 3000mm/min and 200mm/s^2).
+			With a segmented kinematics (MACHINE_KINEMATICS 4-delta or 5-scara) the step positions are converted back to the tool position with the forward kinematics.
+
+	Build and run from this folder (add -DMACHINE_KINEMATICS=4 to test the blending with the delta segmented motions)
+		gcc -O2 -std=gnu99 -I../../uCNC -DBOARD=BOARD_VIRTUAL -D__SIMUL__ -DFORCE_SOFT_POLLING -DF_STEP_MAX=30000 -DENABLE_G64_PATH_BLENDING path_blending.c ../../uCNC/[a-z]*.c -Wl,--wrap=io_controls_isr -lm -o path_blending
+		./path_blending [file] [feed in mm/min]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "config.h"
+#include "mcudefs.h"
+#include "mcu.h"
+#include "settings.h"
+#include "grbl_interface.h"
+#include "serial.h"
+#include "kinematics.h"
+#include "interpolator.h"
+#include "cnc.h"
+#include "planner.h"
+#include "parser.h"
+#include "protocol.h"
+#include "motion_control.h"
+
+#define SIM_MAX_POINTS (1 << 22)
+#define SIM_MAX_LINES 4096
+#define SIM_LINE_SIZE 128
+#define SIM_GRID_CELL 0.25f
+#define SIM_GRID_SIZE 1000003
+#define SIM_GRID_SEARCH 16
+
+//simulated MCU (the responses are discarded)
+VIRTUAL_MAP virtualmap;
+virtports_t virtualports = &virtualmap;
+static uint8_t eeprom[4096];
+static bool pulse_enabled;
+static uint32_t pulse_period;
+
+void mcu_init(void) {}
+void mcu_enable_probe_isr(void) {}
+void mcu_disable_probe_isr(void) {}
+uint8_t mcu_get_analog(uint8_t channel) { return 0; }
+void mcu_set_pwm(uint8_t pwm, uint8_t value) {}
+uint8_t mcu_get_pwm(uint8_t pwm) { return 0; }
+void mcu_start_send(void)
+{
+    for (uint16_t i = 0; i < TX_BUFFER_SIZE; i++)
+    {
+        serial_tx_isr();
+    }
+}
+void mcu_stop_send(void) {}
+void mcu_putc(char c) {}
+char mcu_getc(void) { return 0; }
+void mcu_enable_interrupts(void) {}
+void mcu_disable_interrupts(void) {}
+//the step ISR timer counts microseconds
+void mcu_freq_to_clocks(float frequency, uint16_t *ticks, uint16_t *tick_reps)
+{
+    uint32_t period = (uint32_t)(1000000.0f / frequency);
+    *tick_reps = (uint16_t)(period >> 16) + 1;
+    *ticks = (uint16_t)(period / *tick_reps);
+}
+void mcu_start_step_ISR(uint16_t ticks, uint16_t tick_reps)
+{
+    pulse_period = (uint32_t)ticks * tick_reps;
+    pulse_enabled = true;
+}
+void mcu_change_step_ISR(uint16_t ticks, uint16_t tick_reps) { mcu_start_step_ISR(ticks, tick_reps); }
+void mcu_step_stop_ISR(void) { pulse_enabled = false; }
+void mcu_delay_ms(uint16_t ms) {}
+uint8_t mcu_eeprom_getc(uint16_t address) { return eeprom[address & 4095]; }
+void mcu_eeprom_putc(uint16_t address, uint8_t value) { eeprom[address & 4095] = value; }
+void mcu_eeprom_erase(uint16_t address) {}
+
+//tool positions of the reference path (shared with the runs) and the grid of the nearest point search
+typedef struct
+{
+    float axis[3];
+    int32_t next;
+} sim_point_t;
+
+static sim_point_t *ref_points;
+static int32_t *ref_count;
+static int32_t *ref_grid;
+static bool sim_reference;
+static double sim_motion_time;
+static double sim_deviation;
+static uint32_t sim_last_steps[STEPPER_COUNT];
+
+static uint32_t sim_grid_hash(float x, float y, float z)
+{
+    int32_t a = (int32_t)floorf(x / SIM_GRID_CELL);
+    int32_t b = (int32_t)floorf(y / SIM_GRID_CELL);
+    int32_t c = (int32_t)floorf(z / SIM_GRID_CELL);
+    return ((uint32_t)a * 73856093u ^ (uint32_t)b * 19349663u ^ (uint32_t)c * 83492791u) % SIM_GRID_SIZE;
+}
+
+static void sim_add_reference(float *axis)
+{
+    if (*ref_count == SIM_MAX_POINTS)
+    {
+        return;
+    }
+
+    sim_point_t *p = &ref_points[*ref_count];
+    memcpy(p->axis, axis, sizeof(p->axis));
+    uint32_t h = sim_grid_hash(axis[0], axis[1], axis[2]);
+    p->next = ref_grid[h];
+    ref_grid[h] = (*ref_count)++;
+}
+
+//distance to the nearest reference point
+//searches the grid cells around the point until the nearest point is inside the searched distance
+static double sim_distance(float *axis)
+{
+    double best = 1e9;
+    for (int8_t r = 1; r <= SIM_GRID_SEARCH; r++)
+    {
+        for (int8_t a = -r; a <= r; a++)
+        {
+            for (int8_t b = -r; b <= r; b++)
+            {
+                for (int8_t c = -r; c <= r; c++)
+                {
+                    uint32_t h = sim_grid_hash(axis[0] + a * SIM_GRID_CELL, axis[1] + b * SIM_GRID_CELL, axis[2] + c * SIM_GRID_CELL);
+                    for (int32_t i = ref_grid[h]; i >= 0; i = ref_points[i].next)
+                    {
+                        double dx = ref_points[i].axis[0] - axis[0];
+                        double dy = ref_points[i].axis[1] - axis[1];
+                        double dz = ref_points[i].axis[2] - axis[2];
+                        double d = dx * dx + dy * dy + dz * dz;
+                        if (d < best)
+                        {
+                            best = d;
+                        }
+                    }
+                }
+            }
+        }
+
+        if (best <= (r * SIM_GRID_CELL) * (r * SIM_GRID_CELL))
+        {
+            break;
+        }
+    }
+
+    return sqrt(best);
+}
+
+extern void __real_io_controls_isr(void);
+void __wrap_io_controls_isr(void)
+{
+    if (pulse_enabled)
+    {
+        uint32_t steps[STEPPER_COUNT];
+        itp_step_isr();
+        itp_step_reset_isr();
+        sim_motion_time += pulse_period * 0.000001;
+
+        itp_get_rt_position(steps);
+        if (memcmp(steps, sim_last_steps, sizeof(steps)))
+        {
+            float axis[AXIS_COUNT];
+            memcpy(sim_last_steps, steps, sizeof(steps));
+            kinematics_apply_forward(steps, axis);
+            if (sim_reference)
+            {
+                sim_add_reference(axis);
+            }
+            else
+            {
+                double d = sim_distance(axis);
+                sim_deviation = (d > sim_deviation) ? d : sim_deviation;
+            }
+        }
+    }
+
+    __real_io_controls_isr();
+}
+
+static char sim_lines[SIM_MAX_LINES][SIM_LINE_SIZE];
+static uint16_t sim_line_count;
+
+//loads the file and replaces the F words by the test feed
+static bool sim_load(const char *file, float feed)
+{
+    char line[SIM_LINE_SIZE];
+    FILE *fp = fopen(file, "r");
+    if (!fp)
+    {
+        return false;
+    }
+
+    while (fgets(line, sizeof(line), fp) && sim_line_count < SIM_MAX_LINES)
+    {
+        char *out = sim_lines[sim_line_count];
+        char *in = line;
+        bool comment = false;
+        line[strcspn(line, "\r\n")] = 0;
+        while (*in)
+        {
+            comment = (*in == '(') ? true : ((*in == ')') ? false : comment);
+            if (!comment && (*in == 'f' || *in == 'F'))
+            {
+                out += sprintf(out, "F%.0f", feed);
+                strtof(in + 1, &in);
+                continue;
+            }
+            *out++ = *in++;
+        }
+        *out = 0;
+        sim_line_count++;
+    }
+
+    fclose(fp);
+    return true;
+}
+
+static void sim_send_line(const char *line)
+{
+    while (*line)
+    {
+        serial_rx_isr((unsigned char)*line++);
+    }
+    serial_rx_isr('\n');
+}
+
+static void sim_run(const char *path_mode)
+{
+    static const char *setup[] = {"$110=3000", "$111=3000", "$112=3000", "$120=200", "$121=200", "$122=200"};
+    uint16_t line = 0;
+
+    settings_reset();
+    cnc_init();
+    cnc_unlock();
+    for (uint8_t i = 0; i < sizeof(setup) / sizeof(setup[0]); i++)
+    {
+        sim_send_line(setup[i]);
+        parser_read_command();
+    }
+    sim_send_line(path_mode);
+    parser_read_command();
+
+    for (;;)
+    {
+        if (serial_rx_is_empty() && line < sim_line_count)
+        {
+            sim_send_line(sim_lines[line++]);
+        }
+
+        if (!serial_rx_is_empty())
+        {
+            if (parser_read_command() != STATUS_OK)
+            {
+                printf("error in line %u\n", line);
+            }
+        }
+        else if (planner_buffer_is_empty())
+        {
+            //the end of the program (sends the motion kept by the path blending)
+            mc_blend_flush();
+            mc_sync_flush(false);
+            if (planner_buffer_is_empty() && !cnc_get_exec_state(EXEC_RUN))
+            {
+                break;
+            }
+        }
+
+        if (!cnc_doevents())
+        {
+            break;
+        }
+    }
+
+    if (sim_reference)
+    {
+        printf("%-12s %10.3f %10s (%d reference points)\n", path_mode, sim_motion_time, "-", *ref_count);
+    }
+    else
+    {
+        printf("%-12s %10.3f %10.4f\n", path_mode, sim_motion_time, sim_deviation);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    static const char *path_modes[] = {"G61", "G64", "G64 P0.02", "G64 P0.05", "G64 P0.2", "G64 P1"};
+    const char *file = (argc > 1) ? argv[1] : "../gcode/sample.ngc";
+    float feed = (argc > 2) ? atof(argv[2]) : 1500;
+
+    if (!sim_load(file, feed))
+    {
+        printf("can't open %s\n", file);
+        return 1;
+    }
+
+    ref_points = mmap(NULL, SIM_MAX_POINTS * sizeof(sim_point_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    ref_grid = mmap(NULL, SIM_GRID_SIZE * sizeof(int32_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    ref_count = mmap(NULL, sizeof(int32_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (ref_points == MAP_FAILED || ref_grid == MAP_FAILED || ref_count == MAP_FAILED)
+    {
+        printf("out of memory\n");
+        return 1;
+    }
+    memset(ref_grid, 0xFF, SIM_GRID_SIZE * sizeof(int32_t));
+
+    printf("%s at F%.0f (kinematics %d)\n", file, feed, MACHINE_KINEMATICS);
+    printf("%-12s %10s %10s\n", "path mode", "time(s)", "max dev(mm)");
+    for (uint8_t i = 0; i < sizeof(path_modes) / sizeof(path_modes[0]); i++)
+    {
+        //each run starts with a fresh µCNC (the first run records the reference path)
+        fflush(stdout);
+        sim_reference = (i == 0);
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            sim_run(path_modes[i]);
+            return 0;
+        }
+        waitpid(pid, NULL, 0);
+    }
+
+    return 0;
+}
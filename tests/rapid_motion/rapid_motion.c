@@ -0,0 +1,316 @@
+/*
+	Name: rapid_motion.c
+	Description: Host simulation of the G0 cycle time with the independent axis rapid motions (ENABLE_RAPID_INDEPENDENT_AXIS).
+		Each motion is executed by the µCNC core (parser, planner and step ISR) against a simulated MCU and the motion time is measured.
+			straight: the motion as a single straight line (a G1 above the maximum feed is clamped like a G0 and the feed and rapid acceleration factors are both 1)
+			dogleg: the motion decomposed in straight lines where each axis moves at its own maximum rate until it reaches the target
+			G0: the rapid motion (the axes profiles are sampled if the straight line is slower)
+			independent: the time of the slowest axis moving alone at its own maximum rate and acceleration (the lower bound of the G0)
+		The motions are tested on a machine where the same axis limits the feed and the acceleration and on machines where different axes limit them.
+		The G0 must end at the target and can't be slower than the straight line.
+		A G0 to a target outside the soft limits must raise the alarm without moving.
+
+	Build and run from this folder
+		gcc -O2 -std=gnu99 -I../../uCNC -DBOARD=BOARD_VIRTUAL -D__SIMUL__ -DFORCE_SOFT_POLLING -DF_STEP_MAX=30000 -DENABLE_RAPID_INDEPENDENT_AXIS rapid_motion.c ../../uCNC/[a-z]*.c -Wl,--wrap=io_controls_isr -lm -o rapid_motion
+		./rapid_motion
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "config.h"
+#include "mcudefs.h"
+#include "mcu.h"
+#include "settings.h"
+#include "grbl_interface.h"
+#include "serial.h"
+#include "interpolator.h"
+#include "cnc.h"
+#include "planner.h"
+#include "parser.h"
+#include "motion_control.h"
+
+#ifndef ENABLE_RAPID_INDEPENDENT_AXIS
+#error "Build with -DENABLE_RAPID_INDEPENDENT_AXIS"
+#endif
+
+#define SIM_AXIS 3
+#define SIM_LINE_SIZE 64
+
+//simulated MCU (the responses are discarded)
+VIRTUAL_MAP virtualmap;
+virtports_t virtualports = &virtualmap;
+static uint8_t eeprom[4096];
+static bool pulse_enabled;
+static uint32_t pulse_period;
+static double sim_motion_time;
+
+void mcu_init(void) {}
+void mcu_enable_probe_isr(void) {}
+void mcu_disable_probe_isr(void) {}
+uint8_t mcu_get_analog(uint8_t channel) { return 0; }
+void mcu_set_pwm(uint8_t pwm, uint8_t value) {}
+uint8_t mcu_get_pwm(uint8_t pwm) { return 0; }
+void mcu_start_send(void)
+{
+    for (uint16_t i = 0; i < TX_BUFFER_SIZE; i++)
+    {
+        serial_tx_isr();
+    }
+}
+void mcu_stop_send(void) {}
+void mcu_putc(char c) {}
+char mcu_getc(void) { return 0; }
+void mcu_enable_interrupts(void) {}
+void mcu_disable_interrupts(void) {}
+//the step ISR timer counts microseconds
+void mcu_freq_to_clocks(float frequency, uint16_t *ticks, uint16_t *tick_reps)
+{
+    uint32_t period = (uint32_t)(1000000.0f / frequency);
+    *tick_reps = (uint16_t)(period >> 16) + 1;
+    *ticks = (uint16_t)(period / *tick_reps);
+}
+void mcu_start_step_ISR(uint16_t ticks, uint16_t tick_reps)
+{
+    pulse_period = (uint32_t)ticks * tick_reps;
+    pulse_enabled = true;
+}
+void mcu_change_step_ISR(uint16_t ticks, uint16_t tick_reps) { mcu_start_step_ISR(ticks, tick_reps); }
+void mcu_step_stop_ISR(void) { pulse_enabled = false; }
+void mcu_delay_ms(uint16_t ms) {}
+uint8_t mcu_eeprom_getc(uint16_t address) { return eeprom[address & 4095]; }
+void mcu_eeprom_putc(uint16_t address, uint8_t value) { eeprom[address & 4095] = value; }
+void mcu_eeprom_erase(uint16_t address) {}
+
+extern void __real_io_controls_isr(void);
+void __wrap_io_controls_isr(void)
+{
+    if (pulse_enabled)
+    {
+        itp_step_isr();
+        itp_step_reset_isr();
+        sim_motion_time += pulse_period * 0.000001;
+    }
+
+    __real_io_controls_isr();
+}
+
+typedef struct
+{
+    const char *name;
+    //max feed (mm/min) and acceleration (mm/s^2) of X, Y and Z
+    float feed[SIM_AXIS];
+    float accel[SIM_AXIS];
+} sim_machine_t;
+
+typedef struct
+{
+    double time;
+    float position[SIM_AXIS];
+    bool alarm;
+} sim_result_t;
+
+static void sim_send_line(const char *line)
+{
+    while (*line)
+    {
+        serial_rx_isr((unsigned char)*line++);
+    }
+    serial_rx_isr('\n');
+}
+
+//executes the lines after the setup lines (NULL terminated)
+static void sim_run(const sim_machine_t *machine, const char *const *setup, char lines[][SIM_LINE_SIZE], uint8_t count, sim_result_t *result)
+{
+    char setting[SIM_LINE_SIZE];
+    uint8_t line = 0;
+
+    settings_reset();
+    cnc_init();
+    cnc_unlock();
+    for (uint8_t i = 0; i < SIM_AXIS; i++)
+    {
+        sprintf(setting, "$%u=%.0f", 110 + i, machine->feed[i]);
+        sim_send_line(setting);
+        parser_read_command();
+        sprintf(setting, "$%u=%.0f", 120 + i, machine->accel[i]);
+        sim_send_line(setting);
+        parser_read_command();
+    }
+
+    while (setup && *setup)
+    {
+        sim_send_line(*setup++);
+        parser_read_command();
+    }
+
+    for (;;)
+    {
+        if (serial_rx_is_empty() && line < count)
+        {
+            sim_send_line(lines[line++]);
+        }
+
+        if (!serial_rx_is_empty())
+        {
+            parser_read_command();
+        }
+        else if (planner_buffer_is_empty() && !cnc_get_exec_state(EXEC_RUN) && line == count)
+        {
+            break;
+        }
+
+        if (!cnc_doevents())
+        {
+            break;
+        }
+    }
+
+    result->time = sim_motion_time;
+    result->alarm = cnc_get_exec_state(EXEC_ALARM);
+    //position of the steppers
+    uint32_t steps[STEPPER_COUNT];
+    itp_get_rt_position(steps);
+    for (uint8_t i = 0; i < SIM_AXIS; i++)
+    {
+        result->position[i] = (int32_t)steps[i] / g_settings.step_per_mm[i];
+    }
+}
+
+//runs each simulation with a fresh µCNC
+static sim_result_t sim_fork(const sim_machine_t *machine, const char *const *setup, char lines[][SIM_LINE_SIZE], uint8_t count)
+{
+    sim_result_t *shared = mmap(NULL, sizeof(sim_result_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    memset(shared, 0, sizeof(sim_result_t));
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        sim_run(machine, setup, lines, count, shared);
+        exit(0);
+    }
+
+    waitpid(pid, NULL, 0);
+    sim_result_t result = *shared;
+    munmap(shared, sizeof(sim_result_t));
+    return result;
+}
+
+//time of an axis moving alone (trapezoidal or triangular profile)
+static double sim_axis_time(float distance, float feed, float accel)
+{
+    double v = feed / 60.0;
+    if (distance >= v * v / accel)
+    {
+        return distance / v + v / accel;
+    }
+
+    return 2 * sqrt(distance / accel);
+}
+
+static int sim_move(const sim_machine_t *machine, const float *target)
+{
+    char lines[SIM_AXIS + 1][SIM_LINE_SIZE];
+    char name[SIM_LINE_SIZE];
+    //time of each axis at its maximum rate
+    double axis_time[SIM_AXIS];
+    double independent = 0;
+
+    for (uint8_t i = 0; i < SIM_AXIS; i++)
+    {
+        axis_time[i] = fabsf(target[i]) * 60.0 / machine->feed[i];
+        if (target[i] != 0)
+        {
+            independent = fmax(independent, sim_axis_time(fabsf(target[i]), machine->feed[i], machine->accel[i]));
+        }
+    }
+
+    //rapid motion
+    strcpy(lines[0], "G90 G21");
+    sprintf(lines[1], "G0 X%.3f Y%.3f Z%.3f", target[0], target[1], target[2]);
+    sprintf(name, "X%g Y%g Z%g", target[0], target[1], target[2]);
+    sim_result_t rapid = sim_fork(machine, NULL, lines, 2);
+
+    //straight line
+    sprintf(lines[1], "G1 X%.3f Y%.3f Z%.3f F100000", target[0], target[1], target[2]);
+    sim_result_t straight = sim_fork(machine, NULL, lines, 2);
+
+    //dogleg (a block ends each time an axis reaches its target)
+    uint8_t count = 1;
+    double block_end = 0;
+    for (;;)
+    {
+        double t = 0;
+        for (uint8_t i = 0; i < SIM_AXIS; i++)
+        {
+            if (axis_time[i] > block_end && (t == 0 || axis_time[i] < t))
+            {
+                t = axis_time[i];
+            }
+        }
+
+        if (t == 0)
+        {
+            break;
+        }
+
+        float end[SIM_AXIS];
+        for (uint8_t i = 0; i < SIM_AXIS; i++)
+        {
+            end[i] = (axis_time[i] <= t) ? target[i] : copysignf(machine->feed[i] / 60.0f * t, target[i]);
+        }
+        sprintf(lines[count++], "G1 X%.3f Y%.3f Z%.3f F100000", end[0], end[1], end[2]);
+        block_end = t;
+    }
+    sim_result_t dogleg = sim_fork(machine, NULL, lines, count);
+
+    bool pass = (rapid.time < straight.time * 1.01) && !rapid.alarm;
+    for (uint8_t i = 0; i < SIM_AXIS; i++)
+    {
+        pass = pass && (fabsf(rapid.position[i] - target[i]) < 0.001f);
+    }
+
+    printf("%-16s %-9s %9.3f %9.3f %9.3f %12.3f %+9.1f%% %s\n", name, machine->name, straight.time, dogleg.time, rapid.time, independent, (rapid.time / straight.time - 1) * 100, (pass) ? "pass" : "FAIL");
+    return (pass) ? 0 : 1;
+}
+
+//the target is outside the soft limits (the alarm is raised without any motion)
+static int sim_soft_limits(const sim_machine_t *machine)
+{
+    //the soft limits need the homing enabled ($X unlocks without homing)
+    //the Y travel is 45mm and the independent axes would move most of the way before reaching it
+    const char *const setup[] = {"$22=1", "$20=1", "$131=45", "$X", NULL};
+    char lines[2][SIM_LINE_SIZE] = {"G90 G21", "G0 X50 Y50"};
+    sim_result_t result = sim_fork(machine, setup, lines, 2);
+    bool pass = result.alarm && result.time == 0 && result.position[0] == 0 && result.position[1] == 0;
+    printf("soft limits %-4s %-9s alarm %u time %.3f position %.3f %.3f %s\n", "", machine->name, result.alarm, result.time, result.position[0], result.position[1], (pass) ? "pass" : "FAIL");
+    return (pass) ? 0 : 1;
+}
+
+int main(void)
+{
+    static const sim_machine_t machines[] = {
+        {"same", {5000, 3000, 1000}, {200, 150, 50}},
+        {"mixed", {5000, 3000, 1000}, {200, 400, 50}},
+        {"opposite", {6000, 1500, 1000}, {50, 500, 50}},
+    };
+    static const float moves[][SIM_AXIS] = {{50, 10, 0}, {50, 50, 0}, {50, 40, 3}, {100, 30, 0}, {10, 100, 0}, {200, 20, -5}};
+    int errors = 0;
+
+    printf("%-16s %-9s %9s %9s %9s %12s %10s\n", "G0 (s)", "limits", "straight", "dogleg", "G0", "independent", "G0 gain");
+    for (uint8_t m = 0; m < sizeof(machines) / sizeof(machines[0]); m++)
+    {
+        for (uint8_t i = 0; i < sizeof(moves) / sizeof(moves[0]); i++)
+        {
+            errors += sim_move(&machines[m], moves[i]);
+        }
+    }
+
+    errors += sim_soft_limits(&machines[2]);
+    printf("%d errors\n", errors);
+    return (errors) ? 1 : 0;
+}
@@ -0,0 +1,603 @@
+/*
+	Name: streaming.c
+	Description: Host simulation of the G-code streaming throughput with send and wait (wait for ok before sending the next line) and with character counting.
+		The µCNC core runs against a simulated MCU. The serial link transfers one char each 10 bits at BAUD (the µCNC UART calls the TX ISR at the end of each char) and the host answers each response after a fixed latency.
+		Each char is received at its arrival time, so the responses and the flow control chars are sent in between.
+		The character counting host keeps up to 128 chars (RX free bytes of the Bf status field) of unanswered lines in the µCNC RX buffer.
+		The flood host ignores the flow control. The lines that don't fit in the µCNC RX buffer are discarded (never partially executed) and each discarded line is answered with an overflow error (error:11).
+			With ENABLE_BINARY_PROTOCOL the binary host encodes each line in a binary frame ($B) and uses character counting.
+			With ENABLE_XONXOFF_FLOW_CONTROL or ENABLE_RTS_FLOW_CONTROL the flow control host sends without waiting for the responses and stops while the µCNC flow control is stopped (the host UART FIFO still sends up to 16 chars).
+	The file is streamed in check mode ($C - protocol throughput only) and with motion.
+
+	Build and run from this folder (add -DENABLE_BINARY_PROTOCOL to test the binary protocol and -DENABLE_XONXOFF_FLOW_CONTROL or -DENABLE_RTS_FLOW_CONTROL to test the flow control)
+		gcc -O2 -std=gnu99 -I../../uCNC -DBOARD=BOARD_VIRTUAL -D__SIMUL__ -DFORCE_SOFT_POLLING streaming.c ../../uCNC/[a-z]*.c -Wl,--wrap=io_controls_isr -lm -o streaming
+		./streaming [file] [host latency in ms]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "config.h"
+#include "mcudefs.h"
+#include "mcu.h"
+#include "settings.h"
+#include "serial.h"
+#include "interpolator.h"
+#include "cnc.h"
+#include "planner.h"
+#include "parser.h"
+#include "protocol.h"
+#include "motion_control.h"
+
+#define HOST_SEND_AND_WAIT 0
+#define HOST_CHAR_COUNTING 1
+#define HOST_FLOOD 2
+#define HOST_BINARY 3
+#define HOST_FLOW_CONTROL 4
+
+#define HOST_RX_WINDOW 128
+#define HOST_FIFO_SIZE 16
+#define HOST_MAX_LINES 4096
+#define HOST_LINE_SIZE 128
+#define LINK_QUEUE_SIZE 65536
+
+//simulated MCU
+VIRTUAL_MAP virtualmap;
+virtports_t virtualports = &virtualmap;
+static uint8_t eeprom[4096];
+static bool pulse_enabled;
+static uint32_t pulse_period;
+
+void mcu_init(void) {}
+void mcu_enable_probe_isr(void) {}
+void mcu_disable_probe_isr(void) {}
+uint8_t mcu_get_analog(uint8_t channel) { return 0; }
+void mcu_set_pwm(uint8_t pwm, uint8_t value) {}
+uint8_t mcu_get_pwm(uint8_t pwm) { return 0; }
+char mcu_getc(void) { return 0; }
+void mcu_enable_interrupts(void) {}
+void mcu_disable_interrupts(void) {}
+//the step ISR timer counts microseconds
+void mcu_freq_to_clocks(float frequency, uint16_t *ticks, uint16_t *tick_reps)
+{
+    uint32_t period = (uint32_t)(1000000.0f / frequency);
+    *tick_reps = (uint16_t)(period >> 16) + 1;
+    *ticks = (uint16_t)(period / *tick_reps);
+}
+void mcu_start_step_ISR(uint16_t ticks, uint16_t tick_reps)
+{
+    pulse_period = (uint32_t)ticks * tick_reps;
+    pulse_enabled = true;
+}
+void mcu_change_step_ISR(uint16_t ticks, uint16_t tick_reps) { mcu_start_step_ISR(ticks, tick_reps); }
+void mcu_step_stop_ISR(void) { pulse_enabled = false; }
+void mcu_delay_ms(uint16_t ms) {}
+uint8_t mcu_eeprom_getc(uint16_t address) { return eeprom[address & 4095]; }
+void mcu_eeprom_putc(uint16_t address, uint8_t value) { eeprom[address & 4095] = value; }
+void mcu_eeprom_erase(uint16_t address) {}
+
+//serial link (each char arrives at the end of its transfer)
+typedef struct
+{
+    unsigned char c[LINK_QUEUE_SIZE];
+    double time[LINK_QUEUE_SIZE];
+    uint32_t head;
+    uint32_t tail;
+    double busy_until;
+} link_t;
+
+static double sim_time;
+static double char_time;
+static link_t host_to_mcu;
+static link_t mcu_to_host;
+
+//the transfer starts at the given time (or when the link is free)
+static void link_put(link_t *link, unsigned char c, double time)
+{
+    link->busy_until = ((link->busy_until > time) ? link->busy_until : time) + char_time;
+    link->c[link->head % LINK_QUEUE_SIZE] = c;
+    link->time[link->head % LINK_QUEUE_SIZE] = link->busy_until;
+    link->head++;
+}
+
+static bool link_get(link_t *link, unsigned char *c)
+{
+    if (link->tail == link->head || link->time[link->tail % LINK_QUEUE_SIZE] > sim_time)
+    {
+        return false;
+    }
+
+    *c = link->c[link->tail % LINK_QUEUE_SIZE];
+    link->tail++;
+    return true;
+}
+
+//the UART sends one char at a time and calls the TX ISR at the end of each char
+static bool tx_enabled;
+static double tx_time;
+
+void mcu_start_send(void)
+{
+    if (!tx_enabled)
+    {
+        tx_enabled = true;
+        tx_time = (mcu_to_host.busy_until > sim_time) ? mcu_to_host.busy_until : sim_time;
+    }
+}
+
+void mcu_stop_send(void)
+{
+    tx_enabled = false;
+}
+
+void mcu_putc(char c)
+{
+    link_put(&mcu_to_host, (unsigned char)c, tx_time);
+}
+
+static void mcu_tx_update(void)
+{
+    while (tx_enabled && tx_time <= sim_time)
+    {
+        uint32_t head = mcu_to_host.head;
+        serial_tx_isr();
+        if (head == mcu_to_host.head)
+        {
+            break;
+        }
+        tx_time = mcu_to_host.busy_until;
+    }
+}
+
+//simulated host
+static char host_lines[HOST_MAX_LINES][HOST_LINE_SIZE];
+static unsigned char host_data[HOST_MAX_LINES][HOST_LINE_SIZE];
+static uint8_t host_size[HOST_MAX_LINES];
+static uint16_t host_line_count;
+static uint16_t host_setup_count;
+static uint8_t host_mode;
+static double host_latency;
+static uint16_t host_sent;
+#if (defined(ENABLE_XONXOFF_FLOW_CONTROL) || defined(ENABLE_RTS_FLOW_CONTROL))
+static uint8_t host_sent_chars;
+static bool host_stopped;
+#endif
+static uint16_t host_answered;
+static uint16_t host_errors;
+static uint32_t host_bytes;
+static uint16_t host_window[HOST_MAX_LINES];
+static uint16_t host_window_chars;
+static double host_ready_time;
+static char host_response[256];
+static uint8_t host_response_len;
+static char host_status[256];
+static double motion_time;
+static double starved_time;
+
+static void host_send_line(void)
+{
+    for (uint8_t i = 0; i < host_size[host_sent]; i++)
+    {
+        link_put(&host_to_mcu, host_data[host_sent][i], sim_time);
+    }
+    host_bytes += host_size[host_sent];
+    host_window[host_sent] = host_size[host_sent];
+    host_window_chars += host_size[host_sent++];
+}
+
+#if (defined(ENABLE_XONXOFF_FLOW_CONTROL) || defined(ENABLE_RTS_FLOW_CONTROL))
+static void host_send_char(void)
+{
+    link_put(&host_to_mcu, host_data[host_sent][host_sent_chars++], sim_time);
+    host_bytes++;
+    if (host_sent_chars == host_size[host_sent])
+    {
+        host_sent_chars = 0;
+        host_window[host_sent] = host_size[host_sent];
+        host_window_chars += host_size[host_sent++];
+    }
+}
+#endif
+
+//binary frame encoding (see parser_fetch_frame)
+static int32_t host_axis[6];
+
+static uint8_t host_encode_int(unsigned char *data, uint8_t tag, int32_t value, bool delta)
+{
+    uint8_t size = (value >= -128 && value <= 127) ? 1 : ((value >= -32768 && value <= 32767) ? 2 : 3);
+    if (value < -8388608 || value > 8388607)
+    {
+        return 0;
+    }
+
+    data[0] = tag | ((size - 1 + ((delta) ? 4 : 0)) << 5);
+    for (uint8_t i = 0; i < size; i++)
+    {
+        data[i + 1] = (unsigned char)(value >> (8 * i));
+    }
+    return size + 1;
+}
+
+static uint8_t host_encode_word(unsigned char *data, char word, float value)
+{
+    uint8_t tag = word - '@';
+    int8_t axis = (word >= 'X') ? (word - 'X') : ((word <= 'C') ? (word - 'A' + 3) : -1);
+    float scale = (strchr("XYZABCIJKR", word)) ? 1000.0f : 1.0f;
+    int32_t intval = (int32_t)lroundf(value * scale);
+    uint8_t size = 0;
+
+    if (word == 'G' || word == 'M')
+    {
+        uint8_t code = (uint8_t)floorf(value);
+        uint8_t mantissa = (uint8_t)lroundf((value - code) * 100.0f);
+        if (!mantissa)
+        {
+            return host_encode_int(data, tag, code, false);
+        }
+        data[0] = tag | (7 << 5);
+        data[1] = code;
+        data[2] = mantissa;
+        return 3;
+    }
+
+    if (fabsf(intval - value * scale) < 0.001f)
+    {
+        if (axis >= 0)
+        {
+            size = host_encode_int(data, tag, intval - host_axis[axis], true);
+            host_axis[axis] = intval;
+        }
+        else
+        {
+            size = host_encode_int(data, tag, intval, false);
+        }
+    }
+
+    if (!size)
+    {
+        data[0] = tag | (3 << 5);
+        memcpy(&data[1], &value, sizeof(float));
+        size = 5;
+        if (axis >= 0)
+        {
+            host_axis[axis] = (int32_t)lroundf(value * 1000.0f);
+        }
+    }
+
+    return size;
+}
+
+//encodes a line in a binary frame (returns 0 if the line has no words)
+static uint8_t host_encode_line(unsigned char *frame, const char *line)
+{
+    uint8_t length = 0;
+    while (*line)
+    {
+        char word = toupper(*line++);
+        if (word == '(')
+        {
+            while (*line && *line++ != ')')
+                ;
+            continue;
+        }
+
+        if (word < 'A' || word > 'Z')
+        {
+            continue;
+        }
+
+        char *end;
+        float value = strtof(line, &end);
+        line = end;
+        length += host_encode_word(&frame[2 + length], word, value);
+    }
+
+    if (!length)
+    {
+        return 0;
+    }
+
+    frame[0] = STX;
+    frame[1] = length;
+    frame[2 + length] = length;
+    for (uint8_t i = 0; i < length; i++)
+    {
+        frame[2 + length] ^= frame[2 + i];
+    }
+    return length + 3;
+}
+
+static void host_update(void)
+{
+    unsigned char c;
+    while (link_get(&mcu_to_host, &c))
+    {
+        if (c == '\r')
+        {
+            continue;
+        }
+
+#ifdef ENABLE_XONXOFF_FLOW_CONTROL
+        if (c == XOFF || c == XON)
+        {
+            host_stopped = (c == XOFF);
+            continue;
+        }
+#endif
+
+        if (c != '\n')
+        {
+            if (host_response_len < sizeof(host_response) - 1)
+            {
+                host_response[host_response_len++] = c;
+            }
+            continue;
+        }
+
+        host_response[host_response_len] = 0;
+        host_response_len = 0;
+        if (host_response[0] == '<')
+        {
+            strcpy(host_status, host_response);
+        }
+        else if ((!strcmp(host_response, "ok") || !strncmp(host_response, "error", 5)) && host_answered < host_sent)
+        {
+            if (host_response[0] == 'e')
+            {
+                host_errors++;
+            }
+            //the answered line leaves the RX buffer
+            host_window_chars -= host_window[host_answered++];
+            host_ready_time = sim_time + host_latency;
+        }
+    }
+
+#if (defined(ENABLE_XONXOFF_FLOW_CONTROL) || defined(ENABLE_RTS_FLOW_CONTROL))
+    if (host_mode == HOST_FLOW_CONTROL)
+    {
+#ifdef ENABLE_RTS_FLOW_CONTROL
+        host_stopped = (mcu_get_output(RTS) != 0);
+#endif
+        //the host UART FIFO is filled while the flow control allows it
+        while (host_sent < host_line_count && !host_stopped && host_to_mcu.busy_until < sim_time + HOST_FIFO_SIZE * char_time)
+        {
+            host_send_char();
+        }
+        return;
+    }
+#endif
+
+    if (sim_time < host_ready_time)
+    {
+        return;
+    }
+
+    while (host_sent < host_line_count)
+    {
+        switch (host_mode)
+        {
+        case HOST_SEND_AND_WAIT:
+            if (host_answered != host_sent)
+            {
+                return;
+            }
+            break;
+        case HOST_BINARY:
+            //the settings lines (and $B) are sent with send and wait
+            if (host_sent <= host_setup_count && host_answered != host_sent)
+            {
+                return;
+            }
+            //falls through
+        case HOST_CHAR_COUNTING:
+            if (host_window_chars + host_size[host_sent] > HOST_RX_WINDOW)
+            {
+                return;
+            }
+            break;
+        }
+        host_send_line();
+    }
+}
+
+extern void __real_io_controls_isr(void);
+void __wrap_io_controls_isr(void)
+{
+    unsigned char c;
+    if (pulse_enabled)
+    {
+        itp_step_isr();
+        itp_step_reset_isr();
+        sim_time += pulse_period * 0.000001;
+        motion_time += pulse_period * 0.000001;
+    }
+    else
+    {
+        sim_time += 0.00001;
+        //the machine waits for commands that are still being sent
+        if (host_sent < host_line_count || host_to_mcu.tail != host_to_mcu.head)
+        {
+            starved_time += 0.00001;
+        }
+    }
+
+    //the chars are received at their arrival time (the responses and the flow control chars are sent in between)
+    double end = sim_time;
+    while (host_to_mcu.tail != host_to_mcu.head && host_to_mcu.time[host_to_mcu.tail % LINK_QUEUE_SIZE] <= end)
+    {
+        sim_time = host_to_mcu.time[host_to_mcu.tail % LINK_QUEUE_SIZE];
+        link_get(&host_to_mcu, &c);
+        serial_rx_isr(c);
+        mcu_tx_update();
+        host_update();
+    }
+
+    sim_time = end;
+    mcu_tx_update();
+    host_update();
+    __real_io_controls_isr();
+}
+
+static bool host_load(const char *file, uint8_t mode, bool checkmode)
+{
+    char line[HOST_LINE_SIZE];
+    FILE *fp = fopen(file, "r");
+    if (!fp)
+    {
+        return false;
+    }
+
+    host_line_count = 0;
+    strcpy(host_lines[host_line_count++], "$10=3");
+    if (checkmode)
+    {
+        strcpy(host_lines[host_line_count++], "$C");
+    }
+    if (mode == HOST_BINARY)
+    {
+        strcpy(host_lines[host_line_count++], "$B");
+    }
+    host_setup_count = host_line_count;
+
+    for (uint16_t i = 0; i < host_line_count; i++)
+    {
+        host_size[i] = sprintf((char *)host_data[i], "%s\n", host_lines[i]);
+    }
+
+    memset(host_axis, 0, sizeof(host_axis));
+    while (fgets(line, sizeof(line), fp) && host_line_count < HOST_MAX_LINES)
+    {
+        //removes the line terminator and skips empty lines
+        line[strcspn(line, "\r\n")] = 0;
+        if (!line[0])
+        {
+            continue;
+        }
+
+        if (mode == HOST_BINARY)
+        {
+            //the lines without words (comments) are not sent
+            host_size[host_line_count] = host_encode_line(host_data[host_line_count], line);
+            if (!host_size[host_line_count])
+            {
+                continue;
+            }
+        }
+        else
+        {
+            host_size[host_line_count] = sprintf((char *)host_data[host_line_count], "%s\n", line);
+        }
+        strcpy(host_lines[host_line_count++], line);
+    }
+
+    fclose(fp);
+    return true;
+}
+
+static void stream(const char *file, uint8_t mode, bool checkmode)
+{
+    static const char *mode_names[] = {"send and wait", "char counting", "flood", "binary", "flow control"};
+
+    host_load(file, mode, checkmode);
+    host_mode = mode;
+    host_ready_time = 0;
+    char_time = 10.0 / BAUD;
+    //stores the default settings (like a configured board)
+    settings_reset();
+    cnc_init();
+    cnc_unlock();
+
+    for (;;)
+    {
+        if (!serial_rx_is_empty())
+        {
+            uint8_t error = parser_read_command();
+            if (!error)
+            {
+                protocol_send_ok();
+            }
+            else
+            {
+                protocol_send_error(error);
+            }
+        }
+        else if (planner_buffer_is_empty())
+        {
+            mc_sync_flush(false);
+            //all lines were received and the motion ended
+            if (host_sent == host_line_count && host_to_mcu.tail == host_to_mcu.head && !cnc_get_exec_state(EXEC_RUN))
+            {
+                break;
+            }
+        }
+
+        if (!cnc_doevents())
+        {
+            break;
+        }
+    }
+
+    //requests the status report (with the buffer state)
+    protocol_send_status();
+    double end = sim_time;
+    while (tx_enabled || mcu_to_host.tail != mcu_to_host.head)
+    {
+        sim_time += char_time;
+        mcu_tx_update();
+        host_update();
+    }
+
+    //the settings lines are not counted
+    uint16_t lines = host_line_count - host_setup_count;
+    printf("%-6s %-14s %10.3f %10.1f %10.3f %8u %8u %8u %8u\n", (checkmode) ? "check" : "motion", mode_names[mode], end,
+           lines / end, starved_time, host_bytes, host_sent, host_answered, host_errors);
+    printf("       %s\n", host_status);
+}
+
+int main(int argc, char **argv)
+{
+    const char *file = (argc > 1) ? argv[1] : "../gcode/sample.ngc";
+    host_latency = ((argc > 2) ? atof(argv[2]) : 2.0) * 0.001;
+
+    if (!host_load(file, HOST_SEND_AND_WAIT, false))
+    {
+        printf("can't open %s\n", file);
+        return 1;
+    }
+
+    printf("%s at %d baud with a host latency of %.1fms\n", file, BAUD, host_latency * 1000.0);
+    printf("%-6s %-14s %10s %10s %10s %8s %8s %8s %8s\n", "run", "host", "time(s)", "lines/s", "starved(s)", "bytes", "sent", "answered", "errors");
+    for (uint8_t checkmode = 1; checkmode != 0xFF; checkmode--)
+    {
+        for (uint8_t mode = HOST_SEND_AND_WAIT; mode <= HOST_FLOW_CONTROL; mode++)
+        {
+#ifndef ENABLE_BINARY_PROTOCOL
+            if (mode == HOST_BINARY)
+            {
+                continue;
+            }
+#endif
+#if (!defined(ENABLE_XONXOFF_FLOW_CONTROL) && !defined(ENABLE_RTS_FLOW_CONTROL))
+            if (mode == HOST_FLOW_CONTROL)
+            {
+                continue;
+            }
+#endif
+            //each run starts with a fresh µCNC
+            fflush(stdout);
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                stream(file, mode, checkmode != 0);
+                return 0;
+            }
+            waitpid(pid, NULL, 0);
+        }
+    }
+
+    return 0;
+}
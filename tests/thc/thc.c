@@ -0,0 +1,230 @@
+/*
+	Name: thc.c
+	Description: Host simulation of the torch height control offset channel (ENABLE_THC).
+		The file is executed by the µCNC core (parser, planner and step ISR) against a simulated MCU.
+		The analog input is the arc voltage of a simulated torch that cuts a sloped plate (the voltage changes with the distance of the torch to the plate).
+		Each case reports the maximum height error during the cut, the offset added by the correction and the position kept after M103.
+			slope: the correction follows the plate (the offset is the plate rise)
+			repeated M102: a second M102 in the middle of the cut keeps the correction (the offset isn't restarted)
+			high step/mm: the correction rate above the int16 range (4000 step/mm at THC_MAX_FEED) is limited and not wrapped
+
+	Build and run from this folder
+		gcc -O2 -std=gnu99 -I../../uCNC -DBOARD=BOARD_VIRTUAL -D__SIMUL__ -DFORCE_SOFT_POLLING -DF_STEP_MAX=30000 -DENABLE_THC thc.c ../../uCNC/[a-z]*.c -Wl,--wrap=io_controls_isr -lm -o thc
+		./thc
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "config.h"
+#include "mcudefs.h"
+#include "mcu.h"
+#include "settings.h"
+#include "grbl_interface.h"
+#include "serial.h"
+#include "interpolator.h"
+#include "cnc.h"
+#include "planner.h"
+#include "parser.h"
+#include "motion_control.h"
+
+#ifndef ENABLE_THC
+#error "Build with -DENABLE_THC"
+#endif
+
+//plate rise along X (mm/mm), cut height (mm) and arc voltage change (analog units/mm)
+#define SIM_PLATE_SLOPE 0.02f
+#define SIM_CUT_HEIGHT 1.0f
+#define SIM_VOLTS_PER_MM 20.0f
+//the height error is measured after the correction settles
+#define SIM_SETTLE_X 40.0f
+#define SIM_MAX_HEIGHT_ERROR 0.1f
+
+//simulated MCU (the responses are discarded)
+VIRTUAL_MAP virtualmap;
+virtports_t virtualports = &virtualmap;
+static uint8_t eeprom[4096];
+static bool pulse_enabled;
+static uint32_t pulse_period;
+
+//torch position (mm)
+static float sim_x;
+static float sim_z;
+
+void mcu_init(void) {}
+void mcu_enable_probe_isr(void) {}
+void mcu_disable_probe_isr(void) {}
+//the arc voltage rises with the distance of the torch to the plate
+uint8_t mcu_get_analog(uint8_t channel)
+{
+    float height = sim_z - sim_x * SIM_PLATE_SLOPE;
+    float value = g_settings.thc_setpoint + (height - SIM_CUT_HEIGHT) * SIM_VOLTS_PER_MM;
+    return (uint8_t)lroundf(MIN(MAX(value, 0), 255));
+}
+void mcu_set_pwm(uint8_t pwm, uint8_t value) {}
+uint8_t mcu_get_pwm(uint8_t pwm) { return 0; }
+void mcu_start_send(void)
+{
+    for (uint16_t i = 0; i < TX_BUFFER_SIZE; i++)
+    {
+        serial_tx_isr();
+    }
+}
+void mcu_stop_send(void) {}
+void mcu_putc(char c) {}
+char mcu_getc(void) { return 0; }
+void mcu_enable_interrupts(void) {}
+void mcu_disable_interrupts(void) {}
+//the step ISR timer counts microseconds
+void mcu_freq_to_clocks(float frequency, uint16_t *ticks, uint16_t *tick_reps)
+{
+    uint32_t period = (uint32_t)(1000000.0f / frequency);
+    *tick_reps = (uint16_t)(period >> 16) + 1;
+    *ticks = (uint16_t)(period / *tick_reps);
+}
+void mcu_start_step_ISR(uint16_t ticks, uint16_t tick_reps)
+{
+    pulse_period = (uint32_t)ticks * tick_reps;
+    pulse_enabled = true;
+}
+void mcu_change_step_ISR(uint16_t ticks, uint16_t tick_reps) { mcu_start_step_ISR(ticks, tick_reps); }
+void mcu_step_stop_ISR(void) { pulse_enabled = false; }
+void mcu_delay_ms(uint16_t ms) {}
+uint8_t mcu_eeprom_getc(uint16_t address) { return eeprom[address & 4095]; }
+void mcu_eeprom_putc(uint16_t address, uint8_t value) { eeprom[address & 4095] = value; }
+void mcu_eeprom_erase(uint16_t address) {}
+
+static bool sim_cutting;
+static float sim_max_error;
+static float sim_offset;
+
+extern void __real_io_controls_isr(void);
+void __wrap_io_controls_isr(void)
+{
+    if (pulse_enabled)
+    {
+        uint32_t steps[STEPPER_COUNT];
+        itp_step_isr();
+        itp_step_reset_isr();
+        itp_get_rt_position(steps);
+        sim_x = (int32_t)steps[0] / g_settings.step_per_mm[0];
+        sim_z = (int32_t)steps[2] / g_settings.step_per_mm[2];
+        if (sim_cutting)
+        {
+            //the offset is kept until M103 restarts it
+            sim_offset = itp_thc_get_offset();
+            if (sim_x >= SIM_SETTLE_X)
+            {
+                float error = fabsf(sim_z - sim_x * SIM_PLATE_SLOPE - SIM_CUT_HEIGHT);
+                sim_max_error = MAX(sim_max_error, error);
+            }
+        }
+    }
+
+    __real_io_controls_isr();
+}
+
+typedef struct
+{
+    const char *line;
+    //the line is sent after the torch passes this X position
+    float wait_x;
+} sim_line_t;
+
+static void sim_send_line(const char *line)
+{
+    while (*line)
+    {
+        serial_rx_isr((unsigned char)*line++);
+    }
+    serial_rx_isr('\n');
+}
+
+static int sim_run(const char *name, const char *setup, float start_z, bool repeat)
+{
+    char start[32];
+    sprintf(start, "G0 X0 Z%.3f", start_z);
+    const sim_line_t program[] = {{"G21 G90 G94", 0}, {start, 0}, {"M102", 0}, {"G1 X100 F1500", 0}, {(repeat) ? "M102" : "", 50}, {"M103", 0}};
+    const char *setups[] = {"$110=3000", "$111=3000", "$112=3000", "$120=200", "$121=200", "$122=200", "$35=1", setup};
+    uint8_t line = 0;
+
+    settings_reset();
+    cnc_init();
+    cnc_unlock();
+    for (uint8_t i = 0; i < sizeof(setups) / sizeof(setups[0]); i++)
+    {
+        sim_send_line(setups[i]);
+        parser_read_command();
+    }
+
+    for (;;)
+    {
+        if (serial_rx_is_empty() && line < sizeof(program) / sizeof(program[0]) && sim_x >= program[line].wait_x)
+        {
+            //the cut starts with the correction
+            sim_cutting = (line >= 3);
+            sim_send_line(program[line++].line);
+        }
+
+        if (!serial_rx_is_empty())
+        {
+            if (parser_read_command() != STATUS_OK)
+            {
+                printf("error in line %u\n", line);
+            }
+        }
+        else if (planner_buffer_is_empty() && !cnc_get_exec_state(EXEC_RUN) && line == sizeof(program) / sizeof(program[0]))
+        {
+            break;
+        }
+
+        if (!cnc_doevents())
+        {
+            break;
+        }
+    }
+
+    //after M103 the corrected position is the current position
+    float axis[AXIS_COUNT];
+    mc_get_position(axis);
+    float rise = 100 * SIM_PLATE_SLOPE + SIM_CUT_HEIGHT - start_z;
+    bool pass = (sim_max_error < SIM_MAX_HEIGHT_ERROR && fabsf(sim_offset - rise) < SIM_MAX_HEIGHT_ERROR && fabsf(axis[2] - sim_z) < 0.001f);
+    printf("%-14s %10.4f %10.3f %10.3f %10.3f %s\n", name, sim_max_error, sim_offset, rise, axis[2], (pass) ? "pass" : "FAIL");
+    return (pass) ? 0 : 1;
+}
+
+int main(void)
+{
+    int errors = 0;
+    printf("plate rise %.1fmm over X100 at F1500 (cut height %.1fmm)\n", 100 * SIM_PLATE_SLOPE, SIM_CUT_HEIGHT);
+    printf("%-14s %10s %10s %10s %10s\n", "case", "max err", "offset", "expected", "end Z");
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        //each run starts with a fresh µCNC
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            switch (i)
+            {
+            case 0:
+                return sim_run("slope", "$102=200", SIM_CUT_HEIGHT, false);
+            case 1:
+                return sim_run("repeated M102", "$102=200", SIM_CUT_HEIGHT, true);
+            default:
+                //starts 1mm above the cut height (the correction runs at the maximum rate)
+                return sim_run("high step/mm", "$102=4000", SIM_CUT_HEIGHT + 1.0f, false);
+            }
+        }
+
+        int status;
+        waitpid(pid, &status, 0);
+        errors += (WIFEXITED(status) && !WEXITSTATUS(status)) ? 0 : 1;
+    }
+
+    printf("%d errors\n", errors);
+    return (errors) ? 1 : 0;
+}
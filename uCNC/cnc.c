@@ -79,27 +79,40 @@ void cnc_run(void)
         //process gcode commands
         if (!serial_rx_is_empty())
         {
-            uint8_t error = 0;
             //protocol_echo();
-            uint8_t c = serial_peek();
-            switch (c)
-            {
-            case EOL: //not necessary but faster to catch empty lines and windows newline (CR+LF)
-                serial_getc();
-                break;
-            default:
-                error = parser_read_command();
-                break;
-            }
+#ifdef ENABLE_BAUD_SWITCH
+            //only a line from the host confirms the baud rate switch (not a startup block)
+            bool host_line = (serial_get_select() == SERIAL_UART);
+#endif
+            uint8_t error = parser_read_command();
             if (!error)
             {
                 protocol_send_ok();
+#ifdef ENABLE_BAUD_SWITCH
+                if (host_line)
+                {
+                    serial_confirm_baudrate();
+                }
+#endif
             }
             else
             {
                 protocol_send_error(error);
             }
         }
+        else if (planner_buffer_is_empty())
+        {
+#ifdef ENABLE_G64_PATH_BLENDING
+            //no more motions to blend with (sends the motion kept by the path blending)
+            //the segmented motions can fill the planner and fail if the motion is aborted while waiting
+            if (mc_blend_flush())
+            {
+                break;
+            }
+#endif
+            //no more motions to carry the tool changes and synchronized outputs
+            mc_sync_flush(false);
+        }
     } while (cnc_doevents());
 
     cnc_clear_exec_state(EXEC_ABORT); //clears the abort flag
@@ -206,6 +219,12 @@ bool cnc_doevents(void)
 #endif
 
     cnc_exec_rt_commands(); //executes all pending realtime commands
+#ifdef ENABLE_PARSE_AHEAD
+    planner_queue_run(); //moves the queued motions to the planner
+#endif
+#ifdef ENABLE_BAUD_SWITCH
+    serial_switch_baudrate(); //switches the baud rate after the response is sent
+#endif
 
     //check security interlocking for any problem
     if (!cnc_check_interlocking())
@@ -232,6 +251,8 @@ void cnc_home(void)
 
     //unlocks the machine to go to offset
     cnc_unlock();
+    //the offset motion and the position reset are still part of the homing cycle (non linear kinematics home in the actuators space)
+    cnc_set_exec_state(EXEC_HOMING);
 
     float target[AXIS_COUNT];
     motion_data_t block_data;
@@ -246,6 +267,7 @@ void cnc_home(void)
     block_data.feed = g_settings.homing_fast_feed_rate;
     block_data.spindle = 0;
     block_data.dwell = 0;
+    block_data.motion_mode = MOTIONCONTROL_MODE_FEED;
     //starts offset and waits to finnish
     mc_line(target, &block_data);
     do
@@ -256,6 +278,8 @@ void cnc_home(void)
     //reset position
     itp_reset_rt_position();
     planner_resync_position();
+    cnc_clear_exec_state(EXEC_HOMING);
+    mc_resync_position();
     //invokes startup block execution
     SETFLAG(cnc_state.rt_cmd, RT_CMD_STARTUP_BLOCK0);
 }
@@ -359,6 +383,12 @@ void cnc_reset(void)
 
     //clear all systems
     itp_clear();
+#ifdef ENABLE_AUX_STEPPER
+    itp_aux_clear();
+#endif
+#ifdef ENABLE_THC
+    itp_thc_enable(false);
+#endif
     planner_clear();
     protocol_send_string(MSG_STARTUP);
     //tries to clear alarms or any active hold state
@@ -528,12 +558,8 @@ void cnc_exec_rt_commands(void)
         itp_update();
         if (planner_buffer_is_empty())
         {
-            motion_data_t block = {0};
-#ifdef USE_SPINDLE
-            block.coolant = planner_get_previous_coolant();
-            block.spindle = planner_get_previous_spindle_speed();
-#endif
-            mc_update_tools(&block);
+            //sends the tools (with the pending changes) in a block without motion
+            mc_sync_flush(true);
         }
     }
 }
@@ -29,9 +29,67 @@
 	Uses 1 start bit + 8 bit + 1 stop bit (no parity)
 */
 #define BAUD 115200
+/*
+	Baud rate switch
+	$U=<baud> switches the serial baud rate (ex: 500000, 1000000 or 2000000). The rates that the mcu can't generate with less than 2.5% error are refused
+	$U is only accepted while idle (error:8 otherwise)
+	The ok is sent at the current baud rate and the baud rate is switched after it's sent (and after the lines already received are executed)
+	The host should then switch to the new baud rate and send a line (an empty line is answered with ok)
+	If no line is answered with ok in BAUD_SWITCH_TIMEOUT ms the baud rate returns to the default BAUD (the realtime commands are still executed while waiting and the lines received at the wrong baud rate are answered with an error)
+	Uncomment to enable
+*/
+//#define ENABLE_BAUD_SWITCH
+#define BAUD_SWITCH_TIMEOUT 1000
 //uncomment to enable synchronized TX (used in USB VCP)
 //can be used in USART hardware but MCU will be ocuppied while sending every char
 //#define ENABLE_SYNC_TX
+/*
+	Serial flow control
+	The host is stopped when the RX buffer free space drops below SERIAL_FLOW_CONTROL_STOP chars and resumed when it recovers to SERIAL_FLOW_CONTROL_RESUME chars
+	The stop margin holds the chars the host sends until it stops. By default it's computed from the host UART FIFO size (SERIAL_FLOW_CONTROL_HOST_FIFO chars) and the host latency (SERIAL_FLOW_CONTROL_HOST_LATENCY ms) at BAUD
+	Software flow control sends the XOFF/XON chars ahead of the buffered responses (the XON/XOFF chars received are ignored). Needs the async TX (not available with ENABLE_SYNC_TX or USB VCP)
+	Hardware flow control sets the RTS pin (high stops the host). RTS must be assigned to a generic output in the board map (ex: #define RTS DOUT1) and connected to the host CTS
+	Uncomment to enable
+*/
+//#define ENABLE_XONXOFF_FLOW_CONTROL
+//#define ENABLE_RTS_FLOW_CONTROL
+//#define SERIAL_FLOW_CONTROL_HOST_FIFO 16
+//#define SERIAL_FLOW_CONTROL_HOST_LATENCY 1
+//#define SERIAL_FLOW_CONTROL_STOP 32
+//#define SERIAL_FLOW_CONTROL_RESUME 64
+/*
+	Binary protocol
+	$B changes the serial input to binary frames (the host should wait for the ok before sending the first frame)
+	Each frame carries a G-code line as pre-tokenized words with fixed point and delta encoded values (see parser.c)
+	An empty frame returns to the ASCII G-code. The realtime commands are still accepted between frames
+	Uncomment to enable
+*/
+//#define ENABLE_BINARY_PROTOCOL
+/*
+	Compressed stream
+	The $Z line starts a LZ77 compressed stream (the char after the line is already compressed). The decoded chars are handled as ASCII G-code
+		0x00 to 0x7F - literal char
+		0x81 to 0xFF followed by the distance (1 to 255) - copies (byte & 0x7F) chars decoded distance chars before (window of 256 chars)
+		0x80 followed by a byte - escaped byte (extended realtime commands) or 0x80 followed by 0x00 returns to the ASCII G-code
+	The realtime commands are only executed when sent as literal or escaped bytes (the chars copied by a match are never executed as realtime commands)
+	A reset also returns to the ASCII G-code. The host encoder is in tests/compressed_stream
+	The match is decoded in the RX ISR and its length is limited to STREAM_COMPRESSION_MAX_MATCH chars (the host encoder must use the same limit)
+	A longer match only updates the window and the lines it touches are discarded (answered with an overflow error)
+	Uncomment to enable
+*/
+//#define ENABLE_STREAM_COMPRESSION
+#ifdef ENABLE_STREAM_COMPRESSION
+#define STREAM_COMPRESSION_MAX_MATCH 32
+#endif
+/*
+	Serial buffers
+	Sets the RX and TX buffers sizes (the mcu can set larger default sizes)
+	Sizes above 255 use 16-bit indexes and power of two sizes wrap with a mask
+	A large RX buffer lets character counting hosts keep more lines in flight
+	Uncomment to override
+*/
+//#define RX_BUFFER_SIZE 1024
+//#define TX_BUFFER_SIZE 256
 
 /*
 	Choose the board
@@ -46,7 +104,9 @@
 	Defines the machine kynematics (cartesian, corexy, delta, custom, ...)
 	For custom/advanced configurations go to the specified kynematics header file
 */
+#ifndef MACHINE_KINEMATICS
 #define MACHINE_KINEMATICS MACHINE_CARTESIAN
+#endif
 
 /*
 	After the main blocks of the controller have been selected the configuration can be build
@@ -86,15 +146,29 @@
 /*
 	Number of seconds of delay before motions restart after releasing from a hold or after setting a new spindle speed
 	This is used by spindle to ensure spindle gets up to speed in motions
+	The delay after a spindle speed change is the speed change divided by the spindle acceleration ($44 in RPM/s)
+	DELAY_ON_SPINDLE_SPEED_CHANGE is used if $44 is 0
+	Only the feed motions wait for the spindle. Rapid motions run while the spindle changes speed
 */
 #define DELAY_ON_RESUME 4
 #define DELAY_ON_SPINDLE_SPEED_CHANGE 1
+//uncomment to end the wait for the spindle when this input is active (spindle at speed signal)
+//#define SPINDLE_AT_SPEED DIN0
 //#define LASER_MODE
 #endif
 
 //not implemented
 //#define USE_TOOL_CHANGER
 
+/*
+	Motion synchronized outputs
+	M62 P<n> and M63 P<n> turn the digital output DOUTn on and off at the start of the next motion (without stopping the motion)
+	M64 P<n> and M65 P<n> turn the digital output DOUTn on and off immediately
+	M67 P<n> L<value> and M68 P<n> L<value> set the PWM output PWMn (0 to 255) at the start of the next motion or immediately
+	Uncomment to enable
+*/
+//#define ENABLE_SYNC_OUTPUTS
+
 /*
 	Define a coolant flood and mist pin
 */
@@ -142,16 +216,46 @@
 //processes and displays the currently executing gcode numbered line
 //#define GCODE_PROCESS_LINE_NUMBERS
 
+//validates lines sent as N<line> ... *<checksum> (the checksum is the xor of all chars before the '*' as sent, including tabs)
+//each line number must follow the previous (M110 N<line> sets the previous line number) and a failed line is answered with a resend request (Resend: <line>) and an error
+//lines without checksum are not checked
+//#define ENABLE_LINE_CHECKSUM
+
 //processes comment as defined in the RS274NGC
 //#define PROCESS_COMMENTS
 
+//executes the lines with only axis words (and optional G0/G1, F and N words) in the current modal state without the full validation and order of execution
+//the offsets, units and tools are cached after each line that goes through the full parser
+//uncomment to enable
+//#define ENABLE_PARSER_FAST_PATH
+
 //accepts the E word (currently is processed has A)
+//to use the E word as an extruder axis enable ENABLE_EXTRUDER
 //#define GCODE_ACCEPT_WORD_E
 
 //set factor for countinuos mode (G64)
 //value must be set between 0.0 and 1.0 If set to 0.0 is the same as exact path mode (G61)
 #define G64_MAX_ANGLE_FACTOR 0.2f
 
+//enables G64 P<tolerance> path blending
+//the corner between two linear motions is replaced by a chord pair (two short lines) that deviates at most P from the programmed path
+//this keeps most of the speed through the corners. G64 without P keeps using G64_MAX_ANGLE_FACTOR
+//uncomment to enable
+//#define ENABLE_G64_PATH_BLENDING
+
+//rapid motions (G0) with each axis moving at its own maximum rate and acceleration (cartesian kinematics only)
+//the straight line rapid is clamped by the most limited axis and is slower if one axis limits the feed and another the acceleration
+//the axes profiles are sampled in RAPID_INDEPENDENT_AXIS_SEGMENTS short rapid motions and are only used if the straight line is slower by more than RAPID_INDEPENDENT_AXIS_MIN_GAIN
+//the soft limits are checked for the target before any motion (each axis only moves between the start and the target)
+//WARNING: the path isn't a straight line. An axis can reach its target long before the others (a G0 that lowers Z while moving in XY can reach the Z height before XY)
+//the tool can hit clamps or fixtures that the straight line clears. Retract and plunge Z in separate G0 motions
+//uncomment to enable
+//#define ENABLE_RAPID_INDEPENDENT_AXIS
+#ifdef ENABLE_RAPID_INDEPENDENT_AXIS
+#define RAPID_INDEPENDENT_AXIS_SEGMENTS 20
+#define RAPID_INDEPENDENT_AXIS_MIN_GAIN 0.05f
+#endif
+
 /*
 	Report specific options
 */
@@ -175,6 +279,17 @@
 //#define ENABLE_LINACT_COLD_START
 #endif
 
+/*
+	Parse ahead queue
+	When the planner buffer is full the next motions are computed, acknowledged and kept in a queue of PARSE_AHEAD_QUEUE_SIZE motions
+	The queued motions enter the planner as the planner blocks are executed. This keeps the parser running ahead of the planner
+	Uncomment to enable
+*/
+//#define ENABLE_PARSE_AHEAD
+#ifdef ENABLE_PARSE_AHEAD
+#define PARSE_AHEAD_QUEUE_SIZE 4
+#endif
+
 /*
 	If the type of machine need backlash compensation configure here
 */
@@ -187,6 +302,88 @@
 */
 #define DSS_MAX_OVERSAMPLING 0
 
+/*
+	Auxiliary stepper (tool changer carousel, pallet shuttle, etc...)
+	The auxiliary stepper is not part of the kinematics and has its own motion queue.
+	It shares the step ISR with the machine axis but runs independently from the coordinated motions.
+	M100 P<position> queues a motion of the auxiliary stepper (in mm or inches with G20 and can be negative) and M101 waits for the auxiliary motions to finish.
+	AUX_STEPPER must be a stepper (STEPn) not used by the kinematics.
+	Only one auxiliary stepper is supported (each auxiliary stepper would need its own motion queue and Bresenham line in the step ISR).
+*/
+//#define ENABLE_AUX_STEPPER
+#ifdef ENABLE_AUX_STEPPER
+#define AUX_STEPPER 3
+#define AUX_STEPS_PER_UNIT 200.0f
+#define AUX_MAX_FEED 500.0f	   //units/min
+#define AUX_ACCELERATION 10.0f //units/s^2
+#define AUX_BUFFER_SIZE 4
+#endif
+
+/*
+	Extruder axis (3D printing)
+	The E word drives the A axis. The extruder moves coordinated with the other axis but the feed is only set by the toolhead path.
+	The extruder has linear advance (pressure advance). The extruder position leads the nominal position by the extruder speed times $33 (in seconds)
+	to compensate the pressure in the nozzle. The advance is only applied in printing motions (extrusion with motion of the other axis).
+	AXIS_A must be defined in the kinematics and EXTRUDER_STEPPER must be the stepper that drives the A axis.
+*/
+//#define ENABLE_EXTRUDER
+#ifdef ENABLE_EXTRUDER
+#ifndef GCODE_ACCEPT_WORD_E
+#define GCODE_ACCEPT_WORD_E
+#endif
+#define EXTRUDER_STEPPER 3
+#endif
+
+/*
+	Input shaping
+	Reduces the machine frame vibrations (ringing) by convolving the motion of each stepper with a shaper (a sequence of delayed impulses).
+	The shaper frequency ($150 to $155 in Hz) and damping ratio ($160 to $165) are set for each stepper. A frequency of 0 disables the shaper.
+	The shaped motion lags the planned motion (up to a vibration period) and the corners are slightly rounded.
+	Input shaping doesn't support DSS and backlash compensation.
+*/
+//#define ENABLE_INPUT_SHAPING
+#ifdef ENABLE_INPUT_SHAPING
+//shaper type (SHAPER_ZV, SHAPER_ZVD or SHAPER_MZV)
+#ifndef INPUT_SHAPER
+#define INPUT_SHAPER SHAPER_ZVD
+#endif
+//number of segments kept to compute the shaped motion (each segment has up to 10ms and should cover the longest shaper delay)
+#define INPUT_SHAPING_HISTORY 16
+#endif
+
+/*
+	Torch height control (plasma cutting) or any other realtime axis offset
+	The analog input (arc voltage) is sampled at a fixed rate and the error to the setpoint ($34) times the gain ($35 in mm/s per analog unit)
+	sets the speed of a correction that is added to THC_STEPPER directly in the step ISR (without going through the planner).
+	The correction only runs while the steppers are moving and the THC_STEPPER has no planned motion.
+	M102 enables the correction and M103 disables it (after the motions finish) and keeps the corrected position as the current position.
+*/
+//#define ENABLE_THC
+#ifdef ENABLE_THC
+#define THC_STEPPER 2
+#define THC_ANALOG ANALOG0
+#define THC_SAMPLE_RATE 1000   //Hz
+#define THC_MAX_FEED 600.0f	   //mm/min
+#define THC_ACCELERATION 50.0f //mm/s^2
+#define THC_MAX_OFFSET 10.0f   //mm
+#endif
+
+/*
+	Adaptive feed
+	An analog input (spindle load) is sampled for each interpolator segment and the feed is scaled to keep the load at the setpoint ($36).
+	The feed scale changes at most ADAPTIVE_FEED_MAX_CHANGE percent per sample and is kept between ADAPTIVE_FEED_MIN and ADAPTIVE_FEED_MAX percent.
+	The scale is applied over the feed override and the rapid feed still limits the speed.
+	M52 (or M52 P1) enables the adaptive feed and M52 P0 (or M2/M30) disables it.
+*/
+//#define ENABLE_ADAPTIVE_FEED
+#ifdef ENABLE_ADAPTIVE_FEED
+#define ADAPTIVE_FEED_ANALOG ANALOG0
+#define ADAPTIVE_FEED_MIN 20.0f		   //percent
+#define ADAPTIVE_FEED_MAX 150.0f	   //percent
+#define ADAPTIVE_FEED_GAIN 0.05f	   //percent per analog unit of error (per sample)
+#define ADAPTIVE_FEED_MAX_CHANGE 1.0f //percent per sample
+#endif
+
 /*
 	Forces pin pooling for all limits and control pins (with or without interrupts)
 */
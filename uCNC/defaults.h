@@ -43,16 +43,37 @@
 #define DEFAULT_3_ACCEL 10
 #define DEFAULT_4_ACCEL 10
 #define DEFAULT_5_ACCEL 10
+//default acceleration factors of feed, rapid, jog and homing motions
+#define DEFAULT_FEED_ACCEL_FACTOR 1
+#define DEFAULT_RAPID_ACCEL_FACTOR 1
+#define DEFAULT_JOG_ACCEL_FACTOR 1
+#define DEFAULT_HOMING_ACCEL_FACTOR 1
 
 #define DEFAULT_HOMING_DIR_INV_MASK 0
 #define DEFAULT_HOMING_SLOW 10
 #define DEFAULT_HOMING_FAST 50
 #define DEFAULT_HOMING_OFFSET 2
+//probing cycle slow approach feed rate (mm/min) and retract distance (mm)
+#define DEFAULT_PROBE_SLOW 20
+#define DEFAULT_PROBE_RETRACT 2
+//extruder linear advance (s)
+#define DEFAULT_EXTRUDER_ADVANCE 0
+//torch height control analog setpoint and gain (mm/s per analog unit)
+#define DEFAULT_THC_SETPOINT 128
+#define DEFAULT_THC_GAIN 0.1
+//adaptive feed analog load setpoint
+#define DEFAULT_ADAPTIVE_FEED_LOAD 128
+//input shaper frequency (Hz - 0 disables the shaper) and damping ratio
+#define DEFAULT_SHAPER_FREQ 0
+#define DEFAULT_SHAPER_DAMPING 0.1
 
 //default max distance traveled by each axis in mm
 #define DEFAULT_X_MAX_DIST 200
 #define DEFAULT_Y_MAX_DIST 200
 #define DEFAULT_Z_MAX_DIST 200
+#define DEFAULT_A_MAX_DIST 360
+#define DEFAULT_B_MAX_DIST 360
+#define DEFAULT_C_MAX_DIST 360
 
 #define DEFAULT_STEP_INV_MASK 0
 #define DEFAULT_STEP_ENA_INV 0
@@ -74,6 +95,8 @@
 
 #define DEFAULT_SPINDLE_MAX_RPM 1000
 #define DEFAULT_SPINDLE_MIN_RPM 0
+//spindle acceleration (RPM/s - 0 uses the fixed delay DELAY_ON_SPINDLE_SPEED_CHANGE)
+#define DEFAULT_SPINDLE_ACCELERATION 1000
 
 #define DEFAULT_REPORT_INCHES 0
 #define DEFAULT_HOMING_ENABLED 0
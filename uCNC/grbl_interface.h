@@ -88,6 +88,8 @@
 #define STATUS_BAD_COMMENT_FORMAT 39
 #define STATUS_INVALID_TOOL 40
 #define STATUS_FEED_NOT_SET 41
+#define STATUS_LINE_CHECKSUM_FAIL 42
+#define STATUS_LINE_NUMBER_MISMATCH 43
 #define STATUS_CRITICAL_FAIL 255
 
 //special Grbl system commands return codes
@@ -103,6 +105,8 @@
 #define GRBL_HOME (GRBL_SYSTEM_CMD + 7)
 #define GRBL_HELP (GRBL_SYSTEM_CMD + 8)
 #define GRBL_JOG_CMD (GRBL_SYSTEM_CMD + 9)
+#define GRBL_BINARY_MODE (GRBL_SYSTEM_CMD + 10)
+#define GRBL_SET_LINE_NUMBER (GRBL_SYSTEM_CMD + 11)
 
 #define EXEC_ALARM_RESET					  0
 // Grbl alarm codes. Valid values (1-255). Zero is reserved.
@@ -36,6 +36,65 @@
 #error DSS_MAX_OVERSAMPLING invalid value! Should be set between 0 and 3
 #endif
 
+#ifdef ENABLE_AUX_STEPPER
+#if (AUX_STEPPER < STEPPER_COUNT || AUX_STEPPER > 5)
+#error AUX_STEPPER invalid value! Should be a stepper not used by the kinematics (between STEPPER_COUNT and 5)
+#endif
+#define AUX_STEP_MASK (1 << AUX_STEPPER)
+#define AUX_DIR_MASK (1 << AUX_STEPPER)
+//auxiliary stepper speed and acceleration in steps
+#define AUX_MAX_STEP_RATE MIN((AUX_MAX_FEED * AUX_STEPS_PER_UNIT / 60.0f), F_STEP_MAX)
+#define AUX_STEP_ACCELERATION (AUX_ACCELERATION * AUX_STEPS_PER_UNIT)
+#endif
+
+#ifdef ENABLE_EXTRUDER
+#ifndef AXIS_A
+#error The extruder needs the A axis to be defined
+#endif
+#if (EXTRUDER_STEPPER >= STEPPER_COUNT)
+#error EXTRUDER_STEPPER invalid value! Should be the stepper that drives the A axis
+#endif
+#if (defined(ENABLE_AUX_STEPPER) && (AUX_STEPPER == EXTRUDER_STEPPER))
+#error The auxiliary stepper and the extruder must use different steppers
+#endif
+#define EXTRUDER_STEP_MASK (1 << EXTRUDER_STEPPER)
+#define EXTRUDER_DIR_MASK (1 << EXTRUDER_STEPPER)
+#endif
+
+#ifdef ENABLE_THC
+#if (THC_STEPPER >= STEPPER_COUNT)
+#error THC_STEPPER invalid value! Should be a stepper used by the kinematics
+#endif
+#if (defined(ENABLE_AUX_STEPPER) && (AUX_STEPPER == THC_STEPPER))
+#error The auxiliary stepper and the torch height control must use different steppers
+#endif
+#if (defined(ENABLE_EXTRUDER) && (EXTRUDER_STEPPER == THC_STEPPER))
+#error The extruder and the torch height control must use different steppers
+#endif
+#define THC_STEP_MASK (1 << THC_STEPPER)
+#define THC_DIR_MASK (1 << THC_STEPPER)
+#define THC_SAMPLE_PERIOD (1000000UL / THC_SAMPLE_RATE)
+#endif
+
+#ifdef ENABLE_INPUT_SHAPING
+#if (DSS_MAX_OVERSAMPLING != 0)
+#error Input shaping is not compatible with DSS
+#endif
+#ifdef ENABLE_BACKLASH_COMPENSATION
+#error Input shaping is not compatible with backlash compensation
+#endif
+#define SHAPER_ZV 1
+#define SHAPER_ZVD 2
+#define SHAPER_MZV 3
+#if (INPUT_SHAPER == SHAPER_ZV)
+#define SHAPER_IMPULSES 2
+#elif (INPUT_SHAPER == SHAPER_ZVD || INPUT_SHAPER == SHAPER_MZV)
+#define SHAPER_IMPULSES 3
+#else
+#error INPUT_SHAPER invalid value! Should be SHAPER_ZV, SHAPER_ZVD or SHAPER_MZV
+#endif
+#endif
+
 #define F_INTEGRATOR 100
 #define INTEGRATOR_DELTA_T (1.0f / F_INTEGRATOR)
 //the amount of motion precomputed and stored for the step generator is never less then
@@ -80,6 +139,33 @@ typedef struct pulse_sgm_
 #endif
     float feed;
     bool update_speed;
+#if (defined(ENABLE_AUX_STEPPER) || defined(ENABLE_EXTRUDER))
+    //steppers driven by the segment instead of the block (Bresenham lines of n steps in total ISR ticks)
+    uint8_t dirbits;
+    uint32_t total;
+#endif
+#ifdef ENABLE_AUX_STEPPER
+    //the coordinated motion only steps in the ticks that match the oversampling mask
+    uint16_t aux_oversample_mask;
+    uint32_t aux_steps;
+    uint32_t aux_errors;
+#endif
+#ifdef ENABLE_EXTRUDER
+    uint32_t extruder_steps;
+    uint32_t extruder_errors;
+#endif
+#ifdef ENABLE_THC
+    //step ISR period (us)
+    uint16_t tick_us;
+#endif
+#ifdef ENABLE_SYNC_OUTPUTS
+    //outputs changed when the segment starts
+    planner_outputs_t outputs;
+#endif
+#ifdef SPINDLE_AT_SPEED
+    //the dwell ends when the spindle reaches the speed
+    bool spindle_wait;
+#endif
 } INTERPOLATOR_SEGMENT;
 
 //circular buffers
@@ -107,12 +193,95 @@ static volatile uint8_t itp_rt_spindle;
 //flag to force the interpolator to recalc entry and exit limit position of acceleration/deacceleration curves
 static bool itp_needs_update;
 static volatile bool itp_isr_finnished;
-#ifdef ENABLE_DUAL_DRIVE_AXIS
+#if (defined(ENABLE_DUAL_DRIVE_AXIS) || defined(KINEMATICS_LOCK_STEP_HOMING))
 volatile static uint8_t itp_step_lock;
 #endif
 
 static volatile bool itp_busy;
 
+#if (defined(ENABLE_AUX_STEPPER) || defined(ENABLE_EXTRUDER))
+//direction of the steppers driven by the last written segment
+static uint8_t itp_sgm_dirbits;
+#endif
+
+#ifdef ENABLE_SYNC_OUTPUTS
+//outputs of the processed planner blocks that change with the next written segment
+static planner_outputs_t itp_outputs;
+#endif
+
+#ifdef ENABLE_THC
+//realtime offset of the torch height control (not planned)
+static bool itp_thc_enabled;
+//correction speed (steps/s) and accumulated offset (steps)
+static volatile int16_t itp_thc_rate;
+static volatile int32_t itp_thc_offset;
+static int32_t itp_thc_errors;
+static uint8_t itp_thc_dirbits;
+//direction of the step outputs
+static uint8_t itp_rt_dirbits;
+//time (us) counted by the step ISR
+static volatile uint32_t itp_thc_clock;
+#endif
+
+#if (defined(ENABLE_AUX_STEPPER) || defined(ENABLE_INPUT_SHAPING))
+//dwell time (in integrator time windows) while the steppers are still running after the planned motions
+static uint32_t itp_dwell;
+#endif
+
+#ifdef SPINDLE_AT_SPEED
+//the dwell of the current planner block waits for the spindle speed
+static bool itp_spindle_wait;
+#endif
+
+#ifdef ENABLE_INPUT_SHAPING
+//shaper impulses (amplitude and delay) of each stepper
+static float itp_shaper_a[STEPPER_COUNT][SHAPER_IMPULSES];
+static float itp_shaper_t[STEPPER_COUNT][SHAPER_IMPULSES];
+//longest shaper delay and time since the planned motion stopped
+static float itp_shaper_delay;
+static float itp_shaper_settle;
+//planned motion of the block being processed
+static uint32_t itp_shaper_total;
+static int32_t itp_shaper_start[STEPPER_COUNT];
+//planned position at the end of the last segments and duration of each segment
+static int32_t itp_shaper_hist_pos[INPUT_SHAPING_HISTORY][STEPPER_COUNT];
+static float itp_shaper_hist_time[INPUT_SHAPING_HISTORY];
+static uint8_t itp_shaper_hist_head;
+static uint8_t itp_shaper_hist_count;
+//shaped position after the processed segments
+static int32_t itp_shaper_pos[STEPPER_COUNT];
+#endif
+
+#ifdef ENABLE_EXTRUDER
+//extruder motion of the block being processed (the extruder steps are generated in each segment)
+static uint32_t itp_extruder_steps;
+static uint32_t itp_extruder_total;
+static bool itp_extruder_negative;
+//advance steps per step/s of the block
+static float itp_extruder_advance;
+//nominal extruder position at the start of the block and extruder position after the processed segments
+static int32_t itp_extruder_start;
+static int32_t itp_extruder_pos;
+#endif
+
+#ifdef ENABLE_AUX_STEPPER
+//auxiliary stepper motion queue (relative motions in steps)
+static int32_t itp_aux_data[AUX_BUFFER_SIZE];
+static uint8_t itp_aux_data_write;
+static uint8_t itp_aux_data_read;
+static volatile uint8_t itp_aux_data_slots;
+//auxiliary stepper motion being executed
+static uint32_t itp_aux_remaining;
+static uint8_t itp_aux_dirbits;
+static uint8_t itp_aux_sgm_oversample;
+static float itp_aux_speed;
+static float itp_aux_partial;
+//auxiliary stepper position after all queued motions, after the processed segments and realtime position
+static int32_t itp_aux_pos;
+static int32_t itp_aux_step_pos;
+static volatile int32_t itp_rt_aux_pos;
+#endif
+
 /*
 	Interpolator segment buffer functions
 */
@@ -127,6 +296,18 @@ static inline void itp_sgm_buffer_read(void)
 
 static inline void itp_sgm_buffer_write(void)
 {
+#if (defined(ENABLE_AUX_STEPPER) || defined(ENABLE_EXTRUDER))
+    //direction changes are updated by the step ISR
+    if (itp_sgm_dirbits != itp_sgm_data[itp_sgm_data_write].dirbits)
+    {
+        itp_sgm_dirbits = itp_sgm_data[itp_sgm_data_write].dirbits;
+        itp_sgm_data[itp_sgm_data_write].update_speed = true;
+    }
+#endif
+#ifdef ENABLE_SYNC_OUTPUTS
+    itp_sgm_data[itp_sgm_data_write].outputs = itp_outputs;
+    memset(&itp_outputs, 0, sizeof(planner_outputs_t));
+#endif
     itp_sgm_data_slots--;
     if (++itp_sgm_data_write == INTERPOLATOR_BUFFER_SIZE)
     {
@@ -150,6 +331,19 @@ static inline void itp_sgm_clear(void)
     itp_sgm_data_read = 0;
     itp_sgm_data_slots = INTERPOLATOR_BUFFER_SIZE;
     memset(itp_sgm_data, 0, sizeof(itp_sgm_data));
+#if (defined(ENABLE_AUX_STEPPER) || defined(ENABLE_EXTRUDER))
+    itp_sgm_dirbits = 0xFF;
+#endif
+}
+
+//sets the step ISR frequency of the segment
+static void itp_sgm_set_frequency(INTERPOLATOR_SEGMENT *sgm, float frequency)
+{
+    mcu_freq_to_clocks(frequency, &(sgm->timer_counter), &(sgm->timer_prescaller));
+#ifdef ENABLE_THC
+    frequency = MIN(MAX(frequency, F_STEP_MIN), F_STEP_MAX);
+    sgm->tick_us = (uint16_t)MIN(1000000.0f / frequency, 65535.0f);
+#endif
 }
 
 /*
@@ -194,6 +388,618 @@ static inline void itp_blk_clear(void)
     memset(itp_blk_data, 0, sizeof(itp_blk_data));
 }
 
+//sets the tools of a segment without motion (dwell)
+static void itp_sgm_nomotion(INTERPOLATOR_SEGMENT *sgm)
+{
+    sgm->feed = 0;
+#ifdef USE_SPINDLE
+#ifdef LASER_MODE
+    if (g_settings.laser_mode)
+    {
+        sgm->spindle = 0;
+        sgm->spindle_inv = false;
+    }
+    else
+    {
+        planner_get_spindle_speed(1, &(sgm->spindle), &(sgm->spindle_inv));
+    }
+#else
+    planner_get_spindle_speed(1, &(sgm->spindle), &(sgm->spindle_inv));
+#endif
+#endif
+#if (defined(ENABLE_AUX_STEPPER) || defined(ENABLE_EXTRUDER))
+    sgm->dirbits = 0;
+#endif
+#ifdef ENABLE_EXTRUDER
+    sgm->extruder_steps = 0;
+    sgm->extruder_errors = 0;
+#endif
+}
+
+/*
+	Extruder functions
+*/
+#ifdef ENABLE_EXTRUDER
+//the discarded segments are lost and the extruder resumes from the real position
+static void itp_extruder_resync(void)
+{
+    itp_extruder_start = (int32_t)itp_rt_step_pos[EXTRUDER_STEPPER];
+    itp_extruder_pos = itp_extruder_start;
+    itp_extruder_steps = 0;
+    itp_extruder_advance = 0;
+}
+
+//computes the extruder motion in the time window of the segment
+//the extruder follows the nominal position of the block plus the advance at the segment exit speed
+static void itp_extruder_segment(INTERPOLATOR_SEGMENT *sgm, uint32_t remaining, float speed)
+{
+    uint32_t steps = itp_extruder_steps;
+    if (remaining)
+    {
+        steps = (uint32_t)floorf((float)itp_extruder_steps * (float)(itp_extruder_total - remaining) / (float)itp_extruder_total);
+    }
+
+    int32_t target = itp_extruder_start + ((itp_extruder_negative) ? -(int32_t)steps : (int32_t)steps);
+    target += (int32_t)lroundf(itp_extruder_advance * speed);
+    target -= itp_extruder_pos;
+
+    sgm->dirbits &= ~EXTRUDER_DIR_MASK;
+    if (target < 0)
+    {
+        sgm->dirbits |= EXTRUDER_DIR_MASK;
+        target = -target;
+    }
+
+    //the step ISR can't do more then one step per tick
+    //the remaining steps are done in the next segments
+    uint32_t ticks = sgm->remaining_steps;
+    steps = MIN((uint32_t)target, ticks);
+    itp_extruder_pos += (sgm->dirbits & EXTRUDER_DIR_MASK) ? -(int32_t)steps : (int32_t)steps;
+    sgm->extruder_steps = steps << 1;
+    sgm->total = ticks << 1;
+    sgm->extruder_errors = ticks;
+
+    if (!remaining)
+    {
+        itp_extruder_start += (itp_extruder_negative) ? -(int32_t)itp_extruder_steps : (int32_t)itp_extruder_steps;
+    }
+}
+#endif
+
+/*
+	Auxiliary stepper functions
+*/
+#ifdef ENABLE_AUX_STEPPER
+//the discarded segments are lost and the motion being executed resumes from the real position
+static void itp_aux_resync(void)
+{
+    int32_t target = itp_aux_step_pos + ((itp_aux_dirbits) ? -(int32_t)itp_aux_remaining : (int32_t)itp_aux_remaining);
+    target -= itp_rt_aux_pos;
+    itp_aux_step_pos = itp_rt_aux_pos;
+    itp_aux_dirbits = (target < 0) ? AUX_DIR_MASK : 0;
+    itp_aux_remaining = ABS(target);
+    itp_aux_speed = 0;
+    itp_aux_partial = 0;
+    //forces the step ISR frequency update
+    itp_aux_sgm_oversample = 0xFF;
+}
+
+static inline bool itp_aux_is_running(void)
+{
+    //on hold the auxiliary stepper stops after deaccelerating
+    if (cnc_get_exec_state(EXEC_HOLD) && itp_aux_speed == 0)
+    {
+        return false;
+    }
+
+    return (itp_aux_remaining != 0 || itp_aux_data_slots != AUX_BUFFER_SIZE);
+}
+
+//computes the auxiliary stepper motion in the time window of the segment
+static void itp_aux_segment(INTERPOLATOR_SEGMENT *sgm, float frequency)
+{
+    uint32_t steps = 0;
+    uint16_t ticks = sgm->remaining_steps;
+
+    if (!itp_aux_remaining && itp_aux_data_slots != AUX_BUFFER_SIZE)
+    {
+        //loads the next motion
+        int32_t motion = itp_aux_data[itp_aux_data_read];
+        itp_aux_dirbits = (motion < 0) ? AUX_DIR_MASK : 0;
+        itp_aux_remaining = ABS(motion);
+        if (++itp_aux_data_read == AUX_BUFFER_SIZE)
+        {
+            itp_aux_data_read = 0;
+        }
+        itp_aux_data_slots++;
+    }
+
+    //oversamples the coordinated motion segment so that the step ISR runs at the auxiliary stepper rate
+    //the coordinated motion Bresenham line only runs once every 2^n ticks
+    uint8_t oversample = 0;
+    frequency = MIN(MAX(frequency, F_STEP_MIN), F_STEP_MAX);
+    if (sgm->block != NULL && itp_aux_remaining)
+    {
+        while (frequency < AUX_MAX_STEP_RATE && (frequency * 2) <= F_STEP_MAX && ticks < 0x8000)
+        {
+            frequency *= 2;
+            ticks <<= 1;
+            oversample++;
+        }
+
+        if (oversample)
+        {
+            sgm->remaining_steps = ticks;
+            itp_sgm_set_frequency(sgm, frequency);
+        }
+    }
+
+    //segments without speed change still need to update the step ISR frequency if the oversampling changed
+    if (itp_aux_sgm_oversample != oversample)
+    {
+        sgm->update_speed = true;
+    }
+    itp_aux_sgm_oversample = (sgm->block != NULL) ? oversample : 0xFF;
+    sgm->aux_oversample_mask = (1 << oversample) - 1;
+
+    if (itp_aux_remaining)
+    {
+        //integrates the auxiliary stepper trapezoidal profile in integrator time steps
+        float window = (float)ticks / frequency;
+        bool hold = cnc_get_exec_state(EXEC_HOLD);
+        while (window > 0)
+        {
+            float delta_t = MIN(window, INTEGRATOR_DELTA_T);
+            float speed = itp_aux_speed;
+            //deaccelerates to stop at the end of the motion (or on hold)
+            if (hold || fast_flt_pow2(speed) >= (2.0f * AUX_STEP_ACCELERATION * (float)itp_aux_remaining))
+            {
+                speed -= AUX_STEP_ACCELERATION * delta_t;
+                //keeps a minimal speed to reach the end of the motion
+                speed = (!hold) ? MAX(speed, AUX_STEP_ACCELERATION * INTEGRATOR_DELTA_T) : MAX(speed, 0);
+            }
+            else
+            {
+                speed += AUX_STEP_ACCELERATION * delta_t;
+                speed = MIN(speed, AUX_MAX_STEP_RATE);
+            }
+
+            itp_aux_partial += fast_flt_div2(speed + itp_aux_speed) * delta_t;
+            itp_aux_speed = speed;
+            window -= delta_t;
+        }
+
+        steps = (uint32_t)floorf(itp_aux_partial);
+        steps = MIN(steps, itp_aux_remaining);
+        //the step ISR can't do more then one step per tick
+        //if the segment is to slow the auxiliary stepper speed is limited to the ISR frequency
+        if (steps > ticks)
+        {
+            steps = ticks;
+            itp_aux_partial = 0;
+            itp_aux_speed = MIN(itp_aux_speed, frequency);
+        }
+        else
+        {
+            itp_aux_partial -= steps;
+        }
+
+        itp_aux_remaining -= steps;
+        itp_aux_step_pos += (itp_aux_dirbits) ? -(int32_t)steps : (int32_t)steps;
+        if (!itp_aux_remaining)
+        {
+            itp_aux_speed = 0;
+            itp_aux_partial = 0;
+        }
+    }
+
+    sgm->dirbits = itp_aux_dirbits;
+    sgm->aux_steps = steps << 1;
+    sgm->total = (uint32_t)ticks << 1;
+    sgm->aux_errors = ticks;
+}
+
+bool itp_aux_add_motion(float target)
+{
+    if (!itp_aux_data_slots)
+    {
+        return false;
+    }
+
+    int32_t steps = (int32_t)lroundf(target * AUX_STEPS_PER_UNIT);
+    if (steps != itp_aux_pos)
+    {
+        itp_aux_data[itp_aux_data_write] = steps - itp_aux_pos;
+        itp_aux_pos = steps;
+        if (++itp_aux_data_write == AUX_BUFFER_SIZE)
+        {
+            itp_aux_data_write = 0;
+        }
+        itp_aux_data_slots--;
+    }
+
+    return true;
+}
+
+void itp_aux_clear(void)
+{
+    itp_aux_data_write = 0;
+    itp_aux_data_read = 0;
+    itp_aux_data_slots = AUX_BUFFER_SIZE;
+    itp_aux_remaining = 0;
+    //syncs the queued position and the real position
+    itp_aux_pos = itp_rt_aux_pos;
+    itp_aux_step_pos = itp_rt_aux_pos;
+    itp_aux_resync();
+}
+
+bool itp_aux_is_idle(void)
+{
+    return (itp_rt_aux_pos == itp_aux_pos);
+}
+
+float itp_aux_get_position(void)
+{
+    return ((float)itp_rt_aux_pos / AUX_STEPS_PER_UNIT);
+}
+#endif
+
+/*
+	Input shaping functions
+*/
+#ifdef ENABLE_INPUT_SHAPING
+//computes the shaper impulses of each stepper from the frequency and damping settings
+static void itp_shaper_load(void)
+{
+    itp_shaper_delay = 0;
+    for (uint8_t i = STEPPER_COUNT; i != 0;)
+    {
+        i--;
+        float *a = itp_shaper_a[i];
+        float *t = itp_shaper_t[i];
+        memset(a, 0, sizeof(itp_shaper_a[i]));
+        memset(t, 0, sizeof(itp_shaper_t[i]));
+        a[0] = 1;
+        if (g_settings.shaper_frequency[i] <= 0)
+        {
+            continue;
+        }
+
+        //damped vibration period
+        float damping = g_settings.shaper_damping[i];
+        float damped = sqrtf(1.0f - damping * damping);
+        float period = 1.0f / (g_settings.shaper_frequency[i] * damped);
+#if (INPUT_SHAPER == SHAPER_ZV)
+        float k = expf(-damping * 3.14159265f / damped);
+        a[1] = k;
+        t[1] = 0.5f * period;
+#elif (INPUT_SHAPER == SHAPER_ZVD)
+        float k = expf(-damping * 3.14159265f / damped);
+        a[1] = 2.0f * k;
+        a[2] = k * k;
+        t[1] = 0.5f * period;
+        t[2] = period;
+#else
+        float k = expf(-0.75f * damping * 3.14159265f / damped);
+        a[0] = 1.0f - 0.70710678f;
+        a[1] = (1.41421356f - 1.0f) * k;
+        a[2] = a[0] * k * k;
+        t[1] = 0.375f * period;
+        t[2] = 0.75f * period;
+#endif
+        //the impulses sum must be 1
+        float sum = 0;
+        for (uint8_t j = 0; j < SHAPER_IMPULSES; j++)
+        {
+            sum += a[j];
+        }
+        for (uint8_t j = 0; j < SHAPER_IMPULSES; j++)
+        {
+            a[j] /= sum;
+        }
+
+        itp_shaper_delay = MAX(itp_shaper_delay, t[SHAPER_IMPULSES - 1]);
+    }
+}
+
+//the discarded segments are lost and the shaper restarts from the real position
+static void itp_shaper_resync(void)
+{
+    itp_shaper_hist_head = 0;
+    itp_shaper_hist_count = 1;
+    itp_shaper_hist_time[0] = 0;
+    for (uint8_t i = STEPPER_COUNT; i != 0;)
+    {
+        i--;
+        itp_shaper_hist_pos[0][i] = (int32_t)itp_rt_step_pos[i];
+        itp_shaper_pos[i] = (int32_t)itp_rt_step_pos[i];
+    }
+
+    itp_shaper_load();
+    itp_shaper_settle = itp_shaper_delay;
+}
+
+static inline bool itp_shaper_is_running(void)
+{
+    return (itp_shaper_settle < itp_shaper_delay);
+}
+
+//gets the planned position of the stepper at a given time before the end of the last segment
+//the position is linear inside each segment. If the history is shorter then the delay the oldest position is used
+static float itp_shaper_get_position(uint8_t stepper, float delay)
+{
+    uint8_t index = itp_shaper_hist_head;
+    for (uint8_t i = itp_shaper_hist_count; i > 1; i--)
+    {
+        uint8_t prev = (index != 0) ? (index - 1) : (INPUT_SHAPING_HISTORY - 1);
+        float time = itp_shaper_hist_time[index];
+        if (delay < time)
+        {
+            float end = (float)itp_shaper_hist_pos[index][stepper];
+            float start = (float)itp_shaper_hist_pos[prev][stepper];
+            return (end - (end - start) * (delay / time));
+        }
+
+        delay -= time;
+        index = prev;
+    }
+
+    return (float)itp_shaper_hist_pos[index][stepper];
+}
+
+//computes the shaped motion of the segment with the given duration
+//each segment has its own Bresenham line with the steps of the shaped motion
+//the segment step rate is the highest of the planned and the shaped step rates
+static float itp_shaper_segment(INTERPOLATOR_SEGMENT *sgm, float duration)
+{
+    //adds the planned position at the end of the segment to the history
+    uint8_t prev = itp_shaper_hist_head;
+    if (++itp_shaper_hist_head == INPUT_SHAPING_HISTORY)
+    {
+        itp_shaper_hist_head = 0;
+    }
+    if (itp_shaper_hist_count < INPUT_SHAPING_HISTORY)
+    {
+        itp_shaper_hist_count++;
+    }
+
+    int32_t *position = itp_shaper_hist_pos[itp_shaper_hist_head];
+    memcpy(position, itp_shaper_hist_pos[prev], sizeof(itp_shaper_hist_pos[prev]));
+    itp_shaper_hist_time[itp_shaper_hist_head] = duration;
+    if (itp_cur_plan_block != NULL)
+    {
+        uint32_t remaining = itp_cur_plan_block->total_steps;
+        float progress = (float)(itp_shaper_total - remaining) / (float)itp_shaper_total;
+        for (uint8_t i = STEPPER_COUNT; i != 0;)
+        {
+            i--;
+#ifdef ENABLE_EXTRUDER
+            //the extruder is not shaped
+            if (i == EXTRUDER_STEPPER)
+            {
+                continue;
+            }
+#endif
+            uint32_t steps = itp_cur_plan_block->steps[i];
+            if (remaining)
+            {
+                steps = (uint32_t)floorf((float)steps * progress);
+            }
+            position[i] = itp_shaper_start[i] + ((itp_cur_plan_block->dirbits & (1 << i)) ? -(int32_t)steps : (int32_t)steps);
+        }
+    }
+
+    if (memcmp(position, itp_shaper_hist_pos[prev], sizeof(itp_shaper_hist_pos[prev])))
+    {
+        itp_shaper_settle = 0;
+    }
+    else
+    {
+        itp_shaper_settle += duration;
+    }
+
+    //the shaped position is the sum of the delayed planned positions weighted by the impulses
+    INTERPOLATOR_BLOCK *block = &itp_blk_data[itp_blk_data_write];
+    uint16_t ticks = MAX(sgm->remaining_steps, 1);
+    block->dirbits = 0;
+    for (uint8_t i = STEPPER_COUNT; i != 0;)
+    {
+        i--;
+        float shaped = 0;
+        for (uint8_t j = 0; j < SHAPER_IMPULSES; j++)
+        {
+            shaped += itp_shaper_a[i][j] * itp_shaper_get_position(i, itp_shaper_t[i][j]);
+        }
+
+        int32_t steps = (int32_t)lroundf(shaped) - itp_shaper_pos[i];
+        itp_shaper_pos[i] += steps;
+        if (steps < 0)
+        {
+            block->dirbits |= (1 << i);
+            steps = -steps;
+        }
+
+        block->steps[i] = (uint32_t)steps;
+        ticks = MAX(ticks, (uint16_t)steps);
+    }
+
+    for (uint8_t i = STEPPER_COUNT; i != 0;)
+    {
+        i--;
+        block->steps[i] <<= 1;
+        block->errors[i] = ticks;
+    }
+    block->total_steps = (uint32_t)ticks << 1;
+#ifdef GCODE_PROCESS_LINE_NUMBERS
+    if (itp_cur_plan_block != NULL)
+    {
+        block->line = itp_cur_plan_block->line;
+    }
+#endif
+    itp_blk_buffer_write();
+
+    float frequency = (float)ticks / duration;
+    sgm->block = block;
+    sgm->remaining_steps = ticks;
+    sgm->update_speed = true;
+    itp_sgm_set_frequency(sgm, frequency);
+    return frequency;
+}
+#endif
+
+/*
+	Synchronized outputs functions
+*/
+#ifdef ENABLE_SYNC_OUTPUTS
+static void itp_set_outputs(planner_outputs_t *outputs)
+{
+    uint16_t mask = 1;
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        if (outputs->set & mask)
+        {
+            io_set_output(i, true);
+        }
+        else if (outputs->clear & mask)
+        {
+            io_set_output(i, false);
+        }
+        mask <<= 1;
+    }
+
+    if (outputs->analog)
+    {
+        io_set_pwm(outputs->analog - 1, outputs->analog_value);
+    }
+}
+#endif
+
+/*
+	Torch height control functions
+*/
+#ifdef ENABLE_THC
+//computes the correction speed from the analog input at a fixed rate (step ISR time)
+//the correction runs while the step ISR is running
+static void itp_thc_control(void)
+{
+    static uint32_t last_sample = 0;
+    static float rate = 0;
+    //the clock and the offset are changed by the step ISR (not atomic in 8-bit mcus)
+#if (MCU == MCU_AVR)
+    mcu_disable_interrupts();
+#endif
+    uint32_t clock = itp_thc_clock;
+    int32_t offset = itp_thc_offset;
+#if (MCU == MCU_AVR)
+    mcu_enable_interrupts();
+#endif
+    uint32_t elapsed = clock - last_sample;
+    if (elapsed < THC_SAMPLE_PERIOD)
+    {
+        return;
+    }
+
+    last_sample += elapsed;
+    if (!itp_thc_enabled)
+    {
+        rate = 0;
+        return;
+    }
+
+    //the analog value above the setpoint moves the torch down (the gain sign inverts this)
+    float error = (float)mcu_get_analog(THC_ANALOG) - g_settings.thc_setpoint;
+    float step_per_mm = g_settings.step_per_mm[THC_STEPPER];
+    float target = -error * g_settings.thc_gain * step_per_mm;
+    float max_rate = THC_MAX_FEED * step_per_mm * (1.0f / 60.0f);
+    //decelerates to stop at the maximum offset
+    float accel = THC_ACCELERATION * step_per_mm;
+    float remaining = THC_MAX_OFFSET * step_per_mm - (float)((target < 0) ? -offset : offset);
+    if (remaining > 0)
+    {
+        max_rate = MIN(max_rate, sqrtf(2.0f * accel * remaining));
+    }
+    else
+    {
+        max_rate = 0;
+    }
+    target = MIN(MAX(target, -max_rate), max_rate);
+
+    //the correction speed change is limited by the acceleration
+    float max_change = accel * (float)MIN(elapsed, 100000UL) * 0.000001f;
+    rate = MIN(MAX(target, rate - max_change), rate + max_change);
+    //the step ISR rate is limited to the int16 range (high step/mm settings can exceed it at THC_MAX_FEED)
+    itp_thc_rate = (int16_t)MIN(MAX(rate, -32767.0f), 32767.0f);
+}
+
+void itp_thc_enable(bool enable)
+{
+    //a repeated enable keeps the current correction
+    if (enable && itp_thc_enabled)
+    {
+        return;
+    }
+
+    itp_thc_enabled = enable;
+    itp_thc_rate = 0;
+    itp_thc_offset = 0;
+}
+
+float itp_thc_get_offset(void)
+{
+#if (MCU == MCU_AVR)
+    mcu_disable_interrupts();
+#endif
+    int32_t offset = itp_thc_offset;
+#if (MCU == MCU_AVR)
+    mcu_enable_interrupts();
+#endif
+    return ((float)offset / g_settings.step_per_mm[THC_STEPPER]);
+}
+#endif
+
+#if (defined(ENABLE_AUX_STEPPER) || defined(ENABLE_INPUT_SHAPING))
+//checks if the steppers are still running without planned motions
+static bool itp_fill_is_running(void)
+{
+#ifdef ENABLE_AUX_STEPPER
+    if (itp_aux_is_running())
+    {
+        return true;
+    }
+#endif
+#ifdef ENABLE_INPUT_SHAPING
+    if (itp_shaper_is_running())
+    {
+        return true;
+    }
+#endif
+    return false;
+}
+
+//adds a segment without planned motion that keeps the step ISR running for the auxiliary stepper and the shaped motion
+static void itp_fill(void)
+{
+    INTERPOLATOR_SEGMENT *sgm = &itp_sgm_data[itp_sgm_data_write];
+#ifdef ENABLE_AUX_STEPPER
+    float frequency = AUX_MAX_STEP_RATE;
+#else
+    float frequency = F_INTEGRATOR;
+#endif
+    sgm->block = NULL;
+    sgm->remaining_steps = (uint16_t)ceilf(frequency * INTEGRATOR_DELTA_T);
+    itp_sgm_set_frequency(sgm, frequency);
+    sgm->update_speed = true;
+    itp_sgm_nomotion(sgm);
+#ifdef ENABLE_INPUT_SHAPING
+    frequency = itp_shaper_segment(sgm, INTEGRATOR_DELTA_T);
+#endif
+#ifdef ENABLE_AUX_STEPPER
+    itp_aux_segment(sgm, frequency);
+#endif
+    itp_sgm_buffer_write();
+}
+#endif
+
 /*
 	Interpolator functions
 */
@@ -213,6 +1019,12 @@ void itp_init(void)
     //initialize circular buffers
     itp_blk_clear();
     itp_sgm_clear();
+#ifdef ENABLE_AUX_STEPPER
+    itp_aux_clear();
+#endif
+#ifdef ENABLE_INPUT_SHAPING
+    itp_shaper_resync();
+#endif
 }
 
 void itp_run(void)
@@ -230,6 +1042,10 @@ void itp_run(void)
 
     INTERPOLATOR_SEGMENT *sgm = NULL;
 
+#ifdef ENABLE_THC
+    itp_thc_control();
+#endif
+
     //creates segments and fills the buffer
     while (!itp_sgm_is_full())
     {
@@ -239,6 +1055,32 @@ void itp_run(void)
             return;
         }
 
+#if (defined(ENABLE_AUX_STEPPER) || defined(ENABLE_INPUT_SHAPING))
+        //the dwell is done in integrator time windows to keep the steppers running
+        if (itp_dwell)
+        {
+#ifdef SPINDLE_AT_SPEED
+            //the spindle reached the speed
+            if (itp_spindle_wait && io_get_spindle_at_speed())
+            {
+                itp_dwell = 0;
+                continue;
+            }
+#endif
+#ifdef ENABLE_INPUT_SHAPING
+            //the dwell starts after the shaped motion stops
+            if (!itp_shaper_is_running())
+            {
+                itp_dwell--;
+            }
+#else
+            itp_dwell--;
+#endif
+            itp_fill();
+            continue;
+        }
+#endif
+
         //no planner blocks has beed processed or last planner block was fully processed
         if (itp_cur_plan_block == NULL)
         {
@@ -252,7 +1094,25 @@ void itp_run(void)
 #ifdef GCODE_PROCESS_LINE_NUMBERS
             itp_blk_data[itp_blk_data_write].line = itp_cur_plan_block->line;
 #endif
+#ifdef ENABLE_SYNC_OUTPUTS
+            //the block outputs change when the next segment starts
+            itp_outputs.set = (itp_outputs.set & ~itp_cur_plan_block->outputs.clear) | itp_cur_plan_block->outputs.set;
+            itp_outputs.clear = (itp_outputs.clear & ~itp_cur_plan_block->outputs.set) | itp_cur_plan_block->outputs.clear;
+            if (itp_cur_plan_block->outputs.analog)
+            {
+                //blocks without segments (dwell while the steppers run) only keep the last analog output
+                if (itp_outputs.analog && itp_outputs.analog != itp_cur_plan_block->outputs.analog)
+                {
+                    io_set_pwm(itp_outputs.analog - 1, itp_outputs.analog_value);
+                }
+                itp_outputs.analog = itp_cur_plan_block->outputs.analog;
+                itp_outputs.analog_value = itp_cur_plan_block->outputs.analog_value;
+            }
+#endif
 
+#ifdef SPINDLE_AT_SPEED
+            itp_spindle_wait = itp_cur_plan_block->spindle_wait;
+#endif
             if (itp_cur_plan_block->dwell != 0)
             {
                 itp_delay(itp_cur_plan_block->dwell);
@@ -260,7 +1120,7 @@ void itp_run(void)
 
             if (itp_cur_plan_block->total_steps == 0)
             {
-#ifdef USE_SPINDLE
+#if (defined(USE_SPINDLE) || defined(ENABLE_SYNC_OUTPUTS))
                 if (itp_cur_plan_block->dwell == 0) //if dwell is 0 then run a single loop to updtate outputs (spindle)
                 {
                     itp_delay(1);
@@ -299,6 +1159,40 @@ void itp_run(void)
             sqr_step_speed *= fast_flt_pow2(total_step_inv);
             feed_convert *= fast_flt_sqrt(sqr_step_speed);
 
+#ifdef ENABLE_EXTRUDER
+            //the extruder steps are generated by the segments and not by the block
+            itp_extruder_total = itp_cur_plan_block->total_steps;
+            itp_extruder_steps = itp_cur_plan_block->steps[EXTRUDER_STEPPER];
+            itp_extruder_negative = (itp_cur_plan_block->dirbits & EXTRUDER_DIR_MASK);
+            itp_blk_data[itp_blk_data_write].steps[EXTRUDER_STEPPER] = 0;
+            itp_blk_data[itp_blk_data_write].dirbits &= ~EXTRUDER_DIR_MASK;
+            //the advance is only applied while extruding with motion of the other axis
+            itp_extruder_advance = 0;
+            if (itp_extruder_steps != 0 && !itp_extruder_negative)
+            {
+                for (uint8_t i = STEPPER_COUNT; i != 0;)
+                {
+                    i--;
+                    if (i != EXTRUDER_STEPPER && itp_cur_plan_block->steps[i] != 0)
+                    {
+                        itp_extruder_advance = g_settings.extruder_advance * (float)itp_extruder_steps * total_step_inv;
+                        break;
+                    }
+                }
+            }
+#endif
+
+#ifdef ENABLE_INPUT_SHAPING
+            //the shaper settings are reloaded when the motion starts from a stop
+            if (!itp_shaper_is_running())
+            {
+                itp_shaper_load();
+                itp_shaper_settle = itp_shaper_delay;
+            }
+            itp_shaper_total = itp_cur_plan_block->total_steps;
+            memcpy(itp_shaper_start, itp_shaper_hist_pos[itp_shaper_hist_head], sizeof(itp_shaper_start));
+#endif
+
             //initializes data for generating step segments
             unprocessed_steps = itp_cur_plan_block->total_steps;
 
@@ -320,6 +1214,19 @@ void itp_run(void)
             break;
         }
 
+#if (defined(ENABLE_AUX_STEPPER) || defined(ENABLE_INPUT_SHAPING))
+        //the dwell executes before the motion
+        if (itp_dwell)
+        {
+            continue;
+        }
+#endif
+
+#ifdef ENABLE_ADAPTIVE_FEED
+        //the load is sampled for each motion segment and flags the block update if the feed changes
+        planner_adaptive_feed_update();
+#endif
+
         sgm = &itp_sgm_data[itp_sgm_data_write];
         sgm->block = &itp_blk_data[itp_blk_data_write];
 
@@ -405,6 +1312,13 @@ void itp_run(void)
         {
             if (current_speed < 0)
             {
+#if (defined(ENABLE_AUX_STEPPER) || defined(ENABLE_INPUT_SHAPING))
+                //the auxiliary stepper and the shaped motion also run until they stop
+                while (!itp_sgm_is_full() && itp_fill_is_running())
+                {
+                    itp_fill();
+                }
+#endif
                 //after a feed hold if 0 speed reached exits and starves the buffer
                 return;
             }
@@ -464,12 +1378,29 @@ void itp_run(void)
 
         //completes the segment information (step speed, steps) and updates the block
         sgm->remaining_steps = segm_steps << dss;
-        mcu_freq_to_clocks((float)step_speed, &(sgm->timer_counter), &(sgm->timer_prescaller));
+        itp_sgm_set_frequency(sgm, (float)step_speed);
+#ifdef ENABLE_AUX_STEPPER
+        itp_aux_segment(sgm, (float)step_speed);
+#endif
 #else
         sgm->remaining_steps = segm_steps;
-        mcu_freq_to_clocks(current_speed, &(sgm->timer_counter), &(sgm->timer_prescaller));
+#ifndef ENABLE_INPUT_SHAPING
+        itp_sgm_set_frequency(sgm, current_speed);
+#ifdef ENABLE_AUX_STEPPER
+        itp_aux_segment(sgm, current_speed);
+#endif
+#endif
 #endif
         itp_cur_plan_block->total_steps -= segm_steps;
+#ifdef ENABLE_INPUT_SHAPING
+        //the segment step rate is set by the shaped motion
+        float segm_time = (float)segm_steps / MAX(current_speed, F_STEP_MIN);
+#ifdef ENABLE_AUX_STEPPER
+        itp_aux_segment(sgm, itp_shaper_segment(sgm, segm_time));
+#else
+        itp_shaper_segment(sgm, segm_time);
+#endif
+#endif
 
         sgm->feed = current_speed * feed_convert;
 #ifdef USE_SPINDLE
@@ -492,14 +1423,31 @@ void itp_run(void)
             itp_cur_plan_block->total_steps = deaccel_from;
         }
 
+#ifdef ENABLE_EXTRUDER
+        itp_extruder_segment(sgm, unprocessed_steps, fast_flt_sqrt(itp_cur_plan_block->entry_feed_sqr));
+#endif
+
         //finally write the segment
         itp_sgm_buffer_write();
 
         if (unprocessed_steps == 0)
         {
+#ifndef ENABLE_INPUT_SHAPING
+            //with input shaping each segment has its own block
             itp_blk_buffer_write();
+#endif
+#ifdef ENABLE_ADAPTIVE_FEED
+            //the adaptive feed changes the planned speeds and the next motion starts at the current speed
+            float exit_speed_sqr = itp_cur_plan_block->entry_feed_sqr;
+#endif
             itp_cur_plan_block = NULL;
             planner_discard_block(); //discards planner block
+#ifdef ENABLE_ADAPTIVE_FEED
+            if (!planner_buffer_is_empty())
+            {
+                planner_get_block()->entry_feed_sqr = exit_speed_sqr;
+            }
+#endif
 #if (DSS_MAX_OVERSAMPLING != 0)
             prev_dss = 0;
 #endif
@@ -508,6 +1456,14 @@ void itp_run(void)
         }
     }
 
+#if (defined(ENABLE_AUX_STEPPER) || defined(ENABLE_INPUT_SHAPING))
+    //no planned motions left to execute
+    while (itp_cur_plan_block == NULL && planner_buffer_is_empty() && !itp_sgm_is_full() && itp_fill_is_running())
+    {
+        itp_fill();
+    }
+#endif
+
 #ifdef USE_COOLANT
     //updated the coolant pins
     io_set_coolant(planner_get_coolant());
@@ -553,6 +1509,34 @@ void itp_clear(void)
     itp_sgm_data_read = 0;
     itp_sgm_data_slots = INTERPOLATOR_BUFFER_SIZE;
     itp_blk_clear();
+#if (defined(ENABLE_DUAL_DRIVE_AXIS) || defined(KINEMATICS_LOCK_STEP_HOMING))
+    itp_step_lock = 0;
+#endif
+#ifdef ENABLE_AUX_STEPPER
+    itp_aux_resync();
+#endif
+#if (defined(ENABLE_AUX_STEPPER) || defined(ENABLE_EXTRUDER))
+    itp_sgm_dirbits = 0xFF;
+#endif
+#ifdef ENABLE_EXTRUDER
+    itp_extruder_resync();
+#endif
+#if (defined(ENABLE_AUX_STEPPER) || defined(ENABLE_INPUT_SHAPING))
+    itp_dwell = 0;
+#endif
+#ifdef ENABLE_INPUT_SHAPING
+    itp_shaper_resync();
+#endif
+#ifdef ENABLE_THC
+    itp_thc_rate = 0;
+    itp_thc_errors = 0;
+#endif
+#ifdef ENABLE_SYNC_OUTPUTS
+    memset(&itp_outputs, 0, sizeof(planner_outputs_t));
+#endif
+#ifdef SPINDLE_AT_SPEED
+    itp_spindle_wait = false;
+#endif
 }
 
 void itp_get_rt_position(uint32_t *position)
@@ -612,7 +1596,7 @@ uint16_t itp_get_rt_spindle(void)
 }
 #endif
 
-#ifdef ENABLE_DUAL_DRIVE_AXIS
+#if (defined(ENABLE_DUAL_DRIVE_AXIS) || defined(KINEMATICS_LOCK_STEP_HOMING))
 void itp_lock_stepper(uint8_t lockmask)
 {
     itp_step_lock = lockmask;
@@ -649,10 +1633,33 @@ void itp_step_reset_isr(void)
         mcu_change_step_ISR(itp_running_sgm->timer_counter, itp_running_sgm->timer_prescaller);
 
         //set dir bits
+#if (defined(ENABLE_AUX_STEPPER) || defined(ENABLE_EXTRUDER) || defined(ENABLE_THC))
+        //keeps the direction of the axis in segments without motion
+        static uint8_t dirbits = 0;
+        if (itp_running_sgm->block != NULL)
+        {
+            dirbits = itp_running_sgm->block->dirbits;
+        }
+#ifdef ENABLE_THC
+        itp_rt_dirbits = dirbits;
+#if (defined(ENABLE_AUX_STEPPER) || defined(ENABLE_EXTRUDER))
+        itp_rt_dirbits |= itp_running_sgm->dirbits;
+#endif
+        //the realtime offset sets the direction if the stepper has no planned motion
+        if (itp_running_sgm->block == NULL || !itp_running_sgm->block->steps[THC_STEPPER])
+        {
+            itp_rt_dirbits = (itp_rt_dirbits & ~THC_DIR_MASK) | itp_thc_dirbits;
+        }
+        io_set_dirs(itp_rt_dirbits);
+#else
+        io_set_dirs(dirbits | itp_running_sgm->dirbits);
+#endif
+#else
         if (itp_running_sgm->block != NULL)
         {
             io_set_dirs(itp_running_sgm->block->dirbits);
         }
+#endif
 
 #ifdef USE_SPINDLE
         io_set_spindle(itp_running_sgm->spindle, itp_running_sgm->spindle_inv);
@@ -684,6 +1691,14 @@ void itp_step_isr(void)
     itp_busy = true;
     mcu_enable_interrupts();
 
+#ifdef SPINDLE_AT_SPEED
+    //the spindle reached the speed (checked after the first tick of the dwell) and ends the dwell
+    if (itp_running_sgm != NULL && itp_running_sgm->spindle_wait && itp_running_sgm->block == NULL && io_get_spindle_at_speed())
+    {
+        itp_running_sgm->remaining_steps = 1;
+    }
+#endif
+
     //if buffer empty loads one
     if (itp_running_sgm == NULL)
     {
@@ -694,28 +1709,35 @@ void itp_step_isr(void)
             itp_running_sgm = &itp_sgm_data[itp_sgm_data_read];
             cnc_set_exec_state(EXEC_RUN);
             itp_isr_finnished = false;
+#ifdef ENABLE_SYNC_OUTPUTS
+            //the outputs of the block change when the first segment starts
+            if (itp_running_sgm->outputs.set || itp_running_sgm->outputs.clear || itp_running_sgm->outputs.analog)
+            {
+                itp_set_outputs(&(itp_running_sgm->outputs));
+            }
+#endif
 #if (DSS_MAX_OVERSAMPLING != 0)
             if (itp_running_sgm->next_dss != 0)
             {
                 if (!(itp_running_sgm->next_dss & 0xF8))
                 {
                     itp_running_sgm->block->total_steps <<= itp_running_sgm->next_dss;
-#ifdef STEP0
+#if (defined(STEP0) && STEPPER_COUNT > 0)
                     itp_running_sgm->block->errors[0] <<= itp_running_sgm->next_dss;
 #endif
-#ifdef STEP1
+#if (defined(STEP1) && STEPPER_COUNT > 1)
                     itp_running_sgm->block->errors[1] <<= itp_running_sgm->next_dss;
 #endif
-#ifdef STEP2
+#if (defined(STEP2) && STEPPER_COUNT > 2)
                     itp_running_sgm->block->errors[2] <<= itp_running_sgm->next_dss;
 #endif
-#ifdef STEP3
+#if (defined(STEP3) && STEPPER_COUNT > 3)
                     itp_running_sgm->block->errors[3] <<= itp_running_sgm->next_dss;
 #endif
-#ifdef STEP4
+#if (defined(STEP4) && STEPPER_COUNT > 4)
                     itp_running_sgm->block->errors[4] <<= itp_running_sgm->next_dss;
 #endif
-#ifdef STEP5
+#if (defined(STEP5) && STEPPER_COUNT > 5)
                     itp_running_sgm->block->errors[5] <<= itp_running_sgm->next_dss;
 #endif
                 }
@@ -723,22 +1745,22 @@ void itp_step_isr(void)
                 {
                     itp_running_sgm->next_dss = -itp_running_sgm->next_dss;
                     itp_running_sgm->block->total_steps >>= itp_running_sgm->next_dss;
-#ifdef STEP0
+#if (defined(STEP0) && STEPPER_COUNT > 0)
                     itp_running_sgm->block->errors[0] >>= itp_running_sgm->next_dss;
 #endif
-#ifdef STEP1
+#if (defined(STEP1) && STEPPER_COUNT > 1)
                     itp_running_sgm->block->errors[1] >>= itp_running_sgm->next_dss;
 #endif
-#ifdef STEP2
+#if (defined(STEP2) && STEPPER_COUNT > 2)
                     itp_running_sgm->block->errors[2] >>= itp_running_sgm->next_dss;
 #endif
-#ifdef STEP3
+#if (defined(STEP3) && STEPPER_COUNT > 3)
                     itp_running_sgm->block->errors[3] >>= itp_running_sgm->next_dss;
 #endif
-#ifdef STEP4
+#if (defined(STEP4) && STEPPER_COUNT > 4)
                     itp_running_sgm->block->errors[4] >>= itp_running_sgm->next_dss;
 #endif
-#ifdef STEP5
+#if (defined(STEP5) && STEPPER_COUNT > 5)
                     itp_running_sgm->block->errors[5] >>= itp_running_sgm->next_dss;
 #endif
                 }
@@ -755,10 +1777,14 @@ void itp_step_isr(void)
     if (itp_running_sgm != NULL)
     {
         itp_running_sgm->remaining_steps--;
+#ifdef ENABLE_AUX_STEPPER
+        if (itp_running_sgm->block != NULL && !(itp_running_sgm->remaining_steps & itp_running_sgm->aux_oversample_mask))
+#else
         if (itp_running_sgm->block != NULL)
+#endif
         {
 //prepares the next step bits mask
-#ifdef STEP0
+#if (defined(STEP0) && STEPPER_COUNT > 0)
             itp_running_sgm->block->errors[0] += itp_running_sgm->block->steps[0];
             if (itp_running_sgm->block->errors[0] > itp_running_sgm->block->total_steps)
             {
@@ -781,7 +1807,7 @@ void itp_step_isr(void)
 #endif
             }
 #endif
-#ifdef STEP1
+#if (defined(STEP1) && STEPPER_COUNT > 1)
             itp_running_sgm->block->errors[1] += itp_running_sgm->block->steps[1];
             if (itp_running_sgm->block->errors[1] > itp_running_sgm->block->total_steps)
             {
@@ -804,7 +1830,7 @@ void itp_step_isr(void)
 #endif
             }
 #endif
-#ifdef STEP2
+#if (defined(STEP2) && STEPPER_COUNT > 2)
             itp_running_sgm->block->errors[2] += itp_running_sgm->block->steps[2];
             if (itp_running_sgm->block->errors[2] > itp_running_sgm->block->total_steps)
             {
@@ -827,7 +1853,7 @@ void itp_step_isr(void)
 #endif
             }
 #endif
-#ifdef STEP3
+#if (defined(STEP3) && STEPPER_COUNT > 3)
             itp_running_sgm->block->errors[3] += itp_running_sgm->block->steps[3];
             if (itp_running_sgm->block->errors[3] > itp_running_sgm->block->total_steps)
             {
@@ -850,7 +1876,7 @@ void itp_step_isr(void)
 #endif
             }
 #endif
-#ifdef STEP4
+#if (defined(STEP4) && STEPPER_COUNT > 4)
             itp_running_sgm->block->errors[4] += itp_running_sgm->block->steps[4];
             if (itp_running_sgm->block->errors[4] > itp_running_sgm->block->total_steps)
             {
@@ -873,7 +1899,7 @@ void itp_step_isr(void)
 #endif
             }
 #endif
-#ifdef STEP5
+#if (defined(STEP5) && STEPPER_COUNT > 5)
             itp_running_sgm->block->errors[5] += itp_running_sgm->block->steps[5];
             if (itp_running_sgm->block->errors[5] > itp_running_sgm->block->total_steps)
             {
@@ -897,9 +1923,79 @@ void itp_step_isr(void)
             }
 #endif
         }
+#ifdef ENABLE_AUX_STEPPER
+        //auxiliary stepper Bresenham line
+        itp_running_sgm->aux_errors += itp_running_sgm->aux_steps;
+        if (itp_running_sgm->aux_errors > itp_running_sgm->total)
+        {
+            itp_running_sgm->aux_errors -= itp_running_sgm->total;
+            stepbits |= AUX_STEP_MASK;
+            if (itp_running_sgm->dirbits & AUX_DIR_MASK)
+            {
+                itp_rt_aux_pos--;
+            }
+            else
+            {
+                itp_rt_aux_pos++;
+            }
+        }
+#endif
+#ifdef ENABLE_THC
+        //realtime offset (only if the stepper has no planned motion)
+        if (itp_running_sgm->block == NULL || !itp_running_sgm->block->steps[THC_STEPPER])
+        {
+            itp_thc_errors += (int32_t)itp_thc_rate * itp_running_sgm->tick_us;
+            if (itp_thc_errors >= 1000000L || itp_thc_errors <= -1000000L)
+            {
+                uint8_t dir = (itp_thc_errors < 0) ? THC_DIR_MASK : 0;
+                itp_thc_errors += (dir) ? 1000000L : -1000000L;
+                //the step ISR is slower then the correction speed
+                if (itp_thc_errors >= 1000000L || itp_thc_errors <= -1000000L)
+                {
+                    itp_thc_errors = 0;
+                }
+                //the direction is set one tick before the step
+                if (dir != itp_thc_dirbits)
+                {
+                    itp_thc_dirbits = dir;
+                    itp_rt_dirbits = (itp_rt_dirbits & ~THC_DIR_MASK) | dir;
+                    io_set_dirs(itp_rt_dirbits);
+                }
+                stepbits |= THC_STEP_MASK;
+                if (dir)
+                {
+                    itp_rt_step_pos[THC_STEPPER]--;
+                    itp_thc_offset--;
+                }
+                else
+                {
+                    itp_rt_step_pos[THC_STEPPER]++;
+                    itp_thc_offset++;
+                }
+            }
+        }
+        itp_thc_clock += itp_running_sgm->tick_us;
+#endif
+#ifdef ENABLE_EXTRUDER
+        //extruder Bresenham line
+        itp_running_sgm->extruder_errors += itp_running_sgm->extruder_steps;
+        if (itp_running_sgm->extruder_errors > itp_running_sgm->total)
+        {
+            itp_running_sgm->extruder_errors -= itp_running_sgm->total;
+            stepbits |= EXTRUDER_STEP_MASK;
+            if (itp_running_sgm->dirbits & EXTRUDER_DIR_MASK)
+            {
+                itp_rt_step_pos[EXTRUDER_STEPPER]--;
+            }
+            else
+            {
+                itp_rt_step_pos[EXTRUDER_STEPPER]++;
+            }
+        }
+#endif
     }
 
-#ifdef ENABLE_DUAL_DRIVE_AXIS
+#if (defined(ENABLE_DUAL_DRIVE_AXIS) || defined(KINEMATICS_LOCK_STEP_HOMING))
     stepbits &= ~itp_step_lock;
 #endif
     mcu_disable_interrupts(); //lock isr before clearin busy flag
@@ -908,26 +2004,26 @@ void itp_step_isr(void)
 
 void itp_delay(uint16_t delay)
 {
-    itp_sgm_data[itp_sgm_data_write].block = NULL;
-    //clicks every 100ms (10Hz)
-    mcu_freq_to_clocks(10, &(itp_sgm_data[itp_sgm_data_write].timer_counter), &(itp_sgm_data[itp_sgm_data_write].timer_prescaller));
-    itp_sgm_data[itp_sgm_data_write].remaining_steps = delay;
-    itp_sgm_data[itp_sgm_data_write].update_speed = true;
-    itp_sgm_data[itp_sgm_data_write].feed = 0;
-#ifdef USE_SPINDLE
-#ifdef LASER_MODE
-    if (g_settings.laser_mode)
+    INTERPOLATOR_SEGMENT *sgm = &itp_sgm_data[itp_sgm_data_write];
+#if (defined(ENABLE_AUX_STEPPER) || defined(ENABLE_INPUT_SHAPING))
+    //while the steppers are running the delay is done by the integrator
+    if (itp_fill_is_running())
     {
-        itp_sgm_data[itp_sgm_data_write].spindle = 0;
-        itp_sgm_data[itp_sgm_data_write].spindle_inv = false;
-    }
-    else
-    {
-        planner_get_spindle_speed(1, &(itp_sgm_data[itp_sgm_data_write].spindle), &(itp_sgm_data[itp_sgm_data_write].spindle_inv));
+        itp_dwell += (uint32_t)delay * (F_INTEGRATOR / 10);
+        return;
     }
-#else
-    planner_get_spindle_speed(1, &(itp_sgm_data[itp_sgm_data_write].spindle), &(itp_sgm_data[itp_sgm_data_write].spindle_inv));
 #endif
+    sgm->block = NULL;
+    //clicks every 100ms (10Hz)
+    itp_sgm_set_frequency(sgm, 10);
+    sgm->remaining_steps = delay;
+    sgm->update_speed = true;
+#ifdef SPINDLE_AT_SPEED
+    sgm->spindle_wait = itp_spindle_wait;
+#endif
+    itp_sgm_nomotion(sgm);
+#ifdef ENABLE_AUX_STEPPER
+    itp_aux_segment(sgm, 10);
 #endif
     itp_sgm_buffer_write();
 }
@@ -36,12 +36,22 @@ float itp_get_rt_feed(void);
 #ifdef USE_SPINDLE
 uint16_t itp_get_rt_spindle(void);
 #endif
-#ifdef ENABLE_DUAL_DRIVE_AXIS
+#if (defined(ENABLE_DUAL_DRIVE_AXIS) || defined(KINEMATICS_LOCK_STEP_HOMING))
 void itp_lock_stepper(uint8_t lockmask);
 #endif
 #ifdef GCODE_PROCESS_LINE_NUMBERS
 uint32_t itp_get_rt_line_number(void);
 #endif
 void itp_delay(uint16_t delay);
+#ifdef ENABLE_AUX_STEPPER
+bool itp_aux_add_motion(float target);
+void itp_aux_clear(void);
+bool itp_aux_is_idle(void);
+float itp_aux_get_position(void);
+#endif
+#ifdef ENABLE_THC
+void itp_thc_enable(bool enable);
+float itp_thc_get_offset(void);
+#endif
 
 #endif
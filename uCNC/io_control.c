@@ -25,6 +25,7 @@
 #include "io_control.h"
 #include "parser.h"
 #include "interpolator.h"
+#include "kinematics.h"
 #include "cnc.h"
 
 static volatile uint8_t io_limits_homing_filter;
@@ -48,9 +49,19 @@ void io_limits_isr(void)
 
                     cnc_alarm(EXEC_ALARM_HARD_LIMIT);
                 }
-#ifdef ENABLE_DUAL_DRIVE_AXIS
+#if (defined(ENABLE_DUAL_DRIVE_AXIS) || defined(KINEMATICS_LOCK_STEP_HOMING))
                 else
                 {
+#ifdef KINEMATICS_LOCK_STEP_HOMING
+                    //locks the linear actuators that reached their limit switch and only stops when all the homing limit switches are triggered
+                    //the dual drive axis limit switches are handled bellow
+                    if (!(limits & ~io_limits_homing_filter) && (limits != io_limits_homing_filter) && !(io_limits_homing_filter & LIMITS_DUAL_MASK))
+                    {
+                        kinematics_lock_step(limits);
+                        return; //exits and doesn't trip the alarm
+                    }
+#endif
+#ifdef ENABLE_DUAL_DRIVE_AXIS
 //if homing and dual drive axis are enabled
 #ifdef DUAL_DRIVE_AXIS0
                     if ((limits & (LIMIT_DUAL0 | LIMITS_DUAL_MASK) & io_limits_homing_filter)) //the limit triggered matches the first dual drive axis
@@ -71,11 +82,12 @@ void io_limits_isr(void)
                             itp_lock_stepper((limits & LIMITS_LIMIT1_MASK) ? STEP7_MASK : STEP_DUAL1);
                         }
                     }
+#endif
 #endif
                 }
 #endif
             }
-#ifdef ENABLE_DUAL_DRIVE_AXIS
+#if (defined(ENABLE_DUAL_DRIVE_AXIS) || defined(KINEMATICS_LOCK_STEP_HOMING))
             itp_lock_stepper(0); //unlocks axis
 #endif
             cnc_set_exec_state(EXEC_LIMITS);
@@ -134,6 +146,13 @@ bool io_check_boundaries(float *axis)
     for (uint8_t i = AXIS_COUNT; i != 0;)
     {
         i--;
+#ifdef ENABLE_EXTRUDER
+        //the extruder has no travel limits
+        if (i == AXIS_A)
+        {
+            continue;
+        }
+#endif
         float value = (axis[i] < 0) ? -axis[i] : axis[i];
         if (value > g_settings.max_distance[i])
         {
@@ -237,6 +256,13 @@ bool io_get_probe(void)
 #endif
 }
 
+#ifdef SPINDLE_AT_SPEED
+bool io_get_spindle_at_speed(void)
+{
+    return (mcu_get_input(SPINDLE_AT_SPEED) != 0);
+}
+#endif
+
 void io_set_homing_limits_filter(uint8_t filter_mask)
 {
     io_limits_homing_filter = filter_mask;
@@ -507,3 +533,293 @@ void io_set_coolant(uint8_t value)
 #endif
 }
 #endif
+
+#ifdef ENABLE_SYNC_OUTPUTS
+//sets the digital output DOUTn
+void io_set_output(uint8_t output, bool state)
+{
+    switch (output)
+    {
+#ifdef DOUT0
+    case 0:
+        if (state)
+        {
+            mcu_set_output(DOUT0);
+        }
+        else
+        {
+            mcu_clear_output(DOUT0);
+        }
+        break;
+#endif
+#ifdef DOUT1
+    case 1:
+        if (state)
+        {
+            mcu_set_output(DOUT1);
+        }
+        else
+        {
+            mcu_clear_output(DOUT1);
+        }
+        break;
+#endif
+#ifdef DOUT2
+    case 2:
+        if (state)
+        {
+            mcu_set_output(DOUT2);
+        }
+        else
+        {
+            mcu_clear_output(DOUT2);
+        }
+        break;
+#endif
+#ifdef DOUT3
+    case 3:
+        if (state)
+        {
+            mcu_set_output(DOUT3);
+        }
+        else
+        {
+            mcu_clear_output(DOUT3);
+        }
+        break;
+#endif
+#ifdef DOUT4
+    case 4:
+        if (state)
+        {
+            mcu_set_output(DOUT4);
+        }
+        else
+        {
+            mcu_clear_output(DOUT4);
+        }
+        break;
+#endif
+#ifdef DOUT5
+    case 5:
+        if (state)
+        {
+            mcu_set_output(DOUT5);
+        }
+        else
+        {
+            mcu_clear_output(DOUT5);
+        }
+        break;
+#endif
+#ifdef DOUT6
+    case 6:
+        if (state)
+        {
+            mcu_set_output(DOUT6);
+        }
+        else
+        {
+            mcu_clear_output(DOUT6);
+        }
+        break;
+#endif
+#ifdef DOUT7
+    case 7:
+        if (state)
+        {
+            mcu_set_output(DOUT7);
+        }
+        else
+        {
+            mcu_clear_output(DOUT7);
+        }
+        break;
+#endif
+#ifdef DOUT8
+    case 8:
+        if (state)
+        {
+            mcu_set_output(DOUT8);
+        }
+        else
+        {
+            mcu_clear_output(DOUT8);
+        }
+        break;
+#endif
+#ifdef DOUT9
+    case 9:
+        if (state)
+        {
+            mcu_set_output(DOUT9);
+        }
+        else
+        {
+            mcu_clear_output(DOUT9);
+        }
+        break;
+#endif
+#ifdef DOUT10
+    case 10:
+        if (state)
+        {
+            mcu_set_output(DOUT10);
+        }
+        else
+        {
+            mcu_clear_output(DOUT10);
+        }
+        break;
+#endif
+#ifdef DOUT11
+    case 11:
+        if (state)
+        {
+            mcu_set_output(DOUT11);
+        }
+        else
+        {
+            mcu_clear_output(DOUT11);
+        }
+        break;
+#endif
+#ifdef DOUT12
+    case 12:
+        if (state)
+        {
+            mcu_set_output(DOUT12);
+        }
+        else
+        {
+            mcu_clear_output(DOUT12);
+        }
+        break;
+#endif
+#ifdef DOUT13
+    case 13:
+        if (state)
+        {
+            mcu_set_output(DOUT13);
+        }
+        else
+        {
+            mcu_clear_output(DOUT13);
+        }
+        break;
+#endif
+#ifdef DOUT14
+    case 14:
+        if (state)
+        {
+            mcu_set_output(DOUT14);
+        }
+        else
+        {
+            mcu_clear_output(DOUT14);
+        }
+        break;
+#endif
+#ifdef DOUT15
+    case 15:
+        if (state)
+        {
+            mcu_set_output(DOUT15);
+        }
+        else
+        {
+            mcu_clear_output(DOUT15);
+        }
+        break;
+#endif
+    }
+}
+
+//sets the PWM output PWMn
+void io_set_pwm(uint8_t pwm, uint8_t value)
+{
+    switch (pwm)
+    {
+#ifdef PWM0
+    case 0:
+        mcu_set_pwm(PWM0, value);
+        break;
+#endif
+#ifdef PWM1
+    case 1:
+        mcu_set_pwm(PWM1, value);
+        break;
+#endif
+#ifdef PWM2
+    case 2:
+        mcu_set_pwm(PWM2, value);
+        break;
+#endif
+#ifdef PWM3
+    case 3:
+        mcu_set_pwm(PWM3, value);
+        break;
+#endif
+#ifdef PWM4
+    case 4:
+        mcu_set_pwm(PWM4, value);
+        break;
+#endif
+#ifdef PWM5
+    case 5:
+        mcu_set_pwm(PWM5, value);
+        break;
+#endif
+#ifdef PWM6
+    case 6:
+        mcu_set_pwm(PWM6, value);
+        break;
+#endif
+#ifdef PWM7
+    case 7:
+        mcu_set_pwm(PWM7, value);
+        break;
+#endif
+#ifdef PWM8
+    case 8:
+        mcu_set_pwm(PWM8, value);
+        break;
+#endif
+#ifdef PWM9
+    case 9:
+        mcu_set_pwm(PWM9, value);
+        break;
+#endif
+#ifdef PWM10
+    case 10:
+        mcu_set_pwm(PWM10, value);
+        break;
+#endif
+#ifdef PWM11
+    case 11:
+        mcu_set_pwm(PWM11, value);
+        break;
+#endif
+#ifdef PWM12
+    case 12:
+        mcu_set_pwm(PWM12, value);
+        break;
+#endif
+#ifdef PWM13
+    case 13:
+        mcu_set_pwm(PWM13, value);
+        break;
+#endif
+#ifdef PWM14
+    case 14:
+        mcu_set_pwm(PWM14, value);
+        break;
+#endif
+#ifdef PWM15
+    case 15:
+        mcu_set_pwm(PWM15, value);
+        break;
+#endif
+    }
+}
+#endif
@@ -205,6 +205,9 @@ uint8_t io_get_controls(void);
 void io_enable_probe(void);
 void io_disable_probe(void);
 bool io_get_probe(void);
+#ifdef SPINDLE_AT_SPEED
+bool io_get_spindle_at_speed(void);
+#endif
 void io_set_homing_limits_filter(uint8_t filter_mask);
 
 //outputs
@@ -222,4 +225,9 @@ void io_set_spindle(uint8_t value, bool invert);
 void io_set_coolant(uint8_t value);
 #endif
 
+#ifdef ENABLE_SYNC_OUTPUTS
+void io_set_output(uint8_t output, bool state);
+void io_set_pwm(uint8_t pwm, uint8_t value);
+#endif
+
 #endif
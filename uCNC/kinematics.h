@@ -21,6 +21,7 @@
 #define KINEMATICS_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
 /*
 	Converts from machine absolute coordinates to step position.
@@ -58,4 +59,29 @@ void kinematics_apply_transform(float *axis);
 */
 void kinematics_apply_reverse_transform(float *axis);
 
+#ifdef ENABLE_TOOL_CENTER_POINT
+/*
+	Returns the number of segments needed to keep the path deviation caused by the rotary axis within the tool center point tolerance
+*/
+uint16_t kinematics_tcp_segments(float *start, float *target);
+#endif
+
+#ifdef ENABLE_MESH_COMPENSATION
+/*
+	Height map (mesh) compensation
+	Restores the stored height map (or clears it if not available)
+*/
+void kinematics_mesh_load(void);
+/*
+	Clears and disables the height map and defines a new grid between the two XY corners
+*/
+void kinematics_mesh_define(float *start, float *end);
+void kinematics_mesh_set_height(uint8_t x, uint8_t y, float height);
+void kinematics_mesh_enable(bool enable);
+/*
+	Returns the fraction of the line from start to target (after the fraction t) where the next grid line is crossed (1 if none)
+*/
+float kinematics_mesh_next_crossing(float *start, float *target, float t);
+#endif
+
 #endif
@@ -21,14 +21,353 @@
 
 #if (MACHINE_KINEMATICS == MACHINE_CARTESIAN)
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
+#include "utils.h"
 #include "mcu.h"
 #include "settings.h"
+#include "serial.h"
 #include "kinematics.h"
 #include "io_control.h"
+#include "interpolator.h"
 #include "motion_control.h"
 #include "grbl_interface.h"
 
+#ifdef ENABLE_TOOL_CENTER_POINT
+#if (!defined(AXIS_C) || (defined(TCP_TILT_AXIS_B) && !defined(AXIS_B)) || (!defined(TCP_TILT_AXIS_B) && !defined(AXIS_A)))
+#error "The tool center point transform needs the C axis and the tilting axis (A or B)"
+#endif
+#ifdef TCP_TILT_AXIS_B
+#define TCP_TILT_AXIS AXIS_B
+#else
+#define TCP_TILT_AXIS AXIS_A
+#endif
+#define TCP_DEG_RAD 0.0174532925f
+#define TCP_SIN_TABLE_SIZE 256
+
+//quarter wave sine table (0º to 90º in 256 steps)
+//with linear interpolation the maximum error is under 5E-6 (0.001mm at 200mm from the rotation center)
+static const float __rom__ tcp_sin_table[TCP_SIN_TABLE_SIZE + 1] = {
+    0.00000000f, 0.00613588f, 0.01227154f, 0.01840673f, 0.02454123f, 0.03067480f, 0.03680722f, 0.04293826f,
+    0.04906767f, 0.05519524f, 0.06132074f, 0.06744392f, 0.07356456f, 0.07968244f, 0.08579731f, 0.09190896f,
+    0.09801714f, 0.10412163f, 0.11022221f, 0.11631863f, 0.12241068f, 0.12849811f, 0.13458071f, 0.14065824f,
+    0.14673047f, 0.15279719f, 0.15885814f, 0.16491312f, 0.17096189f, 0.17700422f, 0.18303989f, 0.18906866f,
+    0.19509032f, 0.20110463f, 0.20711138f, 0.21311032f, 0.21910124f, 0.22508391f, 0.23105811f, 0.23702361f,
+    0.24298018f, 0.24892761f, 0.25486566f, 0.26079412f, 0.26671276f, 0.27262136f, 0.27851969f, 0.28440754f,
+    0.29028468f, 0.29615089f, 0.30200595f, 0.30784964f, 0.31368174f, 0.31950203f, 0.32531029f, 0.33110631f,
+    0.33688985f, 0.34266072f, 0.34841868f, 0.35416353f, 0.35989504f, 0.36561300f, 0.37131719f, 0.37700741f,
+    0.38268343f, 0.38834505f, 0.39399204f, 0.39962420f, 0.40524131f, 0.41084317f, 0.41642956f, 0.42200027f,
+    0.42755509f, 0.43309382f, 0.43861624f, 0.44412214f, 0.44961133f, 0.45508359f, 0.46053871f, 0.46597650f,
+    0.47139674f, 0.47679923f, 0.48218377f, 0.48755016f, 0.49289819f, 0.49822767f, 0.50353838f, 0.50883014f,
+    0.51410274f, 0.51935599f, 0.52458968f, 0.52980362f, 0.53499762f, 0.54017147f, 0.54532499f, 0.55045797f,
+    0.55557023f, 0.56066158f, 0.56573181f, 0.57078075f, 0.57580819f, 0.58081396f, 0.58579786f, 0.59075970f,
+    0.59569930f, 0.60061648f, 0.60551104f, 0.61038281f, 0.61523159f, 0.62005721f, 0.62485949f, 0.62963824f,
+    0.63439328f, 0.63912444f, 0.64383154f, 0.64851440f, 0.65317284f, 0.65780669f, 0.66241578f, 0.66699992f,
+    0.67155895f, 0.67609270f, 0.68060100f, 0.68508367f, 0.68954054f, 0.69397146f, 0.69837625f, 0.70275474f,
+    0.70710678f, 0.71143220f, 0.71573083f, 0.72000251f, 0.72424708f, 0.72846439f, 0.73265427f, 0.73681657f,
+    0.74095113f, 0.74505779f, 0.74913639f, 0.75318680f, 0.75720885f, 0.76120239f, 0.76516727f, 0.76910334f,
+    0.77301045f, 0.77688847f, 0.78073723f, 0.78455660f, 0.78834643f, 0.79210658f, 0.79583690f, 0.79953727f,
+    0.80320753f, 0.80684755f, 0.81045720f, 0.81403633f, 0.81758481f, 0.82110251f, 0.82458930f, 0.82804505f,
+    0.83146961f, 0.83486287f, 0.83822471f, 0.84155498f, 0.84485357f, 0.84812034f, 0.85135519f, 0.85455799f,
+    0.85772861f, 0.86086694f, 0.86397286f, 0.86704625f, 0.87008699f, 0.87309498f, 0.87607009f, 0.87901223f,
+    0.88192126f, 0.88479710f, 0.88763962f, 0.89044872f, 0.89322430f, 0.89596625f, 0.89867447f, 0.90134885f,
+    0.90398929f, 0.90659570f, 0.90916798f, 0.91170603f, 0.91420976f, 0.91667906f, 0.91911385f, 0.92151404f,
+    0.92387953f, 0.92621024f, 0.92850608f, 0.93076696f, 0.93299280f, 0.93518351f, 0.93733901f, 0.93945922f,
+    0.94154407f, 0.94359346f, 0.94560733f, 0.94758559f, 0.94952818f, 0.95143502f, 0.95330604f, 0.95514117f,
+    0.95694034f, 0.95870347f, 0.96043052f, 0.96212140f, 0.96377607f, 0.96539444f, 0.96697647f, 0.96852209f,
+    0.97003125f, 0.97150389f, 0.97293995f, 0.97433938f, 0.97570213f, 0.97702814f, 0.97831737f, 0.97956977f,
+    0.98078528f, 0.98196387f, 0.98310549f, 0.98421009f, 0.98527764f, 0.98630810f, 0.98730142f, 0.98825757f,
+    0.98917651f, 0.99005821f, 0.99090264f, 0.99170975f, 0.99247953f, 0.99321195f, 0.99390697f, 0.99456457f,
+    0.99518473f, 0.99576741f, 0.99631261f, 0.99682030f, 0.99729046f, 0.99772307f, 0.99811811f, 0.99847558f,
+    0.99879546f, 0.99907773f, 0.99932238f, 0.99952942f, 0.99969882f, 0.99983058f, 0.99992470f, 0.99998118f,
+    1.00000000f};
+
+static FORCEINLINE float kinematics_tcp_sin_entry(uint16_t index)
+{
+    float value;
+    rom_memcpy(&value, &tcp_sin_table[index], sizeof(float));
+    return value;
+}
+
+//sine with the angle in table steps (4 * TCP_SIN_TABLE_SIZE steps per turn)
+static float kinematics_tcp_sin(float steps)
+{
+    float index = floorf(steps);
+    float frac = steps - index;
+    uint16_t turn_index = ((uint16_t)((int32_t)index)) & (4 * TCP_SIN_TABLE_SIZE - 1);
+    uint16_t quarter_index = turn_index & (TCP_SIN_TABLE_SIZE - 1);
+    float a;
+    float b;
+
+    //the 2nd and 4th quarters are the mirror of the 1st and 3rd quarters
+    if (turn_index & TCP_SIN_TABLE_SIZE)
+    {
+        a = kinematics_tcp_sin_entry(TCP_SIN_TABLE_SIZE - quarter_index);
+        b = kinematics_tcp_sin_entry(TCP_SIN_TABLE_SIZE - quarter_index - 1);
+    }
+    else
+    {
+        a = kinematics_tcp_sin_entry(quarter_index);
+        b = kinematics_tcp_sin_entry(quarter_index + 1);
+    }
+
+    a += (b - a) * frac;
+    //the 3rd and 4th quarters are negative
+    return (turn_index & (2 * TCP_SIN_TABLE_SIZE)) ? -a : a;
+}
+
+static void kinematics_tcp_sincos(float angle, float *sin_value, float *cos_value)
+{
+    float steps = angle * (TCP_SIN_TABLE_SIZE / 90.0f);
+    *sin_value = kinematics_tcp_sin(steps);
+    *cos_value = kinematics_tcp_sin(steps + TCP_SIN_TABLE_SIZE);
+}
+
+//rotates the vector around the tilting axis
+static void kinematics_tcp_tilt(float *v, float sin_t, float cos_t)
+{
+#ifndef TCP_TILT_AXIS_B
+    float y = v[AXIS_Y] * cos_t - v[AXIS_Z] * sin_t;
+    v[AXIS_Z] = v[AXIS_Y] * sin_t + v[AXIS_Z] * cos_t;
+    v[AXIS_Y] = y;
+#else
+    float x = v[AXIS_X] * cos_t + v[AXIS_Z] * sin_t;
+    v[AXIS_Z] = v[AXIS_Z] * cos_t - v[AXIS_X] * sin_t;
+    v[AXIS_X] = x;
+#endif
+}
+
+//rotates the vector around the Z axis
+static void kinematics_tcp_rotate(float *v, float sin_c, float cos_c)
+{
+    float x = v[AXIS_X] * cos_c - v[AXIS_Y] * sin_c;
+    v[AXIS_Y] = v[AXIS_X] * sin_c + v[AXIS_Y] * cos_c;
+    v[AXIS_X] = x;
+}
+
+//converts the tool tip position (workpiece coordinates) to the machine position or the reverse
+static void kinematics_tcp_transform(float *axis, bool reverse)
+{
+    float sin_t, cos_t, sin_c, cos_c;
+    float v[3];
+    kinematics_tcp_sincos(axis[TCP_TILT_AXIS], &sin_t, &cos_t);
+    kinematics_tcp_sincos(axis[AXIS_C], &sin_c, &cos_c);
+
+#ifndef TCP_HEAD
+    //the table rotates the workpiece (first around C and then tilts)
+    v[AXIS_X] = axis[AXIS_X] - TCP_TABLE_CENTER_X;
+    v[AXIS_Y] = axis[AXIS_Y] - TCP_TABLE_CENTER_Y;
+    v[AXIS_Z] = axis[AXIS_Z] - TCP_TABLE_CENTER_Z;
+    if (!reverse)
+    {
+        kinematics_tcp_rotate(v, sin_c, cos_c);
+        kinematics_tcp_tilt(v, sin_t, cos_t);
+    }
+    else
+    {
+        kinematics_tcp_tilt(v, -sin_t, cos_t);
+        kinematics_tcp_rotate(v, -sin_c, cos_c);
+    }
+    axis[AXIS_X] = v[AXIS_X] + TCP_TABLE_CENTER_X;
+    axis[AXIS_Y] = v[AXIS_Y] + TCP_TABLE_CENTER_Y;
+    axis[AXIS_Z] = v[AXIS_Z] + TCP_TABLE_CENTER_Z;
+#else
+    //the head pivot moves with the tool direction (tool tip to pivot)
+    v[AXIS_X] = 0;
+    v[AXIS_Y] = 0;
+    v[AXIS_Z] = TCP_HEAD_PIVOT_LENGTH;
+    kinematics_tcp_tilt(v, sin_t, cos_t);
+    kinematics_tcp_rotate(v, sin_c, cos_c);
+    v[AXIS_Z] -= TCP_HEAD_PIVOT_LENGTH;
+    if (reverse)
+    {
+        axis[AXIS_X] -= v[AXIS_X];
+        axis[AXIS_Y] -= v[AXIS_Y];
+        axis[AXIS_Z] -= v[AXIS_Z];
+    }
+    else
+    {
+        axis[AXIS_X] += v[AXIS_X];
+        axis[AXIS_Y] += v[AXIS_Y];
+        axis[AXIS_Z] += v[AXIS_Z];
+    }
+#endif
+}
+
+uint16_t kinematics_tcp_segments(float *start, float *target)
+{
+    float angle = (ABS(target[TCP_TILT_AXIS] - start[TCP_TILT_AXIS]) + ABS(target[AXIS_C] - start[AXIS_C])) * TCP_DEG_RAD;
+    if (angle == 0)
+    {
+        return 1;
+    }
+
+#ifndef TCP_HEAD
+    float radius = 0;
+    float radius_end = 0;
+    radius += fast_flt_pow2(start[AXIS_X] - TCP_TABLE_CENTER_X);
+    radius += fast_flt_pow2(start[AXIS_Y] - TCP_TABLE_CENTER_Y);
+    radius += fast_flt_pow2(start[AXIS_Z] - TCP_TABLE_CENTER_Z);
+    radius_end += fast_flt_pow2(target[AXIS_X] - TCP_TABLE_CENTER_X);
+    radius_end += fast_flt_pow2(target[AXIS_Y] - TCP_TABLE_CENTER_Y);
+    radius_end += fast_flt_pow2(target[AXIS_Z] - TCP_TABLE_CENTER_Z);
+    radius = sqrtf(MAX(radius, radius_end));
+#else
+    float radius = TCP_HEAD_PIVOT_LENGTH;
+#endif
+
+    //the deviation of a chord of an arc is r * (1 - cos(angle / 2)) ~= r * angle^2 / 8
+    float segments = ceilf(angle * sqrtf(radius * (0.125f / TCP_TOLERANCE)));
+    return (uint16_t)MAX(MIN(segments, UINT16_MAX), 1);
+}
+#endif
+
+#ifdef ENABLE_MESH_COMPENSATION
+#if (MESH_GRID_X < 2 || MESH_GRID_Y < 2)
+#error "The height map needs at least 2 points in each direction"
+#endif
+//the stored height map can't exceed 255 bytes
+#if (defined(ENABLE_MESH_PERSISTENCE) && ((MESH_GRID_X * MESH_GRID_Y) > 58))
+#error "The stored height map is limited to 58 points"
+#endif
+#define MESH_CROSSING_TOLERANCE 0.0001f
+
+typedef struct
+{
+    float origin[2];
+    float step[2];
+    float height[MESH_GRID_Y][MESH_GRID_X];
+    uint8_t enabled;
+} kinematics_mesh_t;
+
+static kinematics_mesh_t kinematics_mesh;
+//grid cells per mm (computed once to make the cell lookup a simple multiplication)
+static float kinematics_mesh_inv_step[2];
+
+static void kinematics_mesh_update(void)
+{
+    for (uint8_t i = 0; i < 2; i++)
+    {
+        kinematics_mesh_inv_step[i] = (kinematics_mesh.step[i] != 0) ? (1.0f / kinematics_mesh.step[i]) : 0;
+    }
+}
+
+void kinematics_mesh_load(void)
+{
+#ifdef ENABLE_MESH_PERSISTENCE
+    if (!settings_load(MESH_ADDRESS_OFFSET, (uint8_t *)&kinematics_mesh, sizeof(kinematics_mesh_t)))
+    {
+        kinematics_mesh_update();
+        return;
+    }
+#endif
+    memset(&kinematics_mesh, 0, sizeof(kinematics_mesh_t));
+    kinematics_mesh_update();
+}
+
+void kinematics_mesh_define(float *start, float *end)
+{
+    memset(&kinematics_mesh, 0, sizeof(kinematics_mesh_t));
+    kinematics_mesh.origin[0] = start[AXIS_X];
+    kinematics_mesh.origin[1] = start[AXIS_Y];
+    kinematics_mesh.step[0] = (end[AXIS_X] - start[AXIS_X]) * (1.0f / (MESH_GRID_X - 1));
+    kinematics_mesh.step[1] = (end[AXIS_Y] - start[AXIS_Y]) * (1.0f / (MESH_GRID_Y - 1));
+    kinematics_mesh_update();
+}
+
+void kinematics_mesh_set_height(uint8_t x, uint8_t y, float height)
+{
+    kinematics_mesh.height[y][x] = height;
+}
+
+void kinematics_mesh_enable(bool enable)
+{
+    kinematics_mesh.enabled = (enable) ? 1 : 0;
+#ifdef ENABLE_MESH_PERSISTENCE
+    settings_save(MESH_ADDRESS_OFFSET, (const uint8_t *)&kinematics_mesh, sizeof(kinematics_mesh_t));
+#endif
+}
+
+//converts the position to the grid coordinates (the cell is the integer part)
+//positions outside the map use the offset of the nearest edge
+static uint8_t kinematics_mesh_cell(float pos, uint8_t i, uint8_t points, float *fraction)
+{
+    float grid = (pos - kinematics_mesh.origin[i]) * kinematics_mesh_inv_step[i];
+    if (grid <= 0)
+    {
+        *fraction = 0;
+        return 0;
+    }
+
+    if (grid >= (points - 1))
+    {
+        *fraction = 1;
+        return (points - 2);
+    }
+
+    uint8_t cell = (uint8_t)grid;
+    *fraction = grid - cell;
+    return cell;
+}
+
+//bilinear interpolation of the Z offset in the cell
+static float kinematics_mesh_offset(float *axis)
+{
+    float u, v;
+    uint8_t x = kinematics_mesh_cell(axis[AXIS_X], 0, MESH_GRID_X, &u);
+    uint8_t y = kinematics_mesh_cell(axis[AXIS_Y], 1, MESH_GRID_Y, &v);
+    float z0 = kinematics_mesh.height[y][x] + (kinematics_mesh.height[y][x + 1] - kinematics_mesh.height[y][x]) * u;
+    float z1 = kinematics_mesh.height[y + 1][x] + (kinematics_mesh.height[y + 1][x + 1] - kinematics_mesh.height[y + 1][x]) * u;
+    return (z0 + (z1 - z0) * v);
+}
+
+//finds the fraction of the line where the next grid line is crossed in one direction
+static float kinematics_mesh_axis_crossing(float start, float dir, float t, uint8_t i, uint8_t points)
+{
+    float grid_start = (start - kinematics_mesh.origin[i]) * kinematics_mesh_inv_step[i];
+    float grid_dir = dir * kinematics_mesh_inv_step[i];
+    float grid = grid_start + grid_dir * t;
+    float line;
+
+    if (grid_dir > 0)
+    {
+        line = floorf(grid + MESH_CROSSING_TOLERANCE) + 1.0f;
+        line = MAX(line, 0);
+        if (line > (points - 1))
+        {
+            return 1.0f;
+        }
+    }
+    else if (grid_dir < 0)
+    {
+        line = ceilf(grid - MESH_CROSSING_TOLERANCE) - 1.0f;
+        line = MIN(line, (points - 1));
+        if (line < 0)
+        {
+            return 1.0f;
+        }
+    }
+    else
+    {
+        return 1.0f;
+    }
+
+    return MIN((line - grid_start) / grid_dir, 1.0f);
+}
+
+float kinematics_mesh_next_crossing(float *start, float *target, float t)
+{
+    if (!kinematics_mesh.enabled)
+    {
+        return 1.0f;
+    }
+
+    float next_x = kinematics_mesh_axis_crossing(start[AXIS_X], target[AXIS_X] - start[AXIS_X], t, 0, MESH_GRID_X);
+    float next_y = kinematics_mesh_axis_crossing(start[AXIS_Y], target[AXIS_Y] - start[AXIS_Y], t, 1, MESH_GRID_Y);
+    return MIN(next_x, next_y);
+}
+#endif
+
 void kinematics_apply_inverse(float *axis, uint32_t *steps)
 {
 #ifdef AXIS_X
@@ -73,10 +412,41 @@ void kinematics_apply_forward(uint32_t *steps, float *axis)
 #endif
 }
 
+#ifdef ENABLE_HOMING_GROUPS
+//the limit switch index matches the axis index
+static uint8_t kinematics_home_group(uint8_t group)
+{
+    group &= ((1 << AXIS_COUNT) - 1);
+    if (!group)
+    {
+        return STATUS_OK;
+    }
+
+    return mc_home_axis_group(group, group);
+}
+#endif
+
 uint8_t kinematics_home(void)
 {
     uint8_t result = 0;
 
+#ifdef ENABLE_HOMING_GROUPS
+    result = kinematics_home_group(HOMING_GROUP0);
+    if (result != 0)
+    {
+        return result;
+    }
+    result = kinematics_home_group(HOMING_GROUP1);
+    if (result != 0)
+    {
+        return result;
+    }
+    result = kinematics_home_group(HOMING_GROUP2);
+    if (result != 0)
+    {
+        return result;
+    }
+#else
 #ifdef AXIS_Z
     result = mc_home_axis(AXIS_Z, LIMIT_Z_MASK);
     if (result != 0)
@@ -119,6 +489,7 @@ uint8_t kinematics_home(void)
     {
         return result;
     }
+#endif
 #endif
 
     return STATUS_OK;
@@ -126,7 +497,29 @@ uint8_t kinematics_home(void)
 
 void kinematics_lock_step(uint8_t limits_mask)
 {
-    // do nothing
+#ifdef ENABLE_HOMING_GROUPS
+    //locks the steppers of the axis that reached the limit switch
+    uint8_t lock = 0;
+#ifdef AXIS_X
+    lock |= (limits_mask & LIMIT_X_MASK) ? STEP0_ITP_MASK : 0;
+#endif
+#ifdef AXIS_Y
+    lock |= (limits_mask & LIMIT_Y_MASK) ? STEP1_ITP_MASK : 0;
+#endif
+#ifdef AXIS_Z
+    lock |= (limits_mask & LIMIT_Z_MASK) ? STEP2_ITP_MASK : 0;
+#endif
+#ifdef AXIS_A
+    lock |= (limits_mask & LIMIT_A_MASK) ? STEP3_ITP_MASK : 0;
+#endif
+#ifdef AXIS_B
+    lock |= (limits_mask & LIMIT_B_MASK) ? STEP4_ITP_MASK : 0;
+#endif
+#ifdef AXIS_C
+    lock |= (limits_mask & LIMIT_C_MASK) ? STEP5_ITP_MASK : 0;
+#endif
+    itp_lock_stepper(lock);
+#endif
 }
 
 void kinematics_apply_transform(float *axis)
@@ -134,6 +527,16 @@ void kinematics_apply_transform(float *axis)
     /*
 	Define your custom transform
     */
+#ifdef ENABLE_MESH_COMPENSATION
+    //the height map follows the programmed XY position
+    if (kinematics_mesh.enabled)
+    {
+        axis[AXIS_Z] += kinematics_mesh_offset(axis);
+    }
+#endif
+#ifdef ENABLE_TOOL_CENTER_POINT
+    kinematics_tcp_transform(axis, false);
+#endif
 #ifdef ENABLE_SKEW_COMPENSATION
     //apply correction skew factors that compensate for machine axis alignemnt
     axis[AXIS_X] -= axis[AXIS_Y] * g_settings.skew_xy_factor;
@@ -158,6 +561,15 @@ void kinematics_apply_reverse_transform(float *axis)
     axis[AXIS_Y] += axis[AXIS_Z] * g_settings.skew_yz_factor;
 #endif
 #endif
+#ifdef ENABLE_TOOL_CENTER_POINT
+    kinematics_tcp_transform(axis, true);
+#endif
+#ifdef ENABLE_MESH_COMPENSATION
+    if (kinematics_mesh.enabled)
+    {
+        axis[AXIS_Z] -= kinematics_mesh_offset(axis);
+    }
+#endif
 }
 
 #endif
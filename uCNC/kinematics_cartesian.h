@@ -49,9 +49,62 @@
 //#define DUAL_DRIVE_AXIS1 Y
 #endif
 
+/*
+	Enable homing groups
+	The axis of each group seek the limit switches in a single motion and each one stops independently when reaching the switch
+	The groups are homed in order (set a group to 0 to skip it)
+	Dual drive axis should be homed in a group of their own
+*/
+//#define ENABLE_HOMING_GROUPS
+#ifdef ENABLE_HOMING_GROUPS
+#define HOMING_GROUP0 (LIMIT_Z_MASK)
+#define HOMING_GROUP1 (LIMIT_X_MASK | LIMIT_Y_MASK)
+#define HOMING_GROUP2 (LIMIT_A_MASK | LIMIT_B_MASK | LIMIT_C_MASK)
+//the limit switches lock the steppers during the homing motion
+#define KINEMATICS_LOCK_STEP_HOMING
+#endif
+
 /*
 	Enable Skew compensation
 */
 //#define ENABLE_SKEW_COMPENSATION
 
+/*
+	Enable five axis tool center point transform (RTCP)
+	Keeps the tool tip on the programmed path while the rotary axis move (rotary axis positions in degrees)
+	The machine has a tilting axis (A - rotates around X or B - rotates around Y) and a rotary C axis (rotates around Z)
+	Requires AXIS_C and AXIS_A or AXIS_B to be defined
+*/
+//#define ENABLE_TOOL_CENTER_POINT
+#ifdef ENABLE_TOOL_CENTER_POINT
+//uncomment to use the B axis as the tilting axis (default is A)
+//#define TCP_TILT_AXIS_B
+//uncomment if the rotary axis move the tool (head) instead of the workpiece (table)
+//#define TCP_HEAD
+//table: machine coordinates of the intersection of the rotary axis (mm)
+#define TCP_TABLE_CENTER_X 0.0f
+#define TCP_TABLE_CENTER_Y 0.0f
+#define TCP_TABLE_CENTER_Z 0.0f
+//head: distance from the head pivot to the tool tip including the tool length (mm)
+#define TCP_HEAD_PIVOT_LENGTH 100.0f
+//maximum deviation (mm) from the programmed path caused by the rotation of the rotary axis in a linear motion
+//motions are split in segments to keep the deviation under this value
+#define TCP_TOLERANCE 0.01f
+#endif
+
+/*
+	Enable height map (mesh) compensation
+	G29 X Y Z F probes a grid of points from the current XY position to the XY corner (Z is the probe target)
+	The Z offset of the surface is interpolated between the probed points and added to all motions
+	G29 without axis words disables the compensation
+*/
+//#define ENABLE_MESH_COMPENSATION
+#ifdef ENABLE_MESH_COMPENSATION
+//number of probed points in each direction
+#define MESH_GRID_X 5
+#define MESH_GRID_Y 5
+//uncomment to store the height map in the non volatile memory (restored on power up)
+//#define ENABLE_MESH_PERSISTENCE
+#endif
+
 #endif
@@ -18,44 +18,49 @@
 */
 #include "config.h"
 
-#if(MACHINE_KINEMATICS==MACHINE_COREXY)
+#if (MACHINE_KINEMATICS == MACHINE_COREXY)
 #include <stdio.h>
+#include <math.h>
 #include "mcu.h"
 #include "settings.h"
 #include "kinematics.h"
 #include "io_control.h"
+#include "motion_control.h"
+#include "grbl_interface.h"
 
-void kinematics_apply_inverse(float* axis, uint32_t* steps)
+void kinematics_apply_inverse(float *axis, uint32_t *steps)
 {
-    steps[0] = (uint32_t)lroundf(g_settings.step_mm[0] * (axis[AXIS_X] + axis[AXIS_Y]));
-    steps[1] = (uint32_t)lroundf(g_settings.step_mm[1] * (axis[AXIS_X] - axis[AXIS_Y]));
-    steps[2] = (uint32_t)lroundf(g_settings.step_mm[2] * axis[AXIS_Z]);
+    steps[0] = (uint32_t)lroundf(g_settings.step_per_mm[0] * (axis[AXIS_X] + axis[AXIS_Y]));
+    steps[1] = (uint32_t)lroundf(g_settings.step_per_mm[1] * (axis[AXIS_X] - axis[AXIS_Y]));
+    steps[2] = (uint32_t)lroundf(g_settings.step_per_mm[2] * axis[AXIS_Z]);
 }
 
-void kinematics_apply_forward(uint32_t* steps, float* axis)
+void kinematics_apply_forward(uint32_t *steps, float *axis)
 {
-    axis[AXIS_X] = (float)(step_mm_inv[0] * 0.5f * (steps[0] + steps[1]));
-    axis[AXIS_Y] = (float)(step_mm_inv[1] * 0.5f * (steps[0] - steps[1]));
-    axis[AXIS_Z] = (float)(step_mm_inv[2] * steps[2]);
+    float a = (float)(((int32_t)steps[0]) / g_settings.step_per_mm[0]);
+    float b = (float)(((int32_t)steps[1]) / g_settings.step_per_mm[1]);
+    axis[AXIS_X] = 0.5f * (a + b);
+    axis[AXIS_Y] = 0.5f * (a - b);
+    axis[AXIS_Z] = (float)(((int32_t)steps[2]) / g_settings.step_per_mm[2]);
 }
 
-void kinematics_home(void)
+uint8_t kinematics_home(void)
 {
     uint8_t result = 0;
     result = mc_home_axis(AXIS_Z, LIMIT_Z_MASK);
-    if(result != 0)
+    if (result != 0)
     {
         return result;
     }
 
     result = mc_home_axis(AXIS_X, LIMIT_X_MASK);
-    if(result != 0)
+    if (result != 0)
     {
         return result;
     }
 
     result = mc_home_axis(AXIS_Y, LIMIT_Y_MASK);
-    if(result != 0)
+    if (result != 0)
     {
         return result;
     }
@@ -68,14 +73,14 @@ void kinematics_lock_step(uint8_t limits_mask)
     // do nothing
 }
 
-void kinematics_apply_transform(float* axis)
+void kinematics_apply_transform(float *axis)
 {
     /*
 	Define your custom transform
     */
 }
 
-void kinematics_apply_reverse_transform(float* axis)
+void kinematics_apply_reverse_transform(float *axis)
 {
     /*
 	Define your custom transform inverse operation
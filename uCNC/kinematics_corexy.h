@@ -24,7 +24,11 @@
 #define AXIS_X 0
 #define AXIS_Y 1
 #define AXIS_Z 2
-#define TOOL_AXIS AXIS_Z
 #define STEPPER_COUNT 3
 
+/*
+	Uncomment this feature to enable tool length compensation
+*/
+#define AXIS_TOOL AXIS_Z
+
 #endif
\ No newline at end of file
@@ -0,0 +1,140 @@
+/*
+	Name: kinematics_delta.c
+	Description: Implements all kinematics math equations to translate the motion of a linear delta machine.
+		Also implements the homing motion for this type of machine.
+
+	Copyright: Copyright (c) João Martins
+	Author: João Martins
+	Date: 18/10/2026
+
+	µCNC is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version. Please see <http://www.gnu.org/licenses/>
+
+	µCNC is distributed WITHOUT ANY WARRANTY;
+	Also without the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+	See the	GNU General Public License for more details.
+*/
+
+#include "config.h"
+
+#if (MACHINE_KINEMATICS == MACHINE_DELTA)
+#include <stdio.h>
+#include <math.h>
+#include "utils.h"
+#include "mcu.h"
+#include "settings.h"
+#include "kinematics.h"
+#include "io_control.h"
+#include "interpolator.h"
+#include "motion_control.h"
+#include "grbl_interface.h"
+
+//precomputed tower geometry (towers at 210º, 330º and 90º)
+#define DELTA_TOWER0_X (-0.866025404f * DELTA_RADIUS)
+#define DELTA_TOWER0_Y (-0.5f * DELTA_RADIUS)
+#define DELTA_TOWER1_X (0.866025404f * DELTA_RADIUS)
+#define DELTA_TOWER1_Y (-0.5f * DELTA_RADIUS)
+#define DELTA_TOWER2_X 0.0f
+#define DELTA_TOWER2_Y DELTA_RADIUS
+#define DELTA_ARM_LENGTH_SQR (DELTA_ARM_LENGTH * DELTA_ARM_LENGTH)
+
+//carriage height above the effector
+//the fast_flt_sqrt error (up to 5%) is to high to compute the actuators position and the full precision sqrt is used
+static FORCEINLINE float kinematics_delta_tower_height(float dx, float dy)
+{
+    float h = DELTA_ARM_LENGTH_SQR - dx * dx - dy * dy;
+    return (h > 0) ? sqrtf(h) : 0;
+}
+
+void kinematics_apply_inverse(float *axis, uint32_t *steps)
+{
+    steps[0] = (uint32_t)lroundf(g_settings.step_per_mm[0] * (axis[AXIS_Z] + kinematics_delta_tower_height(axis[AXIS_X] - DELTA_TOWER0_X, axis[AXIS_Y] - DELTA_TOWER0_Y)));
+    steps[1] = (uint32_t)lroundf(g_settings.step_per_mm[1] * (axis[AXIS_Z] + kinematics_delta_tower_height(axis[AXIS_X] - DELTA_TOWER1_X, axis[AXIS_Y] - DELTA_TOWER1_Y)));
+    steps[2] = (uint32_t)lroundf(g_settings.step_per_mm[2] * (axis[AXIS_Z] + kinematics_delta_tower_height(axis[AXIS_X] - DELTA_TOWER2_X, axis[AXIS_Y] - DELTA_TOWER2_Y)));
+}
+
+//trilateration of the 3 spheres centered at the carriage joints with the arm length radius
+//this is only used to resync the position and doesn't need to be fast
+void kinematics_apply_forward(uint32_t *steps, float *axis)
+{
+    float z0 = (float)(((int32_t)steps[0]) / g_settings.step_per_mm[0]);
+    float z1 = (float)(((int32_t)steps[1]) / g_settings.step_per_mm[1]);
+    float z2 = (float)(((int32_t)steps[2]) / g_settings.step_per_mm[2]);
+
+    //unit vector from tower 0 to tower 1
+    float ex[3] = {DELTA_TOWER1_X - DELTA_TOWER0_X, DELTA_TOWER1_Y - DELTA_TOWER0_Y, z1 - z0};
+    float d = sqrtf(ex[0] * ex[0] + ex[1] * ex[1] + ex[2] * ex[2]);
+    ex[0] /= d;
+    ex[1] /= d;
+    ex[2] /= d;
+
+    //unit vector perpendicular to ex in the plane of the 3 carriage joints
+    float p02[3] = {DELTA_TOWER2_X - DELTA_TOWER0_X, DELTA_TOWER2_Y - DELTA_TOWER0_Y, z2 - z0};
+    float i = ex[0] * p02[0] + ex[1] * p02[1] + ex[2] * p02[2];
+    float ey[3] = {p02[0] - i * ex[0], p02[1] - i * ex[1], p02[2] - i * ex[2]};
+    float j = sqrtf(ey[0] * ey[0] + ey[1] * ey[1] + ey[2] * ey[2]);
+    ey[0] /= j;
+    ey[1] /= j;
+    ey[2] /= j;
+
+    //normal to the plane pointing up
+    float ez[3] = {ex[1] * ey[2] - ex[2] * ey[1], ex[2] * ey[0] - ex[0] * ey[2], ex[0] * ey[1] - ex[1] * ey[0]};
+    if (ez[2] < 0)
+    {
+        ez[0] = -ez[0];
+        ez[1] = -ez[1];
+        ez[2] = -ez[2];
+    }
+
+    //all spheres have the same radius
+    float x = 0.5f * d;
+    float y = (i * i + j * j - 2.0f * i * x) / (2.0f * j);
+    float z = DELTA_ARM_LENGTH_SQR - x * x - y * y;
+    z = (z > 0) ? sqrtf(z) : 0;
+
+    //the effector is bellow the carriages
+    axis[AXIS_X] = DELTA_TOWER0_X + x * ex[0] + y * ey[0] - z * ez[0];
+    axis[AXIS_Y] = DELTA_TOWER0_Y + x * ex[1] + y * ey[1] - z * ez[1];
+    axis[AXIS_Z] = z0 + x * ex[2] + y * ey[2] - z * ez[2];
+}
+
+uint8_t kinematics_home(void)
+{
+    uint8_t result = 0;
+
+    //all towers go up at the same time and stop at each limit switch
+    result = mc_home_axis(AXIS_Z, LIMIT_X_MASK | LIMIT_Y_MASK | LIMIT_Z_MASK);
+    if (result != 0)
+    {
+        return result;
+    }
+
+    return STATUS_OK;
+}
+
+void kinematics_lock_step(uint8_t limits_mask)
+{
+    uint8_t lock = 0;
+    lock |= (limits_mask & LIMIT_X_MASK) ? STEP0_MASK : 0;
+    lock |= (limits_mask & LIMIT_Y_MASK) ? STEP1_MASK : 0;
+    lock |= (limits_mask & LIMIT_Z_MASK) ? STEP2_MASK : 0;
+    itp_lock_stepper(lock);
+}
+
+void kinematics_apply_transform(float *axis)
+{
+    /*
+	Define your custom transform
+    */
+}
+
+void kinematics_apply_reverse_transform(float *axis)
+{
+    /*
+	Define your custom transform inverse operation
+    */
+}
+
+#endif
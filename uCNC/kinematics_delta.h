@@ -0,0 +1,62 @@
+/*
+	Name: kinematics_delta.h
+	Description: Custom kinematics definitions for linear delta machine
+
+	Copyright: Copyright (c) João Martins
+	Author: João Martins
+	Date: 18/10/2026
+
+	µCNC is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version. Please see <http://www.gnu.org/licenses/>
+
+	µCNC is distributed WITHOUT ANY WARRANTY;
+	Also without the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+	See the	GNU General Public License for more details.
+*/
+
+#ifndef KINEMATICS_DELTA_H
+#define KINEMATICS_DELTA_H
+
+/*
+	Number of axis to be configured
+*/
+#define AXIS_COUNT 3
+//defines the axis word and the internal µCNC coordinate index
+#define AXIS_X 0
+#define AXIS_Y 1
+#define AXIS_Z 2
+
+//this should match the number of linear actuators on the machines (do not change unless you know what you are doing)
+//the linear actuators 0, 1 and 2 are the towers at 210º, 330º and 90º (X, Y and Z steppers and limit switches)
+#define STEPPER_COUNT 3
+
+/*
+	Uncomment this feature to enable tool length compensation
+*/
+#define AXIS_TOOL AXIS_Z
+
+/*
+	Delta geometry (in mm)
+	DELTA_ARM_LENGTH is the length of the diagonal rods (distance between the carriage joint and the effector joint)
+	DELTA_RADIUS is the horizontal distance between the carriage joint and the effector joint with the effector at the center
+*/
+#define DELTA_ARM_LENGTH 230.0f
+#define DELTA_RADIUS 110.0f
+
+/*
+	Non linear kinematics motions are split in small linear segments
+	Sets the number of segments per second and the minimum segment length (in mm)
+*/
+#define KINEMATICS_SEGMENTS_PER_SECOND 100
+#define KINEMATICS_MIN_SEGMENT_LENGTH 0.5f
+
+/*
+	All towers are homed at the same time (up) with a Z axis homing motion.
+	Each tower stops at its own limit switch (the axis X, Y and Z limit switches) until all switches are triggered.
+	The Z homing direction should be inverted and the Z max distance sets the effector height at the home position
+*/
+#define KINEMATICS_LOCK_STEP_HOMING
+
+#endif
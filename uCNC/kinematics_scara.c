@@ -0,0 +1,182 @@
+/*
+	Name: kinematics_scara.c
+	Description: Implements all kinematics math equations to translate the motion of a SCARA machine.
+		Also implements the homing motion for this type of machine.
+
+	Copyright: Copyright (c) João Martins
+	Author: João Martins
+	Date: 18/10/2026
+
+	µCNC is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version. Please see <http://www.gnu.org/licenses/>
+
+	µCNC is distributed WITHOUT ANY WARRANTY;
+	Also without the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+	See the	GNU General Public License for more details.
+*/
+
+#include "config.h"
+
+#if (MACHINE_KINEMATICS == MACHINE_SCARA)
+#include <stdio.h>
+#include <math.h>
+#include "utils.h"
+#include "mcu.h"
+#include "settings.h"
+#include "kinematics.h"
+#include "io_control.h"
+#include "motion_control.h"
+#include "cnc.h"
+#include "grbl_interface.h"
+
+//precomputed arm geometry
+#define SCARA_ARM_LENGTH_SQR_SUM (SCARA_ARM_LENGTH_0 * SCARA_ARM_LENGTH_0 + SCARA_ARM_LENGTH_1 * SCARA_ARM_LENGTH_1)
+#define SCARA_ARM_LENGTH_PROD_INV (0.5f / (SCARA_ARM_LENGTH_0 * SCARA_ARM_LENGTH_1))
+#define SCARA_RAD_DEG 57.2957795f
+#define SCARA_DEG_RAD 0.0174532925f
+
+//shoulder angle of the last position converted to steps (the atan2 result is unwrapped against it)
+static float kinematics_scara_shoulder;
+
+//fast atan2 (polynomial aproximation of atan in the [0, 1] range)
+//the maximum error is about 2E-6 rad (under 0.001mm at 300mm from the shoulder) and takes about 1/3 of the time of atan2f
+static float kinematics_scara_atan2(float y, float x)
+{
+    float abs_x = (x < 0) ? -x : x;
+    float abs_y = (y < 0) ? -y : y;
+    float num = MIN(abs_x, abs_y);
+    float den = MAX(abs_x, abs_y);
+    if (den == 0)
+    {
+        return 0;
+    }
+
+    float a = num / den;
+    float s = a * a;
+    float r = (((((-0.0117212f * s + 0.05265332f) * s - 0.11643287f) * s + 0.19354346f) * s - 0.33262347f) * s + 0.99997726f) * a;
+    if (abs_y > abs_x)
+    {
+        r = 1.57079633f - r;
+    }
+    if (x < 0)
+    {
+        r = 3.14159265f - r;
+    }
+
+    return (y < 0) ? -r : r;
+}
+
+//homing motions of the shoulder and elbow are done in joint space
+//the joint coordinates are offset so that the homing origin (0 or max distance) matches the joint home angle
+static float kinematics_scara_home_offset(uint8_t axis, float home_angle)
+{
+    return home_angle - ((g_settings.homing_dir_invert_mask & (1 << axis)) ? g_settings.max_distance[axis] : 0);
+}
+
+void kinematics_apply_inverse(float *axis, uint32_t *steps)
+{
+    float shoulder;
+    float elbow;
+
+    if (cnc_get_exec_state(EXEC_HOMING))
+    {
+        shoulder = axis[AXIS_X] + kinematics_scara_home_offset(AXIS_X, SCARA_SHOULDER_HOME_ANGLE);
+        elbow = axis[AXIS_Y] + kinematics_scara_home_offset(AXIS_Y, SCARA_ELBOW_HOME_ANGLE);
+    }
+    else
+    {
+        //law of cosines gives the elbow angle
+        float cos_elbow = (axis[AXIS_X] * axis[AXIS_X] + axis[AXIS_Y] * axis[AXIS_Y] - SCARA_ARM_LENGTH_SQR_SUM) * SCARA_ARM_LENGTH_PROD_INV;
+        cos_elbow = MAX(-1.0f, MIN(cos_elbow, 1.0f));
+        float sin_elbow = sqrtf(1.0f - cos_elbow * cos_elbow);
+        //rotates the target by the angle of the second arm relative to the first arm (single atan2 for the shoulder)
+        float k0 = SCARA_ARM_LENGTH_0 + SCARA_ARM_LENGTH_1 * cos_elbow;
+        float k1 = SCARA_ARM_LENGTH_1 * sin_elbow;
+        shoulder = kinematics_scara_atan2(axis[AXIS_Y] * k0 - axis[AXIS_X] * k1, axis[AXIS_X] * k0 + axis[AXIS_Y] * k1) * SCARA_RAD_DEG;
+        elbow = kinematics_scara_atan2(sin_elbow, cos_elbow) * SCARA_RAD_DEG;
+        //the atan2 wraps at +/-180 degrees (the shoulder turns to the nearest equivalent angle instead of going back a full turn)
+        while ((shoulder - kinematics_scara_shoulder) > 180.0f)
+        {
+            shoulder -= 360.0f;
+        }
+        while ((shoulder - kinematics_scara_shoulder) < -180.0f)
+        {
+            shoulder += 360.0f;
+        }
+    }
+
+    kinematics_scara_shoulder = shoulder;
+
+    steps[0] = (uint32_t)lroundf(g_settings.step_per_mm[0] * shoulder);
+    steps[1] = (uint32_t)lroundf(g_settings.step_per_mm[1] * elbow);
+    steps[2] = (uint32_t)lroundf(g_settings.step_per_mm[2] * axis[AXIS_Z]);
+}
+
+void kinematics_apply_forward(uint32_t *steps, float *axis)
+{
+    float shoulder = (float)(((int32_t)steps[0]) / g_settings.step_per_mm[0]);
+    float elbow = (float)(((int32_t)steps[1]) / g_settings.step_per_mm[1]);
+
+    if (cnc_get_exec_state(EXEC_HOMING))
+    {
+        axis[AXIS_X] = shoulder - kinematics_scara_home_offset(AXIS_X, SCARA_SHOULDER_HOME_ANGLE);
+        axis[AXIS_Y] = elbow - kinematics_scara_home_offset(AXIS_Y, SCARA_ELBOW_HOME_ANGLE);
+    }
+    else
+    {
+        shoulder *= SCARA_DEG_RAD;
+        elbow *= SCARA_DEG_RAD;
+        axis[AXIS_X] = SCARA_ARM_LENGTH_0 * cosf(shoulder) + SCARA_ARM_LENGTH_1 * cosf(shoulder + elbow);
+        axis[AXIS_Y] = SCARA_ARM_LENGTH_0 * sinf(shoulder) + SCARA_ARM_LENGTH_1 * sinf(shoulder + elbow);
+    }
+
+    axis[AXIS_Z] = (float)(((int32_t)steps[2]) / g_settings.step_per_mm[2]);
+}
+
+uint8_t kinematics_home(void)
+{
+    uint8_t result = 0;
+
+    result = mc_home_axis(AXIS_Z, LIMIT_Z_MASK);
+    if (result != 0)
+    {
+        return result;
+    }
+
+    result = mc_home_axis(AXIS_X, LIMIT_X_MASK);
+    if (result != 0)
+    {
+        return result;
+    }
+
+    result = mc_home_axis(AXIS_Y, LIMIT_Y_MASK);
+    if (result != 0)
+    {
+        return result;
+    }
+
+    return STATUS_OK;
+}
+
+void kinematics_lock_step(uint8_t limits_mask)
+{
+    // do nothing
+}
+
+void kinematics_apply_transform(float *axis)
+{
+    /*
+	Define your custom transform
+    */
+}
+
+void kinematics_apply_reverse_transform(float *axis)
+{
+    /*
+	Define your custom transform inverse operation
+    */
+}
+
+#endif
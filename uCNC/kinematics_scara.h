@@ -0,0 +1,64 @@
+/*
+	Name: kinematics_scara.h
+	Description: Custom kinematics definitions for SCARA machine
+
+	Copyright: Copyright (c) João Martins
+	Author: João Martins
+	Date: 18/10/2026
+
+	µCNC is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version. Please see <http://www.gnu.org/licenses/>
+
+	µCNC is distributed WITHOUT ANY WARRANTY;
+	Also without the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+	See the	GNU General Public License for more details.
+*/
+
+#ifndef KINEMATICS_SCARA_H
+#define KINEMATICS_SCARA_H
+
+/*
+	Number of axis to be configured
+*/
+#define AXIS_COUNT 3
+//defines the axis word and the internal µCNC coordinate index
+#define AXIS_X 0
+#define AXIS_Y 1
+#define AXIS_Z 2
+
+//this should match the number of linear actuators on the machines (do not change unless you know what you are doing)
+//the linear actuator 0 is the shoulder joint, 1 is the elbow joint and 2 is the Z axis
+//the shoulder and elbow steps per mm settings are the steps per degree of each joint
+#define STEPPER_COUNT 3
+
+/*
+	Uncomment this feature to enable tool length compensation
+*/
+#define AXIS_TOOL AXIS_Z
+
+/*
+	SCARA geometry (in mm)
+	The shoulder joint is at the XY origin
+	The shoulder angle is measured from the X axis and the elbow angle is measured from the first arm (0º is the arm fully extended)
+	The elbow angle is always positive and the shoulder angle should not cross 180º (the arm base should be placed at the back of the work area)
+*/
+#define SCARA_ARM_LENGTH_0 150.0f
+#define SCARA_ARM_LENGTH_1 150.0f
+
+/*
+	Joint angles (in degrees) at the home position (after the homing pull-off)
+	The shoulder (X) and elbow (Y) homing motions are executed in joint space
+*/
+#define SCARA_SHOULDER_HOME_ANGLE 0.0f
+#define SCARA_ELBOW_HOME_ANGLE 150.0f
+
+/*
+	Non linear kinematics motions are split in small linear segments
+	Sets the number of segments per second and the minimum segment length (in mm)
+*/
+#define KINEMATICS_SEGMENTS_PER_SECOND 100
+#define KINEMATICS_MIN_SEGMENT_LENGTH 0.5f
+
+#endif
@@ -28,6 +28,10 @@
 #include "kinematics_cartesian.h"
 #elif (MACHINE_KINEMATICS == MACHINE_COREXY)
 #include "kinematics_corexy.h"
+#elif (MACHINE_KINEMATICS == MACHINE_DELTA)
+#include "kinematics_delta.h"
+#elif (MACHINE_KINEMATICS == MACHINE_SCARA)
+#include "kinematics_scara.h"
 #else
 #error Kinematics not implemented
 #endif
@@ -22,5 +22,7 @@
 #define MACHINE_CARTESIAN 1
 #define MACHINE_COREXY 2
 #define MACHINE_CARTESIAN_XY2 3
+#define MACHINE_DELTA 4
+#define MACHINE_SCARA 5
 
 #endif
@@ -84,6 +84,13 @@ void mcu_putc(char c);
 char mcu_getc(void);
 #endif
 
+#ifdef ENABLE_BAUD_SWITCH
+//baud rate generated by the mcu for the requested baud rate (0 if it can't be generated)
+uint32_t mcu_get_baudrate(uint32_t baud);
+//changes the baud rate (waits for the last char to be sent)
+void mcu_set_baudrate(uint32_t baud);
+#endif
+
 //ISR
 //enables all interrupts on the mcu. Must be called to enable all IRS functions
 #ifndef mcu_enable_interrupts
@@ -105,7 +112,7 @@ void mcu_change_step_ISR(uint16_t ticks, uint16_t prescaller);
 void mcu_step_stop_ISR(void);
 
 //Custom delay function
-//void mcu_delay_ms(uint16_t miliseconds);
+void mcu_delay_ms(uint16_t miliseconds);
 
 //Non volatile memory
 uint8_t mcu_eeprom_getc(uint16_t address);
@@ -103,6 +103,8 @@
 #define DOUT0_PORT B
 #define DOUT1_BIT 3
 #define DOUT1_PORT C
+//RTS hardware flow control pin (see ENABLE_RTS_FLOW_CONTROL)
+//#define RTS DOUT1
 
 //Stepper enable pin. For Grbl on Uno board a single pin is used
 #define STEP0_EN_BIT 0
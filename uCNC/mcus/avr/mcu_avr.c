@@ -48,6 +48,7 @@
 #include <avr/interrupt.h>
 #include <avr/pgmspace.h>
 #include <avr/wdt.h>
+#include <util/delay.h>
 //#include <avr/delay.h>
 #include <avr/eeprom.h>
 #include <avr/cpufunc.h>
@@ -832,6 +833,55 @@ char mcu_getc(void)
     return COM_INREG;
 }
 
+#ifdef ENABLE_BAUD_SWITCH
+/*
+	The baud rate is F_CPU / (16 * (UBRR + 1)) or F_CPU / (8 * (UBRR + 1)) with the baud doubler (used from 57600 baud)
+	Baud rate errors at 16MHz
+		9600 +0.2%, 57600 -0.8%, 115200 +2.1%, 230400 -3.5%, 250000 0%, 500000 0%, 1000000 0%, 2000000 0% (max)
+	Baud rate errors at 20MHz
+		9600 +0.2%, 57600 +0.9%, 115200 -1.4%, 230400 -1.4%, 250000 0%, 500000 0%, 1000000 -16.7%, 2500000 0% (max)
+	The rates with more than 2.5% error are refused by $U
+*/
+static uint16_t mcu_get_ubrr(uint32_t baud)
+{
+    return (baud < 57600) ? (((F_CPU / (8UL * baud)) - 1) / 2) : (((F_CPU / (4UL * baud)) - 1) / 2);
+}
+
+uint32_t mcu_get_baudrate(uint32_t baud)
+{
+    if (baud > (F_CPU / 8UL))
+    {
+        return 0;
+    }
+
+    uint16_t ubrr = mcu_get_ubrr(baud);
+    if (ubrr > 0x0FFF)
+    {
+        return 0;
+    }
+
+    return (baud < 57600) ? (F_CPU / (16UL * (ubrr + 1))) : (F_CPU / (8UL * (ubrr + 1)));
+}
+
+void mcu_set_baudrate(uint32_t baud)
+{
+    uint16_t UBRR_value = mcu_get_ubrr(baud);
+    //waits for the last char to be sent (TXC is not cleared by the TX ISR)
+    loop_until_bit_is_set(UCSRA, UDRE);
+    _delay_ms(2);
+    if (baud < 57600)
+    {
+        UCSRA &= ~(1 << U2X);
+    }
+    else
+    {
+        UCSRA |= (1 << U2X);
+    }
+    UBRRH = UBRR_value >> 8;
+    UBRRL = UBRR_value;
+}
+#endif
+
 //RealTime
 void mcu_freq_to_clocks(float frequency, uint16_t *ticks, uint16_t *prescaller)
 {
@@ -925,13 +975,13 @@ static __attribute__((always_inline)) void mcu_delay_1ms(void)
 	}while(--loop);
 }*/
 
-/*void mcu_delay_ms(uint16_t miliseconds)
+void mcu_delay_ms(uint16_t miliseconds)
 {
-	do{
-		_delay_ms(1);
-	}while(--miliseconds);
-
-}*/
+    while (miliseconds--)
+    {
+        _delay_ms(1);
+    }
+}
 
 //This was copied from grbl
 #ifndef EEPE
@@ -114,6 +114,8 @@
 
 //in this case include de mcumap file to generate the definition do DOUT15 and assign to LED
 #define LED DOUT15
+//RTS hardware flow control pin (see ENABLE_RTS_FLOW_CONTROL)
+//#define RTS DOUT2
 
 #include "mcumap_stm32f10x.h"
 
@@ -729,11 +729,8 @@ void mcu_stop_send(void)
 #endif
 }
 
-#ifdef TX_BUFFER_SIZE
-#undef TX_BUFFER_SIZE
-#endif
-#define TX_BUFFER_SIZE 128
-static uint8_t mcu_tx_buffer[TX_BUFFER_SIZE];
+#define USB_TX_BUFFER_SIZE 128
+static uint8_t mcu_tx_buffer[USB_TX_BUFFER_SIZE];
 
 extern uint8_t CDC_Transmit_FS(uint8_t *Buf, uint16_t Len);
 
@@ -750,7 +747,7 @@ void mcu_putc(char c)
 	static uint16_t i = 0;
 	mcu_tx_buffer[i] = (uint8_t)c;
 	i++;
-	if (c == '\n' || i == (TX_BUFFER_SIZE - 1))
+	if (c == '\n' || i == (USB_TX_BUFFER_SIZE - 1))
 	{
 		mcu_tx_buffer[i] = 0;
 		while (CDC_Transmit_FS(mcu_tx_buffer, i))
@@ -769,6 +766,39 @@ char mcu_getc(void)
 #endif
 }
 
+#ifdef ENABLE_BAUD_SWITCH
+/*
+	The baud rate is F_CPU / BRR (16x oversampling with a 4 bit fractional divider)
+	Baud rate errors at 72MHz
+		115200 0%, 230400 -0.2%, 250000 0%, 460800 +0.2%, 500000 0%, 921600 +0.2%, 1000000 0%, 2000000 0%, 4000000 0%, 4500000 0% (max)
+	The rates with more than 2.5% error are refused by $U
+	The USB VCP ignores the baud rate
+*/
+uint32_t mcu_get_baudrate(uint32_t baud)
+{
+#ifdef COM_PORT
+	uint32_t brr = (F_CPU + (baud >> 1)) / baud;
+	if (brr < 16 || brr > 0xFFFF)
+	{
+		return 0;
+	}
+	return (F_CPU / brr);
+#else
+	return baud;
+#endif
+}
+
+void mcu_set_baudrate(uint32_t baud)
+{
+#ifdef COM_PORT
+	//waits for the transmission to complete
+	while (!(COM_USART->SR & (1 << 6)))
+		;
+	COM_USART->BRR = (uint16_t)((F_CPU + (baud >> 1)) / baud);
+#endif
+}
+#endif
+
 //ISR
 //enables all interrupts on the mcu. Must be called to enable all IRS functions
 #ifndef mcu_enable_interrupts
@@ -836,7 +866,10 @@ void mcu_step_stop_ISR(void)
 }
 
 //Custom delay function
-//void mcu_delay_ms(uint16_t miliseconds);
+void mcu_delay_ms(uint16_t miliseconds)
+{
+	HAL_Delay(miliseconds);
+}
 
 //Non volatile memory
 uint8_t mcu_eeprom_getc(uint16_t address)
@@ -33,6 +33,13 @@
 //defines the maximum and minimum step rates
 #define F_STEP_MAX 30000
 #define F_STEP_MIN 4
+//defines the serial buffers sizes (large RX buffer to keep more lines in flight)
+#ifndef RX_BUFFER_SIZE
+#define RX_BUFFER_SIZE 1024
+#endif
+#ifndef TX_BUFFER_SIZE
+#define TX_BUFFER_SIZE 256
+#endif
 //defines special mcu to access flash strings and arrays
 #define __rom__
 #define __romstr__
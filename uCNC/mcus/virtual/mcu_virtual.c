@@ -98,6 +98,7 @@ volatile unsigned long *pulse_counter_ptr;
 volatile unsigned long integrator_counter = 0;
 volatile bool pulse_enabled = false;
 volatile bool send_char = false;
+volatile bool xoff_received = false;
 volatile unsigned char uart_char;
 
 pthread_t thread_id;
@@ -117,6 +118,19 @@ void *comsimul(void)
 #endif
 		if (c != 0)
 		{
+#if (defined(ENABLE_XONXOFF_FLOW_CONTROL) || defined(ENABLE_RTS_FLOW_CONTROL))
+			//the host stops sending while the flow control is stopped
+#ifdef ENABLE_RTS_FLOW_CONTROL
+			while (mcu_get_output(RTS))
+#else
+			while (xoff_received)
+#endif
+			{
+				usleep(1);
+			}
+			uart_char = c;
+			serial_rx_isr(c);
+#else
 			uart_char = c;
 			serial_rx_isr(c);
 			if(c == '\n' | c=='\r')
@@ -126,6 +140,7 @@ void *comsimul(void)
 					usleep(1);
 				}
 			}
+#endif
 		}
 	}
 }
@@ -310,6 +325,14 @@ void mcu_stop_send(void)
 
 void mcu_putc(char c)
 {
+#ifdef ENABLE_XONXOFF_FLOW_CONTROL
+	//the host side of the software flow control
+	if (c == XOFF || c == XON)
+	{
+		xoff_received = (c == XOFF);
+		return;
+	}
+#endif
 #ifdef USECONSOLE
 	putchar(c);
 #else
@@ -399,8 +422,21 @@ void mcu_step_stop_ISR(void)
 
 void mcu_delay_ms(uint16_t miliseconds)
 {
+	usleep((uint32_t)miliseconds * 1000);
+}
+
+#ifdef ENABLE_BAUD_SWITCH
+//the virtual serial port keeps its baud rate
+uint32_t mcu_get_baudrate(uint32_t baud)
+{
+	return baud;
 }
 
+void mcu_set_baudrate(uint32_t baud)
+{
+}
+#endif
+
 void mcu_printfp(const char *__fmt, ...)
 {
 	char buffer[50];
@@ -21,8 +21,13 @@
 
 #include <stdint.h>
 #define F_CPU 1000
+//the host tests can set the step rate limits
+#ifndef F_STEP_MAX
 #define F_STEP_MAX 500
+#endif
+#ifndef F_STEP_MIN
 #define F_STEP_MIN 1
+#endif
 #define __rom__
 #define __romstr__
 #define __romarr__ const char
@@ -63,7 +68,9 @@ extern virtports_t virtualports;
 #define DOUT1 8
 #define DOUT2 9
 #define DOUT3 10
+#define DOUT4 12
 #define STEPS_EN DOUT3
+#define RTS DOUT4
 #define OUTREG virtualports->outputs
 
 #define mcu_get_output(X) (OUTREG & (1<<(X)))
@@ -81,10 +88,13 @@ extern virtports_t virtualports;
 #define LIMIT_Z 6
 #define LIMIT_Y2 6
 #define PROBE 7
+#define DIN0 8
 
 #define INREG virtualports->inputs
 #define mcu_get_input(X) (INREG & (1<<(X)))
 
+#define ANALOG0 0
+
 #define COM_INREG virtualports->uart
 #define COM_OUTREG virtualports->uart
 
@@ -38,6 +38,10 @@
 #define M_COS_TAYLOR_1 0.16666667163372039794921875
 #endif
 
+#if (defined(ENABLE_RAPID_INDEPENDENT_AXIS) && (MACHINE_KINEMATICS != MACHINE_CARTESIAN))
+#error "The independent axis rapid motions need the cartesian kinematics (each axis is driven by its own linear actuator)"
+#endif
+
 static bool mc_checkmode;
 static float mc_last_target[AXIS_COUNT];
 static float mc_prev_transformed_target[AXIS_COUNT];
@@ -45,6 +49,29 @@ static float mc_prev_transformed_target[AXIS_COUNT];
 #ifdef ENABLE_BACKLASH_COMPENSATION
 static uint8_t mc_last_dirbits;
 #endif
+#ifdef ENABLE_G64_PATH_BLENDING
+static float mc_blend_tolerance;
+static bool mc_blend_pending;
+static float mc_blend_start[AXIS_COUNT];
+static float mc_blend_corner[AXIS_COUNT];
+static motion_data_t mc_blend_data;
+#endif
+//tool changes waiting for the next block
+static bool mc_tools_pending;
+#ifdef USE_SPINDLE
+static int16_t mc_pending_spindle;
+#endif
+#ifdef USE_COOLANT
+static uint8_t mc_pending_coolant;
+#endif
+#ifdef USE_SPINDLE
+//spindle model (commanded speed and time in seconds until the spindle reaches it)
+static int16_t mc_spindle_rpm;
+static float mc_spindle_settle;
+#endif
+
+static uint8_t mc_line_segment(float *target, motion_data_t *block_data);
+static uint8_t mc_line_planner(float *target, motion_data_t *block_data);
 
 void mc_init(void)
 {
@@ -52,6 +79,12 @@ void mc_init(void)
     mc_checkmode = false;
     memset(mc_last_target, 0, sizeof(mc_last_target));
     memset(mc_prev_transformed_target, 0, sizeof(mc_prev_transformed_target));
+#ifdef ENABLE_G64_PATH_BLENDING
+    mc_blend_tolerance = 0;
+#endif
+#endif
+#ifdef ENABLE_MESH_COMPENSATION
+    kinematics_mesh_load();
 #endif
     mc_resync_position();
 }
@@ -66,18 +99,562 @@ bool mc_toogle_checkmode(void)
     mc_checkmode = !mc_checkmode;
     return mc_checkmode;
 }
+#ifdef ENABLE_G64_PATH_BLENDING
+void mc_set_blend_tolerance(float tolerance)
+{
+    mc_blend_tolerance = tolerance;
+}
+
+//sends the motion kept by the path blending without modifications
+uint8_t mc_blend_flush(void)
+{
+    if (!mc_blend_pending)
+    {
+        return STATUS_OK;
+    }
+
+    mc_blend_pending = false;
+    return mc_line_segment(mc_blend_corner, &mc_blend_data);
+}
+
+//G64 P<tolerance> path blending
+//the last line is kept until the next line arrives
+//the corner between both lines is then replaced by a chord pair (the tangent points of a parabola with the control point at the corner and the parabola point between them)
+//the chords deviate at most at the middle point that is placed at the tolerance from the corner
+//the junctions of the chords are half of the corner angle and are limited by the planner like any other junction
+static uint8_t mc_blend(float *target, motion_data_t *block_data)
+{
+    float dir_in[AXIS_COUNT];
+    float dir_out[AXIS_COUNT];
+    float len_in = 0;
+    float len_out = 0;
+    float cos_theta = 0;
+    uint8_t error;
+
+    if (!mc_blend_pending)
+    {
+        memcpy(mc_blend_start, mc_last_target, sizeof(mc_blend_start));
+        memcpy(mc_blend_corner, target, sizeof(mc_blend_corner));
+        memcpy(&mc_blend_data, block_data, sizeof(motion_data_t));
+        mc_blend_pending = true;
+        return STATUS_OK;
+    }
+
+    for (uint8_t i = AXIS_COUNT; i != 0;)
+    {
+        i--;
+        dir_in[i] = mc_blend_corner[i] - mc_blend_start[i];
+        dir_out[i] = target[i] - mc_blend_corner[i];
+        len_in += fast_flt_pow2(dir_in[i]);
+        len_out += fast_flt_pow2(dir_out[i]);
+        cos_theta += dir_in[i] * dir_out[i];
+    }
+
+    //null motion
+    if (len_out == 0)
+    {
+        return STATUS_OK;
+    }
+
+    len_in = fast_flt_sqrt(len_in);
+    len_out = fast_flt_sqrt(len_out);
+    cos_theta /= (len_in * len_out);
+
+    //only blends motions of the same type that don't need to stop between them
+    if (len_in != 0 && cos_theta < 0.99999f && cos_theta > -0.999f && !block_data->dwell && block_data->spindle == mc_blend_data.spindle
+#ifdef USE_COOLANT
+        && block_data->coolant == mc_blend_data.coolant
+#endif
+    )
+    {
+        //half of the deviation angle
+        float sin_half = fast_flt_sqrt(fast_flt_div2(1.0f - cos_theta));
+        //distance from the corner to the tangent points (the middle point is at dist * sin(theta/2) / 2 from the corner)
+        float dist = fast_flt_mul2(mc_blend_tolerance) / sin_half;
+        dist = MIN(dist, len_in);
+        dist = MIN(dist, fast_flt_div2(len_out));
+
+        float blend_in[AXIS_COUNT];
+        float blend_mid[AXIS_COUNT];
+        float blend_out[AXIS_COUNT];
+        for (uint8_t i = AXIS_COUNT; i != 0;)
+        {
+            i--;
+            blend_in[i] = mc_blend_corner[i] - dir_in[i] * dist / len_in;
+            blend_out[i] = mc_blend_corner[i] + dir_out[i] * dist / len_out;
+            blend_mid[i] = fast_flt_div2(mc_blend_corner[i] + fast_flt_div2(blend_in[i] + blend_out[i]));
+        }
+
+        //sends the line until the start of the blend
+        if (dist < len_in)
+        {
+            error = mc_line_segment(blend_in, &mc_blend_data);
+            if (error)
+            {
+                return error;
+            }
+        }
+
+        mc_blend_data.feed = MIN(mc_blend_data.feed, block_data->feed);
+        mc_blend_data.dwell = 0;
+        error = mc_line_segment(blend_mid, &mc_blend_data);
+        if (error)
+        {
+            return error;
+        }
+
+        error = mc_line_segment(blend_out, &mc_blend_data);
+        if (error)
+        {
+            return error;
+        }
+
+        memcpy(mc_blend_start, blend_out, sizeof(mc_blend_start));
+    }
+    else
+    {
+        memcpy(mc_blend_start, mc_blend_corner, sizeof(mc_blend_start));
+        error = mc_line_segment(mc_blend_corner, &mc_blend_data);
+        if (error)
+        {
+            return error;
+        }
+    }
+
+    memcpy(mc_blend_corner, target, sizeof(mc_blend_corner));
+    memcpy(&mc_blend_data, block_data, sizeof(motion_data_t));
+    return STATUS_OK;
+}
+#endif
+
 // all motions should go through mc_line before entering the final motion pipeline
+#ifdef USE_SPINDLE
+//updates the spindle model with a new spindle speed
+static void mc_spindle_update(int16_t spindle)
+{
+    if (spindle == mc_spindle_rpm)
+    {
+        return;
+    }
+
+#ifdef LASER_MODE
+    //the laser doesn't need to change speed
+    if (g_settings.laser_mode)
+    {
+        mc_spindle_rpm = spindle;
+        return;
+    }
+#endif
+
+    if (g_settings.spindle_acceleration > 0)
+    {
+        //the spindle might still be changing speed (adds the time of the new speed change)
+        mc_spindle_settle += fabsf((float)spindle - (float)mc_spindle_rpm) / g_settings.spindle_acceleration;
+    }
+    else
+    {
+        mc_spindle_settle = DELAY_ON_SPINDLE_SPEED_CHANGE;
+    }
+
+    mc_spindle_rpm = spindle;
+}
+
+//motions that need the spindle wait for it to reach the speed
+//the other motions (rapids) run while the spindle changes speed
+static uint8_t mc_spindle_sync(float *target, motion_data_t *block_data)
+{
+    mc_spindle_update(block_data->spindle);
+    if (mc_spindle_settle <= 0)
+    {
+        return STATUS_OK;
+    }
+
+    //rapid motions have the max feed (same check as the acceleration class)
+    bool rapid = (block_data->feed == FLT_MAX && !CHECKFLAG(block_data->motion_mode, MOTIONCONTROL_MODE_INVERSEFEED));
+    if (!rapid && block_data->spindle != 0)
+    {
+        uint16_t dwell = block_data->dwell;
+        block_data->dwell = (uint16_t)ceilf(mc_spindle_settle * 10.0f);
+        mc_spindle_settle = 0;
+#ifdef SPINDLE_AT_SPEED
+        block_data->spindle_wait = true;
+#endif
+        uint8_t error = mc_dwell(block_data);
+#ifdef SPINDLE_AT_SPEED
+        block_data->spindle_wait = false;
+#endif
+        block_data->dwell = dwell;
+        return error;
+    }
+
+    //the motion time is estimated without the acceleration (never exceeds the motion time)
+    if (!CHECKFLAG(block_data->motion_mode, MOTIONCONTROL_MODE_INVERSEFEED))
+    {
+        float dist = 0;
+        float speed = 0;
+        float last[AXIS_COUNT];
+        mc_get_position(last);
+        for (uint8_t i = AXIS_COUNT; i != 0;)
+        {
+            i--;
+            float d = target[i] - last[i];
+            dist += d * d;
+        }
+
+        for (uint8_t i = STEPPER_COUNT; i != 0;)
+        {
+            i--;
+            speed = MAX(speed, g_settings.max_feed_rate[i]);
+        }
+
+        speed = MIN(speed, block_data->feed);
+        if (speed > 0)
+        {
+            mc_spindle_settle = MAX(mc_spindle_settle - sqrtf(dist) * 60.0f / speed, 0);
+        }
+    }
+
+    return STATUS_OK;
+}
+#endif
+
+#ifdef ENABLE_RAPID_INDEPENDENT_AXIS
+//time (s) of a motion that starts and ends stopped (the top speed isn't reached in short motions)
+static float mc_rapid_time(float distance, float speed, float accel)
+{
+    if (distance * accel < speed * speed)
+    {
+        return 2.0f * sqrtf(distance / accel);
+    }
+
+    return distance / speed + speed / accel;
+}
+
+//each axis of the rapid motion moves with its own maximum rate and acceleration (the path isn't a straight line)
+//the axes profiles are sampled in time and sent as short rapid motions
+//returns false (without sending anything) if the straight line isn't slower than the independent axes by at least RAPID_INDEPENDENT_AXIS_MIN_GAIN
+static bool mc_rapid_independent(float *target, motion_data_t *block_data, uint8_t *error)
+{
+    float start[AXIS_COUNT];
+    float dist[AXIS_COUNT];
+    float speed[AXIS_COUNT];
+    float accel[AXIS_COUNT];
+    float line_dist = 0;
+    float line_speed = FLT_MAX;
+    float line_accel = FLT_MAX;
+    float time = 0;
+    float accel_factor = g_settings.accel_factor[MOTIONCONTROL_MODE_ACCEL_RAPID >> MOTIONCONTROL_MODE_ACCEL_SHIFT];
+
+    memcpy(start, mc_last_target, sizeof(start));
+#ifdef ENABLE_G64_PATH_BLENDING
+    //the motion starts at the corner kept by the path blending
+    if (mc_blend_pending)
+    {
+        memcpy(start, mc_blend_corner, sizeof(start));
+    }
+#endif
+    for (uint8_t i = AXIS_COUNT; i != 0;)
+    {
+        i--;
+        dist[i] = fabsf(target[i] - start[i]);
+        line_dist += dist[i] * dist[i];
+    }
+
+    line_dist = sqrtf(line_dist);
+    if (line_dist == 0)
+    {
+        return false;
+    }
+
+    for (uint8_t i = AXIS_COUNT; i != 0;)
+    {
+        i--;
+        if (dist[i] == 0)
+        {
+            continue;
+        }
+
+        //the straight line is clamped by the most limited axis (same as the planner)
+        speed[i] = g_settings.max_feed_rate[i] * MIN_SEC_MULT;
+        accel[i] = g_settings.acceleration[i] * accel_factor;
+        float ratio = line_dist / dist[i];
+        line_speed = MIN(line_speed, speed[i] * ratio);
+        line_accel = MIN(line_accel, accel[i] * ratio);
+        //top speed of the axis moving alone
+        speed[i] = MIN(speed[i], sqrtf(dist[i] * accel[i]));
+        time = MAX(time, mc_rapid_time(dist[i], speed[i], accel[i]));
+    }
+
+    if (mc_rapid_time(line_dist, line_speed, line_accel) < time * (1.0f + RAPID_INDEPENDENT_AXIS_MIN_GAIN))
+    {
+        return false;
+    }
+
+    //the target must be inside the travel limits before any motion (the segments are inside the box between the start and the target)
+    float limits[AXIS_COUNT];
+    memcpy(limits, target, sizeof(limits));
+    kinematics_apply_transform(limits);
+    if (!io_check_boundaries(limits))
+    {
+        return false;
+    }
+
+#ifdef ENABLE_G64_PATH_BLENDING
+    *error = mc_blend_flush();
+    if (*error)
+    {
+        return true;
+    }
+#endif
+
+    float inc = time / RAPID_INDEPENDENT_AXIS_SEGMENTS;
+    for (uint8_t s = 1; s < RAPID_INDEPENDENT_AXIS_SEGMENTS; s++)
+    {
+        float point[AXIS_COUNT];
+        float t = inc * (float)s;
+        for (uint8_t i = AXIS_COUNT; i != 0;)
+        {
+            i--;
+            point[i] = target[i];
+            if (dist[i] == 0)
+            {
+                continue;
+            }
+
+            //distance traveled at the time t (accelerates, moves at the top speed and deaccelerates)
+            float accel_time = speed[i] / accel[i];
+            float axis_time = dist[i] / speed[i] + accel_time;
+            float d;
+            if (t >= axis_time)
+            {
+                continue;
+            }
+            else if (t < accel_time)
+            {
+                d = 0.5f * accel[i] * t * t;
+            }
+            else if (t < (axis_time - accel_time))
+            {
+                d = 0.5f * speed[i] * accel_time + speed[i] * (t - accel_time);
+            }
+            else
+            {
+                float r = axis_time - t;
+                d = dist[i] - 0.5f * accel[i] * r * r;
+            }
+
+            point[i] = (target[i] > start[i]) ? (start[i] + d) : (start[i] - d);
+        }
+
+        *error = mc_line_segment(point, block_data);
+        if (*error)
+        {
+            return true;
+        }
+    }
+
+    *error = mc_line_segment(target, block_data);
+    return true;
+}
+#endif
+
+uint8_t mc_line(float *target, motion_data_t *block_data)
+{
+#ifdef USE_SPINDLE
+    if (!mc_checkmode && !cnc_get_exec_state(EXEC_JOG | EXEC_HOMING))
+    {
+        uint8_t error = mc_spindle_sync(target, block_data);
+        if (error)
+        {
+            return error;
+        }
+    }
+#endif
+
+#ifdef ENABLE_RAPID_INDEPENDENT_AXIS
+    if (block_data->feed == FLT_MAX && !mc_checkmode && !CHECKFLAG(block_data->motion_mode, MOTIONCONTROL_MODE_INVERSEFEED) && !cnc_get_exec_state(EXEC_JOG | EXEC_HOMING))
+    {
+        uint8_t error = STATUS_OK;
+        if (mc_rapid_independent(target, block_data, &error))
+        {
+            return error;
+        }
+    }
+#endif
+
+#ifdef ENABLE_G64_PATH_BLENDING
+    if (mc_blend_tolerance > 0 && !mc_checkmode && CHECKFLAG(block_data->motion_mode, PLANNER_MOTION_CONTINUOUS) && !CHECKFLAG(block_data->motion_mode, MOTIONCONTROL_MODE_INVERSEFEED) && !cnc_get_exec_state(EXEC_JOG | EXEC_HOMING))
+    {
+        return mc_blend(target, block_data);
+    }
+
+    uint8_t error = mc_blend_flush();
+    if (error)
+    {
+        return error;
+    }
+#endif
+
+    return mc_line_segment(target, block_data);
+}
+
+//sends a straight line to the planner
+//non linear kinematics and transformations split the line in small segments (the actuators motion is only linear in a short distance)
+static uint8_t mc_line_segment(float *target, motion_data_t *block_data)
+{
+#if (defined(KINEMATICS_SEGMENTS_PER_SECOND) || defined(ENABLE_TOOL_CENTER_POINT) || defined(ENABLE_MESH_COMPENSATION))
+    //homing motions are executed in the actuators space and are not split
+    if (!mc_checkmode && !cnc_get_exec_state(EXEC_HOMING) && !CHECKFLAG(block_data->motion_mode, MOTIONCONTROL_MODE_NOMOTION))
+    {
+        float start[AXIS_COUNT];
+        float dir[AXIS_COUNT];
+        uint16_t segment_count = 1;
+
+        //the motion starts at the end of the last motion sent to the planner (not the position programmed with path blending)
+        memcpy(start, mc_last_target, sizeof(start));
+        for (uint8_t i = AXIS_COUNT; i != 0;)
+        {
+            i--;
+            dir[i] = target[i] - start[i];
+        }
+
+#ifdef KINEMATICS_SEGMENTS_PER_SECOND
+        float dist = 0;
+        float speed = 0;
+        for (uint8_t i = AXIS_COUNT; i != 0;)
+        {
+            i--;
+            dist += dir[i] * dir[i];
+        }
+
+        for (uint8_t i = STEPPER_COUNT; i != 0;)
+        {
+            i--;
+            speed = MAX(speed, g_settings.max_feed_rate[i]);
+        }
+
+        dist = sqrtf(dist);
+        //gets the speed in mm/s (rapid motions use the fastest linear actuator max feed)
+        if (CHECKFLAG(block_data->motion_mode, MOTIONCONTROL_MODE_INVERSEFEED))
+        {
+            speed = dist * block_data->feed;
+        }
+        else
+        {
+            speed = MIN(speed, block_data->feed);
+        }
+
+        speed *= MIN_SEC_MULT;
+        float segment_length = MAX(speed * (1.0f / KINEMATICS_SEGMENTS_PER_SECOND), KINEMATICS_MIN_SEGMENT_LENGTH);
+        float segments = ceilf(dist / segment_length);
+        segment_count = (uint16_t)MIN(segments, UINT16_MAX);
+#endif
+#ifdef ENABLE_TOOL_CENTER_POINT
+        //the rotary axis motion turns the linear motion in a curve (jog motions are not transformed)
+        if (!cnc_get_exec_state(EXEC_JOG))
+        {
+            uint16_t tcp_segments = kinematics_tcp_segments(start, target);
+            segment_count = MAX(segment_count, tcp_segments);
+        }
+#endif
+
+        //the height map compensation is linear only inside each grid cell
+        bool mesh_split = false;
+#ifdef ENABLE_MESH_COMPENSATION
+        mesh_split = !cnc_get_exec_state(EXEC_JOG) && (kinematics_mesh_next_crossing(start, target, 0) < 1.0f);
+#endif
+
+        if (segment_count > 1 || mesh_split)
+        {
+            float feed = block_data->feed;
+            float inc = 1.0f / (float)segment_count;
+            float t = 0;
+            uint16_t s = 1;
+            for (;;)
+            {
+                float point[AXIS_COUNT];
+                float t_next = (s < segment_count) ? (inc * (float)s) : 1.0f;
+                bool crossing = false;
+#ifdef ENABLE_MESH_COMPENSATION
+                //the segment ends at the next grid line if it comes first
+                if (mesh_split)
+                {
+                    float t_cross = kinematics_mesh_next_crossing(start, target, t);
+                    if (t_cross < t_next)
+                    {
+                        t_next = t_cross;
+                        crossing = true;
+                    }
+                }
+#endif
+                if (!crossing)
+                {
+                    s++;
+                }
+
+                if (CHECKFLAG(block_data->motion_mode, MOTIONCONTROL_MODE_INVERSEFEED))
+                {
+                    //split the required time to complete the motion with the segments length
+                    block_data->feed = feed * (t_next - t);
+                }
+
+                if (t_next >= 1.0f)
+                {
+                    break;
+                }
+
+                for (uint8_t i = AXIS_COUNT; i != 0;)
+                {
+                    i--;
+                    point[i] = start[i] + dir[i] * t_next;
+                }
+
+                uint8_t error = mc_line_planner(point, block_data);
+                if (error)
+                {
+                    block_data->feed = feed;
+                    return error;
+                }
+
+                t = t_next;
+            }
+
+            uint8_t error = mc_line_planner(target, block_data);
+            block_data->feed = feed;
+            return error;
+        }
+    }
+#endif
+
+    return mc_line_planner(target, block_data);
+}
+
 // after this stage the motion follows a pipeline that performs the following steps
 // 1. decouples the target point from the remaining pipeline
 // 2. applies all kinematic transformations to the target
 // 3. converts the target in actuator position
 // 4. calculates motion change from the previous line
-uint8_t mc_line(float *target, motion_data_t* block_data)
+static uint8_t mc_line_planner(float *target, motion_data_t *block_data)
 {
     uint32_t step_new_pos[STEPPER_COUNT];
     float feed = block_data->feed;
     block_data->dirbits = 0; //reset dirbits (this prevents odd behaviour generated by long arcs)
 
+    //sets the acceleration class of the motion
+    block_data->motion_mode &= ~MOTIONCONTROL_MODE_ACCEL_MASK;
+    if (cnc_get_exec_state(EXEC_HOMING))
+    {
+        block_data->motion_mode |= MOTIONCONTROL_MODE_ACCEL_HOMING;
+    }
+    else if (cnc_get_exec_state(EXEC_JOG))
+    {
+        block_data->motion_mode |= MOTIONCONTROL_MODE_ACCEL_JOG;
+    }
+    else if (feed == FLT_MAX && !CHECKFLAG(block_data->motion_mode, MOTIONCONTROL_MODE_INVERSEFEED))
+    {
+        block_data->motion_mode |= MOTIONCONTROL_MODE_ACCEL_RAPID;
+    }
+
     //update the last target position and direction
     memcpy(mc_last_target, target, sizeof(mc_last_target));
 
@@ -114,20 +691,33 @@ uint8_t mc_line(float *target, motion_data_t* block_data)
     if (!CHECKFLAG(block_data->motion_mode, MOTIONCONTROL_MODE_NOMOTION))
     {
         //applies the inverse kinematic to get next position in steps
-        kinematics_apply_inverse(target, &step_new_pos);
+        kinematics_apply_inverse(target, step_new_pos);
 
         //calculates the aproximation of the inverted travelled distance
         float inv_dist = 0;
+#ifdef ENABLE_EXTRUDER
+        //the feed is the toolhead feed (the extruder only sets the feed in extruder only motions)
+        float path_dist = 0;
+#endif
         //kinematics_apply_forward(block_data->steps, target); // converts the target point to a vector that represents the line segment to be travelled
         for (uint8_t i = AXIS_COUNT; i != 0;)
         {
             i--;
             block_data->dir_vect[i] = target[i] - mc_prev_transformed_target[i];
             inv_dist += fast_flt_pow2(block_data->dir_vect[i]);
+#ifdef ENABLE_EXTRUDER
+            if (i != AXIS_A)
+            {
+                path_dist += fast_flt_pow2(block_data->dir_vect[i]);
+            }
+#endif
             mc_prev_transformed_target[i] = target[i];
         }
 
         inv_dist = fast_flt_invsqrt(inv_dist);
+#ifdef ENABLE_EXTRUDER
+        float inv_path_dist = (path_dist != 0) ? fast_flt_invsqrt(path_dist) : inv_dist;
+#endif
 
 //calculates max junction speed factor in (axis driven). Else the cos_theta is calculated in the planner (linear actuator driven)
 #ifndef ENABLE_LINACT_PLANNER
@@ -139,7 +729,10 @@ uint8_t mc_line(float *target, motion_data_t* block_data)
 #endif
 
         //gets the last position feed to the planner and calculates the step count of the line segment to execute
-        planner_get_position(&block_data->steps);
+        //step counts are reset since the block data can be reused in several segments (arcs and blends)
+        block_data->full_steps = 0;
+        block_data->total_steps = 0;
+        planner_get_position(block_data->steps);
         for (uint8_t i = STEPPER_COUNT; i != 0;)
         {
             i--;
@@ -201,11 +794,16 @@ uint8_t mc_line(float *target, motion_data_t* block_data)
         }
 #endif
         //calculated the total motion execution time @ the given rate
+#ifdef ENABLE_EXTRUDER
+        float inv_delta = (!CHECKFLAG(block_data->motion_mode, MOTIONCONTROL_MODE_INVERSEFEED) ? (block_data->feed * inv_path_dist) : (1.0f / block_data->feed));
+#else
         float inv_delta = (!CHECKFLAG(block_data->motion_mode, MOTIONCONTROL_MODE_INVERSEFEED) ? (block_data->feed * inv_dist) : (1.0f / block_data->feed));
+#endif
         block_data->feed = (float)block_data->total_steps * inv_delta;
     }
 
     planner_add_line(step_new_pos, block_data);
+    mc_tools_pending = false;
     //restores previous feed (this decouples de mm/min to step/min conversion - prevents feed modification in reused data_blocks like in arcs)
     block_data->feed = feed;
     return STATUS_OK;
@@ -216,6 +814,15 @@ uint8_t mc_arc(float *target, float center_offset_a, float center_offset_b, floa
 {
     float mc_position[AXIS_COUNT];
 
+#ifdef ENABLE_G64_PATH_BLENDING
+    //arcs are not blended
+    uint8_t error = mc_blend_flush();
+    if (error)
+    {
+        return error;
+    }
+#endif
+
     //copy motion control last position
     mc_get_position(mc_position);
 
@@ -333,14 +940,14 @@ uint8_t mc_arc(float *target, float center_offset_a, float center_offset_b, floa
             }
         }
 
-        uint8_t error = mc_line(mc_position, block_data);
+        uint8_t error = mc_line_segment(mc_position, block_data);
         if (error)
         {
             return error;
         }
     }
     // Ensure last segment arrives at target location.
-    return mc_line(target, block_data);
+    return mc_line_segment(target, block_data);
 }
 
 uint8_t mc_dwell(motion_data_t* block_data)
@@ -350,6 +957,13 @@ uint8_t mc_dwell(motion_data_t* block_data)
         return STATUS_OK;
     }
 
+#ifdef ENABLE_G64_PATH_BLENDING
+    if (mc_blend_flush())
+    {
+        return STATUS_CRITICAL_FAIL;
+    }
+#endif
+
     while (planner_buffer_is_full())
     {
         if (!cnc_doevents())
@@ -361,23 +975,32 @@ uint8_t mc_dwell(motion_data_t* block_data)
     //send dwell (planner linear motion with distance == 0)
     SETFLAG(block_data->motion_mode, MOTIONCONTROL_MODE_NOMOTION);
     planner_add_line(NULL, block_data);
+    mc_tools_pending = false;
     CLEARFLAG(block_data->motion_mode, MOTIONCONTROL_MODE_NOMOTION);
     return STATUS_OK;
 }
 
 uint8_t mc_home_axis(uint8_t axis, uint8_t axis_limit)
+{
+    return mc_home_axis_group((1 << axis), axis_limit);
+}
+
+//homes several axis in a single motion
+//each axis stops independently when reaching the limit switch (the kinematics locks the linear actuator) and all back off together
+uint8_t mc_home_axis_group(uint8_t axis_mask, uint8_t axis_limit)
 {
     float target[AXIS_COUNT];
-    uint8_t axis_mask = (1 << axis);
     motion_data_t block_data;
     uint8_t limits_flags;
+    uint8_t home_limits = axis_limit;
+    float axis_count = 0;
 
 #ifdef ENABLE_DUAL_DRIVE_AXIS
 #ifdef DUAL_DRIVE_AXIS0
-    axis_limit |= (axis != AXIS_DUAL0) ? 0 : (64 | 128); //if dual limit pins
+    axis_limit |= (!(axis_mask & STEP_DUAL0)) ? 0 : (64 | 128); //if dual limit pins
 #endif
 #ifdef DUAL_DRIVE_AXIS1
-    axis_limit |= (axis != AXIS_DUAL1) ? 0 : (64 | 128); //if dual limit pins
+    axis_limit |= (!(axis_mask & STEP_DUAL1)) ? 0 : (64 | 128); //if dual limit pins
 #endif
 #endif
 
@@ -391,30 +1014,45 @@ uint8_t mc_home_axis(uint8_t axis, uint8_t axis_limit)
 
     io_set_homing_limits_filter(axis_limit);
 
-    float max_home_dist;
-    max_home_dist = -g_settings.max_distance[axis] * 1.5f;
+    //all axis in the group travel the same distance (the longest)
+    float max_home_dist = 0;
+    for (uint8_t i = AXIS_COUNT; i != 0;)
+    {
+        i--;
+        if (axis_mask & (1 << i))
+        {
+            max_home_dist = MAX(max_home_dist, g_settings.max_distance[i]);
+            axis_count++;
+        }
+    }
+
+    max_home_dist *= -1.5f;
+    //the motion feed is scaled so that each axis moves at the homing feed rate
+    float feed_factor = sqrtf(axis_count);
 
-    //checks homing dir
-    if (g_settings.homing_dir_invert_mask & axis_mask)
+    planner_resync_position();
+    mc_resync_position();
+    mc_get_position(target);
+    for (uint8_t i = AXIS_COUNT; i != 0;)
     {
-        max_home_dist = -max_home_dist;
+        i--;
+        if (axis_mask & (1 << i))
+        {
+            //checks homing dir
+            target[i] += (g_settings.homing_dir_invert_mask & (1 << i)) ? -max_home_dist : max_home_dist;
+        }
     }
-    planner_resync_position();
-    mc_resync_position();
-    mc_get_position(target);
-    target[axis] += max_home_dist;
+
     //initializes planner block data
-    block_data.total_steps = ABS(max_home_dist);
     memset(block_data.steps, 0, STEPPER_COUNT * sizeof(uint32_t));
-    block_data.steps[axis] = max_home_dist;
-    block_data.feed = g_settings.homing_fast_feed_rate;
+    block_data.feed = g_settings.homing_fast_feed_rate * feed_factor;
     block_data.spindle = 0;
     block_data.dwell = 0;
     block_data.motion_mode = MOTIONCONTROL_MODE_FEED;
     cnc_unlock();
-    mc_line(target, &block_data);
-    //flags homing clear by the unlock
+    //flags homing clear by the unlock (before sending the motion so that it's not transformed or split)
     cnc_set_exec_state(EXEC_HOMING);
+    mc_line(target, &block_data);
     do
     {
         if (!cnc_doevents())
@@ -435,8 +1073,8 @@ uint8_t mc_home_axis(uint8_t axis, uint8_t axis_limit)
 
     limits_flags = io_get_limits();
 
-    //the wrong switch was activated bails
-    if (!CHECKFLAG(limits_flags, axis_limit))
+    //the wrong switch was activated or any of the axis didn't reach the switch bails
+    if ((limits_flags & home_limits) != home_limits)
     {
         return EXEC_ALARM_HOMING_FAIL_APPROACH;
     }
@@ -448,23 +1086,24 @@ uint8_t mc_home_axis(uint8_t axis, uint8_t axis_limit)
     //planner_resync_position();
     //mc_resync_position();
     mc_get_position(target);
-    if (g_settings.homing_dir_invert_mask & axis_mask)
+    for (uint8_t i = AXIS_COUNT; i != 0;)
     {
-        max_home_dist = -max_home_dist;
+        i--;
+        if (axis_mask & (1 << i))
+        {
+            target[i] += (g_settings.homing_dir_invert_mask & (1 << i)) ? -max_home_dist : max_home_dist;
+        }
     }
 
-    target[axis] += max_home_dist;
-    block_data.feed = g_settings.homing_slow_feed_rate;
-    block_data.total_steps = ABS(max_home_dist);
-    block_data.steps[axis] = max_home_dist;
+    block_data.feed = g_settings.homing_slow_feed_rate * feed_factor;
     //unlocks the machine for next motion (this will clear the EXEC_LIMITS flag
     //temporary inverts the limit mask to trigger ISR on switch release
     g_settings.limits_invert_mask ^= axis_limit;
     //io_set_homing_limits_filter(LIMITS_DUAL_MASK);//if axis pin goes off triggers
     cnc_unlock();
-    mc_line(target, &block_data);
-    //flags homing clear by the unlock
+    //flags homing clear by the unlock (before sending the motion so that it's not transformed or split)
     cnc_set_exec_state(EXEC_HOMING);
+    mc_line(target, &block_data);
     do
     {
         if (!cnc_doevents())
@@ -503,6 +1142,31 @@ uint8_t mc_update_tools(motion_data_t* block_data)
         return STATUS_OK;
     }
 
+#ifdef ENABLE_G64_PATH_BLENDING
+    if (mc_blend_flush())
+    {
+        return STATUS_CRITICAL_FAIL;
+    }
+#endif
+
+#ifdef USE_SPINDLE
+    mc_spindle_update(block_data->spindle);
+#endif
+
+    //a block without motion forces a stop
+    //changes without a dwell are sent with the next block (or with mc_sync_flush if no block follows)
+    if (block_data->dwell == 0)
+    {
+        mc_tools_pending = true;
+#ifdef USE_SPINDLE
+        mc_pending_spindle = block_data->spindle;
+#endif
+#ifdef USE_COOLANT
+        mc_pending_coolant = block_data->coolant;
+#endif
+        return STATUS_OK;
+    }
+
     while (planner_buffer_is_full())
     {
         if (!cnc_doevents())
@@ -513,12 +1177,122 @@ uint8_t mc_update_tools(motion_data_t* block_data)
 
     SETFLAG(block_data->motion_mode, MOTIONCONTROL_MODE_NOMOTION);
     planner_add_line(NULL, block_data);
+    mc_tools_pending = false;
+    return STATUS_OK;
+}
+
+//sends the pending tool changes and synchronized outputs in a block without motion
+//used when no other block follows (the machine is stopping) or to force a tools update (realtime overrides)
+uint8_t mc_sync_flush(bool force)
+{
+    if (mc_checkmode)
+    {
+        return STATUS_OK;
+    }
+
+#ifdef ENABLE_SYNC_OUTPUTS
+    if (!force && !mc_tools_pending && !planner_has_pending_outputs())
+#else
+    if (!force && !mc_tools_pending)
+#endif
+    {
+        return STATUS_OK;
+    }
+
+    motion_data_t block = {0};
+#ifdef USE_SPINDLE
+    block.spindle = (mc_tools_pending) ? mc_pending_spindle : planner_get_previous_spindle_speed();
+#endif
+#ifdef USE_COOLANT
+    block.coolant = (mc_tools_pending) ? mc_pending_coolant : planner_get_previous_coolant();
+#endif
+
+    while (planner_buffer_is_full())
+    {
+        if (!cnc_doevents())
+        {
+            return STATUS_CRITICAL_FAIL;
+        }
+    }
+
+    SETFLAG(block.motion_mode, MOTIONCONTROL_MODE_NOMOTION);
+    planner_add_line(NULL, &block);
+    mc_tools_pending = false;
+    return STATUS_OK;
+}
+
+#ifdef ENABLE_SYNC_OUTPUTS
+//sets a digital output (DOUTn) with the next block or immediately
+uint8_t mc_digital_output(uint8_t output, bool state, bool sync)
+{
+    if (mc_checkmode)
+    {
+        return STATUS_OK;
+    }
+
+    if (!sync)
+    {
+        io_set_output(output, state);
+        return STATUS_OK;
+    }
+
+#ifdef ENABLE_G64_PATH_BLENDING
+    //the output changes after the motion kept by the path blending
+    if (mc_blend_flush())
+    {
+        return STATUS_CRITICAL_FAIL;
+    }
+#endif
+
+    planner_add_digital_output(output, state);
+    return STATUS_OK;
+}
+
+//sets an analog output (PWMn) with the next block or immediately
+uint8_t mc_analog_output(uint8_t output, uint8_t value, bool sync)
+{
+    if (mc_checkmode)
+    {
+        return STATUS_OK;
+    }
+
+    if (!sync)
+    {
+        io_set_pwm(output, value);
+        return STATUS_OK;
+    }
+
+#ifdef ENABLE_G64_PATH_BLENDING
+    //the output changes after the motion kept by the path blending
+    if (mc_blend_flush())
+    {
+        return STATUS_CRITICAL_FAIL;
+    }
+#endif
+
+    //only one analog output changes in each block (sends the pending output in a block without motion)
+    if (!planner_add_analog_output(output, value))
+    {
+        if (mc_sync_flush(false))
+        {
+            return STATUS_CRITICAL_FAIL;
+        }
+        planner_add_analog_output(output, value);
+    }
+
     return STATUS_OK;
 }
+#endif
 
 uint8_t mc_probe(float *target, bool invert_probe, motion_data_t* block_data)
 {
 #ifdef PROBE
+#ifdef ENABLE_G64_PATH_BLENDING
+    if (mc_blend_flush())
+    {
+        return STATUS_CRITICAL_FAIL;
+    }
+#endif
     uint8_t prev_state = cnc_get_exec_state(EXEC_HOLD);
     io_enable_probe();
 
@@ -545,7 +1319,7 @@ uint8_t mc_probe(float *target, bool invert_probe, motion_data_t* block_data)
     itp_clear();
     planner_clear();
     cnc_clear_exec_state(~prev_state & EXEC_HOLD); //restores HOLD previous state
-    bool probe_notok = (!invert_probe) ? io_get_probe() : !io_get_probe();
+    bool probe_notok = (!invert_probe) ? !io_get_probe() : io_get_probe();
     if (probe_notok)
     {
         return EXEC_ALARM_PROBE_FAIL_CONTACT;
@@ -556,15 +1330,300 @@ uint8_t mc_probe(float *target, bool invert_probe, motion_data_t* block_data)
     return STATUS_OK;
 }
 
+//probes toward the target with a fast touch at the block feed followed by a slow touch at the probe slow feed
+//after each contact the probe backs off by the probe retract distance along the probing direction
+uint8_t mc_probe_cycle(float *target, motion_data_t *block_data)
+{
+    float start[AXIS_COUNT];
+    float point[AXIS_COUNT];
+    float feed = block_data->feed;
+    float dist = 0;
+
+    if (mc_checkmode)
+    {
+        return STATUS_OK;
+    }
+
+    mc_get_position(start);
+    for (uint8_t i = AXIS_COUNT; i != 0;)
+    {
+        i--;
+        start[i] = target[i] - start[i];
+        dist += start[i] * start[i];
+    }
+
+    if (dist == 0)
+    {
+        return STATUS_GCODE_INVALID_TARGET;
+    }
+
+    //start holds the retract vector
+    dist = g_settings.probe_retract / sqrtf(dist);
+    for (uint8_t i = AXIS_COUNT; i != 0;)
+    {
+        i--;
+        start[i] *= dist;
+    }
+
+    for (uint8_t touch = 2; touch != 0; touch--)
+    {
+        memcpy(point, target, sizeof(point));
+        uint8_t error = mc_probe(point, false, block_data);
+        if (error)
+        {
+            block_data->feed = feed;
+            return error;
+        }
+
+        mc_get_position(point);
+        for (uint8_t i = AXIS_COUNT; i != 0;)
+        {
+            i--;
+            point[i] -= start[i];
+        }
+
+        block_data->feed = feed;
+        error = mc_line(point, block_data);
+        if (error)
+        {
+            return error;
+        }
+
+        //waits for the retract to finish before the next touch
+        do
+        {
+            if (!cnc_doevents())
+            {
+                return STATUS_CRITICAL_FAIL;
+            }
+        } while (cnc_get_exec_state(EXEC_RUN));
+
+        block_data->feed = g_settings.probe_slow_feed_rate;
+    }
+
+    block_data->feed = feed;
+    return STATUS_OK;
+}
+
+#ifdef ENABLE_MESH_COMPENSATION
+//probes the height map grid from the current position to the target XY corner
+//each point is probed from the current Z height down to the target Z and the heights are relative to the first point
+uint8_t mc_probe_mesh(float *target, motion_data_t *block_data)
+{
+    float start[AXIS_COUNT];
+    float point[AXIS_COUNT];
+    float reference = 0;
+    float feed = block_data->feed;
+
+    //keeps the current height map
+    if (mc_checkmode)
+    {
+        return STATUS_OK;
+    }
+
+#ifdef ENABLE_G64_PATH_BLENDING
+    if (mc_blend_flush())
+    {
+        return STATUS_CRITICAL_FAIL;
+    }
+#endif
+    //the grid is probed with the compensation disabled
+    mc_get_position(start);
+    kinematics_mesh_define(start, target);
+    mc_resync_position();
+    mc_get_position(start);
+
+    for (uint8_t y = 0; y < MESH_GRID_Y; y++)
+    {
+        for (uint8_t i = 0; i < MESH_GRID_X; i++)
+        {
+            //zig zag pattern
+            uint8_t x = (y & 0x01) ? (MESH_GRID_X - 1 - i) : i;
+            memcpy(point, start, sizeof(point));
+            point[AXIS_X] += (target[AXIS_X] - start[AXIS_X]) * ((float)x / (MESH_GRID_X - 1));
+            point[AXIS_Y] += (target[AXIS_Y] - start[AXIS_Y]) * ((float)y / (MESH_GRID_Y - 1));
+            block_data->feed = FLT_MAX;
+            uint8_t error = mc_line(point, block_data);
+            if (error)
+            {
+                return error;
+            }
+
+            //waits for the probe to reach the point before enabling it
+            do
+            {
+                if (!cnc_doevents())
+                {
+                    return STATUS_CRITICAL_FAIL;
+                }
+            } while (cnc_get_exec_state(EXEC_RUN));
+
+            point[AXIS_Z] = target[AXIS_Z];
+            block_data->feed = feed;
+            error = mc_probe(point, false, block_data);
+            if (error)
+            {
+                return error;
+            }
+
+            mc_get_position(point);
+            if (!x && !y)
+            {
+                reference = point[AXIS_Z];
+            }
+
+            kinematics_mesh_set_height(x, y, point[AXIS_Z] - reference);
+            point[AXIS_Z] = start[AXIS_Z];
+            block_data->feed = FLT_MAX;
+            error = mc_line(point, block_data);
+            if (error)
+            {
+                return error;
+            }
+        }
+    }
+
+    kinematics_mesh_enable(true);
+    //the position is updated with the compensation
+    mc_resync_position();
+    block_data->feed = feed;
+    return STATUS_OK;
+}
+
+//clears and disables the height map compensation
+uint8_t mc_clear_mesh(void)
+{
+    float position[AXIS_COUNT];
+
+    if (mc_checkmode)
+    {
+        return STATUS_OK;
+    }
+
+#ifdef ENABLE_G64_PATH_BLENDING
+    if (mc_blend_flush())
+    {
+        return STATUS_CRITICAL_FAIL;
+    }
+#endif
+    mc_get_position(position);
+    kinematics_mesh_define(position, position);
+    kinematics_mesh_enable(false);
+    mc_resync_position();
+    return STATUS_OK;
+}
+#endif
+
+#ifdef ENABLE_AUX_STEPPER
+//queues a motion of the auxiliary stepper to the target position
+//the motion runs independently from the coordinated motions
+uint8_t mc_aux_move(float target)
+{
+    if (mc_checkmode)
+    {
+        return STATUS_OK;
+    }
+
+    //waits for a free slot in the auxiliary stepper queue
+    while (!itp_aux_add_motion(target))
+    {
+        if (!cnc_doevents())
+        {
+            return STATUS_CRITICAL_FAIL;
+        }
+    }
+
+    return STATUS_OK;
+}
+
+//waits for all auxiliary stepper motions to finish
+uint8_t mc_aux_sync(void)
+{
+    if (mc_checkmode)
+    {
+        return STATUS_OK;
+    }
+
+    while (!itp_aux_is_idle())
+    {
+        if (!cnc_doevents())
+        {
+            return STATUS_CRITICAL_FAIL;
+        }
+    }
+
+    return STATUS_OK;
+}
+#endif
+
+#ifdef ENABLE_THC
+//enables the realtime torch height correction
+uint8_t mc_thc_enable(void)
+{
+    if (mc_checkmode)
+    {
+        return STATUS_OK;
+    }
+
+    itp_thc_enable(true);
+    return STATUS_OK;
+}
+
+//waits for the motions to finish and disables the realtime torch height correction
+//the corrected position becomes the current position
+uint8_t mc_thc_disable(void)
+{
+    if (mc_checkmode)
+    {
+        return STATUS_OK;
+    }
+
+    do
+    {
+        if (!cnc_doevents())
+        {
+            return STATUS_CRITICAL_FAIL;
+        }
+    } while (cnc_get_exec_state(EXEC_RUN));
+
+    itp_thc_enable(false);
+    planner_resync_position();
+    mc_resync_position();
+    return STATUS_OK;
+}
+#endif
+
 void mc_get_position(float *target)
 {
+#ifdef ENABLE_G64_PATH_BLENDING
+    //the programmed position is the end of the motion kept by the path blending
+    //mc_last_target is the end of the last motion sent (the start of the next segmented motion)
+    if (mc_blend_pending)
+    {
+        memcpy(target, mc_blend_corner, sizeof(mc_blend_corner));
+        return;
+    }
+#endif
     memcpy(target, mc_last_target, sizeof(mc_last_target));
 }
 
 void mc_resync_position(void)
 {
+#ifdef ENABLE_G64_PATH_BLENDING
+    //discards any motion kept by the path blending
+    mc_blend_pending = false;
+#endif
     uint32_t pos[STEPPER_COUNT];
     planner_get_position(pos);
     kinematics_apply_forward(pos, mc_last_target);
     kinematics_apply_reverse_transform(mc_last_target);
+#ifdef USE_SPINDLE
+    //the spindle model restarts from the planner spindle (stopped if the planner was cleared)
+    int16_t spindle = (int16_t)planner_get_previous_spindle_speed();
+    if (mc_spindle_rpm != spindle)
+    {
+        mc_spindle_rpm = spindle;
+        mc_spindle_settle = 0;
+    }
+#endif
 }
@@ -26,6 +26,14 @@
 #define MOTIONCONTROL_MODE_NOMOTION 1
 #define MOTIONCONTROL_MODE_INVERSEFEED 2
 #define MOTIONCONTROL_MODE_BACKLASH_COMPENSATION 4
+//motion acceleration class (2 bits)
+#define MOTIONCONTROL_MODE_ACCEL_FEED 0
+#define MOTIONCONTROL_MODE_ACCEL_RAPID 8
+#define MOTIONCONTROL_MODE_ACCEL_JOG 16
+#define MOTIONCONTROL_MODE_ACCEL_HOMING 24
+#define MOTIONCONTROL_MODE_ACCEL_MASK 24
+#define MOTIONCONTROL_MODE_ACCEL_SHIFT 3
+#define MOTIONCONTROL_ACCEL_CLASSES 4
 
 typedef struct
 {
@@ -45,17 +53,43 @@ typedef struct
     #ifdef USE_COOLANT
     uint8_t coolant;
     #endif
+    #ifdef SPINDLE_AT_SPEED
+    bool spindle_wait; //the dwell ends when the spindle reaches the speed
+    #endif
 } motion_data_t;
 
 void mc_init(void);
 bool mc_get_checkmode(void);
 bool mc_toogle_checkmode(void);
 uint8_t mc_line(float *target, motion_data_t* block_data);
+#ifdef ENABLE_G64_PATH_BLENDING
+void mc_set_blend_tolerance(float tolerance);
+uint8_t mc_blend_flush(void);
+#endif
 uint8_t mc_arc(float *target, float center_offset_a, float center_offset_b, float radius, uint8_t axis_0, uint8_t axis_1, bool isclockwise, motion_data_t* block_data);
 uint8_t mc_dwell(motion_data_t* block_data);
 uint8_t mc_home_axis(uint8_t axis, uint8_t axis_limit);
+uint8_t mc_home_axis_group(uint8_t axis_mask, uint8_t axis_limit);
 uint8_t mc_update_tools(motion_data_t* block_data);
+uint8_t mc_sync_flush(bool force);
+#ifdef ENABLE_SYNC_OUTPUTS
+uint8_t mc_digital_output(uint8_t output, bool state, bool sync);
+uint8_t mc_analog_output(uint8_t output, uint8_t value, bool sync);
+#endif
 uint8_t mc_probe(float *target, bool invert_probe, motion_data_t* block_data);
+uint8_t mc_probe_cycle(float *target, motion_data_t* block_data);
+#ifdef ENABLE_MESH_COMPENSATION
+uint8_t mc_probe_mesh(float *target, motion_data_t* block_data);
+uint8_t mc_clear_mesh(void);
+#endif
+#ifdef ENABLE_AUX_STEPPER
+uint8_t mc_aux_move(float target);
+uint8_t mc_aux_sync(void);
+#endif
+#ifdef ENABLE_THC
+uint8_t mc_thc_enable(void);
+uint8_t mc_thc_disable(void);
+#endif
 void mc_get_position(float *target);
 void mc_resync_position(void);
 
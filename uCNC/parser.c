@@ -32,6 +32,7 @@
 #include "motion_control.h"
 #include "io_control.h"
 #include "interpolator.h"
+#include "kinematics.h"
 #include "cnc.h"
 #include "parser.h"
 
@@ -58,6 +59,14 @@
 #define GCODE_GROUP_ENABLEOVER 0x4000
 #define GCODE_GROUP_NONMODAL 0x8000
 
+//extended M codes masks (codes with no modal group)
+#define GCODE_MCODE_M204 0x01
+#define GCODE_MCODE_M100 0x02
+#define GCODE_MCODE_M101 0x04
+#define GCODE_MCODE_M102 0x08
+#define GCODE_MCODE_M103 0x10
+#define GCODE_MCODE_M52 0x20
+
 //word masks
 #define GCODE_WORD_X 0x0001
 #define GCODE_WORD_Y 0x0002
@@ -127,11 +136,13 @@
 #define G59_3 8
 #define G61 0
 #define G61_1 1
-#define G64 2
+#define G64 3
 #define G4 1
 #define G10 2
 #define G28 3
 #define G30 4
+#define G37 7
+#define G29 5
 #define G53 6
 #define G92 10
 #define G92_1 11
@@ -235,6 +246,10 @@ typedef struct
     uint16_t groups;
     uint16_t words;
     bool group_0_1_useaxis;
+    uint8_t mcodes;
+#ifdef ENABLE_SYNC_OUTPUTS
+    uint8_t output; //output M code (M62 to M68)
+#endif
 } parser_cmd_explicit_t;
 
 typedef struct
@@ -254,8 +269,27 @@ static parser_state_t parser_state;
 static parser_parameters_t parser_parameters;
 static uint8_t parser_wco_counter;
 static float g92permanentoffset[AXIS_COUNT];
-
-static unsigned char parser_get_next_preprocessed(bool peek);
+static uint32_t parser_probe_steps[STEPPER_COUNT];
+//cursor of the line being parsed (the line is a contiguous slice terminated by EOL)
+static unsigned char *parser_line;
+#ifdef ENABLE_BINARY_PROTOCOL
+//last value of the X, Y, Z, A, B and C words received in binary frames (fixed point)
+static int32_t parser_frame_axis[6];
+#endif
+#ifdef ENABLE_LINE_CHECKSUM
+//line number of the last checksummed line
+static int32_t parser_last_line;
+#endif
+#ifdef ENABLE_PARSER_FAST_PATH
+//modal state cached for the modal motion fast path
+static bool parser_fast_ready;
+static float parser_fast_units;
+static float parser_fast_offset[AXIS_COUNT];
+static motion_data_t parser_fast_block;
+#endif
+
+FORCEINLINE static unsigned char parser_getc(void);
+FORCEINLINE static unsigned char parser_get_next_preprocessed(bool peek);
 FORCEINLINE static uint8_t parser_get_comment(void);
 static uint8_t parser_get_float(float *value);
 FORCEINLINE static uint8_t parser_eat_next_char(unsigned char c);
@@ -265,9 +299,22 @@ FORCEINLINE static uint8_t parser_mcode_word(uint8_t code, uint8_t mantissa, par
 FORCEINLINE static uint8_t parser_letter_word(unsigned char c, float value, uint8_t mantissa, parser_words_t *words, parser_cmd_explicit_t *cmd);
 static uint8_t parse_grbl_exec_code(uint8_t code);
 static uint8_t parser_fetch_command(parser_state_t *new_state, parser_words_t *words, parser_cmd_explicit_t *cmd);
+FORCEINLINE static uint8_t parser_fetch_word(unsigned char word, float value, uint8_t wordcount, parser_state_t *new_state, parser_words_t *words, parser_cmd_explicit_t *cmd);
+#ifdef ENABLE_BINARY_PROTOCOL
+static uint8_t parser_fetch_frame(parser_state_t *new_state, parser_words_t *words, parser_cmd_explicit_t *cmd);
+#endif
 static uint8_t parser_validate_command(parser_state_t *new_state, parser_words_t *words, parser_cmd_explicit_t *cmd);
 FORCEINLINE static uint8_t parser_exec_command(parser_state_t *new_state, parser_words_t *words, parser_cmd_explicit_t *cmd);
+FORCEINLINE static void parser_keep_axis_position(float *axis, float *last_pos, uint16_t words);
+#ifdef ENABLE_PARSER_FAST_PATH
+static void parser_fast_path_update(void);
+FORCEINLINE static bool parser_fast_path_check(parser_state_t *new_state, parser_words_t *words, parser_cmd_explicit_t *cmd);
+FORCEINLINE static uint8_t parser_fast_path_exec(parser_state_t *new_state, parser_words_t *words, parser_cmd_explicit_t *cmd);
+#endif
 static uint8_t parser_grbl_command(void);
+#ifdef ENABLE_LINE_CHECKSUM
+static uint8_t parser_check_line(void);
+#endif
 FORCEINLINE static uint8_t parser_gcode_command(void);
 FORCEINLINE static void parser_discard_command(void);
 static void parser_reset();
@@ -288,7 +335,47 @@ void parser_init(void)
 uint8_t parser_read_command(void)
 {
     uint8_t error = STATUS_OK;
-    unsigned char c = serial_peek();
+#ifdef ENABLE_LINE_CHECKSUM
+    //the startup blocks are not checked (they were stored from a checked line)
+    bool check = (serial_get_select() == SERIAL_UART);
+#endif
+    parser_line = serial_get_line();
+    unsigned char c = *parser_line;
+
+    if (c == EOL) //empty lines and windows newline (CR+LF)
+    {
+        return STATUS_OK;
+    }
+
+#ifdef ENABLE_LINE_CHECKSUM
+#ifdef ENABLE_BINARY_PROTOCOL
+    //the binary frames are not checked (the payload is binary and the frame has its own checksum)
+    check = check && (c != STX);
+#endif
+    //the tabs are kept by the RX ISR (the checksum is computed with the chars sent) and are replaced here
+    if (check)
+    {
+        error = parser_check_line();
+        if (error)
+        {
+            if (error == GRBL_SET_LINE_NUMBER)
+            {
+                return STATUS_OK;
+            }
+            //requests the next expected line
+            protocol_send_resend((uint32_t)(parser_last_line + 1));
+            return error;
+        }
+    }
+#endif
+
+#ifdef ENABLE_STREAM_COMPRESSION
+    //the compressed stream was started by the RX ISR (answered even while running)
+    if (c == '$' && parser_line[1] == 'Z' && parser_line[2] == EOL)
+    {
+        return STATUS_OK;
+    }
+#endif
 
     if (c == '$')
     {
@@ -323,6 +410,112 @@ uint8_t parser_read_command(void)
     return parser_gcode_command();
 }
 
+#ifdef ENABLE_LINE_CHECKSUM
+//reads a line number (or checksum) and moves the cursor to the char after it
+static bool parser_get_line_number(unsigned char **ptr, int32_t *value)
+{
+    unsigned char *p = *ptr;
+    bool negative = (*p == '-');
+    int32_t n = 0;
+    if (negative)
+    {
+        p++;
+    }
+
+    if (*p < '0' || *p > '9')
+    {
+        return false;
+    }
+
+    do
+    {
+        n = n * 10 + (*p++ - '0');
+    } while (*p >= '0' && *p <= '9');
+
+    *value = (negative) ? -n : n;
+    *ptr = p;
+    return true;
+}
+
+/*
+	Validates the line number and checksum of a line sent as N<line> ... *<checksum> before it's tokenized
+	The checksum (xor of all chars before the '*') is computed in a single pass and is removed from the line
+	The tabs are replaced with white spaces in the same pass (after they are added to the checksum)
+	M110 (N<line> M110 [N<line>]) sets the last line number and is not parsed
+*/
+static uint8_t parser_check_line(void)
+{
+    unsigned char *ptr = parser_line;
+    unsigned char c = *ptr;
+    //lines without line number are not checked
+    unsigned char end = (c == 'N' || c == 'n') ? '*' : EOL;
+    uint8_t checksum = 0;
+    int32_t value;
+    int32_t line;
+
+    while (c != end && c != EOL)
+    {
+        checksum ^= c;
+        if (c == '\t')
+        {
+            *ptr = ' ';
+        }
+        c = *++ptr;
+    }
+
+    if (c == EOL)
+    {
+        //lines without checksum are not checked
+        return STATUS_OK;
+    }
+
+    *ptr++ = EOL;
+    if (!parser_get_line_number(&ptr, &value) || value != checksum)
+    {
+        return STATUS_LINE_CHECKSUM_FAIL;
+    }
+
+    ptr = parser_line + 1;
+    if (!parser_get_line_number(&ptr, &line))
+    {
+        return STATUS_GCODE_INVALID_LINE_NUMBER;
+    }
+
+    while (*ptr == ' ')
+    {
+        ptr++;
+    }
+
+    if ((ptr[0] == 'M' || ptr[0] == 'm') && ptr[1] == '1' && ptr[2] == '1' && ptr[3] == '0' && (ptr[4] < '0' || ptr[4] > '9'))
+    {
+        ptr += 4;
+        while (*ptr == ' ')
+        {
+            ptr++;
+        }
+        //M110 without line number uses the line number of the line
+        parser_last_line = line;
+        if (*ptr == 'N' || *ptr == 'n')
+        {
+            ptr++;
+            if (!parser_get_line_number(&ptr, &parser_last_line))
+            {
+                return STATUS_GCODE_INVALID_LINE_NUMBER;
+            }
+        }
+        return GRBL_SET_LINE_NUMBER;
+    }
+
+    if (line != (parser_last_line + 1))
+    {
+        return STATUS_LINE_NUMBER_MISMATCH;
+    }
+
+    parser_last_line = line;
+    return STATUS_OK;
+}
+#endif
+
 void parser_get_modes(uint8_t *modalgroups, uint16_t *feed, uint16_t *spindle, uint8_t *coolant)
 {
     modalgroups[0] = (parser_state.groups.motion < 8) ? parser_state.groups.motion : (72 + parser_state.groups.motion);
@@ -387,6 +580,9 @@ uint8_t parser_get_probe_result(void)
 
 void parser_parameters_reset(void)
 {
+#ifdef ENABLE_PARSER_FAST_PATH
+    parser_fast_ready = false;
+#endif
     //erase all parameters for G54..G59.x coordinate systems
     memset(parser_parameters.coord_system_offset, 0, AXIS_COUNT * sizeof(float));
     for (uint8_t i = 0; i < COORD_SYS_COUNT; i++)
@@ -421,7 +617,14 @@ bool parser_get_wco(float *axis)
 
 void parser_sync_probe(void)
 {
-    itp_get_rt_position(parser_parameters.last_probe_position);
+    itp_get_rt_position(parser_probe_steps);
+}
+
+//converts the position stored on the probe trigger to machine coordinates
+static void parser_update_probe_pos(void)
+{
+    kinematics_apply_forward(parser_probe_steps, parser_parameters.last_probe_position);
+    kinematics_apply_reverse_transform(parser_parameters.last_probe_position);
 }
 
 static uint8_t parser_grbl_command(void)
@@ -433,9 +636,10 @@ static uint8_t parser_grbl_command(void)
         return STATUS_IDLE_ERROR;
     }
 
-    serial_getc(); //eat $
-    unsigned char c = serial_getc();
+    parser_line++; //eat $
+    unsigned char c = parser_getc();
     uint16_t block_address;
+    unsigned char *startup_block;
     uint8_t error = STATUS_OK;
     switch (c)
     {
@@ -452,6 +656,34 @@ static uint8_t parser_grbl_command(void)
         return (!parser_eat_next_char(EOL)) ? GRBL_SEND_PARSER_MODES : STATUS_INVALID_STATEMENT;
     case 'C':
         return (!parser_eat_next_char(EOL)) ? GRBL_TOGGLE_CHECKMODE : STATUS_INVALID_STATEMENT;
+#ifdef ENABLE_BINARY_PROTOCOL
+    case 'B':
+        return (!parser_eat_next_char(EOL)) ? GRBL_BINARY_MODE : STATUS_INVALID_STATEMENT;
+#endif
+#ifdef ENABLE_BAUD_SWITCH
+    case 'U':
+    {
+        float baud = 0;
+        if (parser_eat_next_char('='))
+        {
+            return STATUS_INVALID_STATEMENT;
+        }
+        if (cnc_get_exec_state(EXEC_ALLACTIVE)) //baud rate switch only allowed in IDLE
+        {
+            return STATUS_IDLE_ERROR;
+        }
+        error = parser_get_float(&baud);
+        if (!error)
+        {
+            return STATUS_BAD_NUMBER_FORMAT;
+        }
+        if ((error & (NUMBER_ISFLOAT | NUMBER_ISNEGATIVE)) || parser_eat_next_char(EOL))
+        {
+            return STATUS_INVALID_STATEMENT;
+        }
+        return (serial_set_baudrate((uint32_t)baud)) ? STATUS_OK : STATUS_INVALID_STATEMENT;
+    }
+#endif
     case 'J':
         if (parser_eat_next_char('='))
         {
@@ -464,7 +696,7 @@ static uint8_t parser_grbl_command(void)
         cnc_set_exec_state(EXEC_JOG);
         return GRBL_JOG_CMD;
     case 'N':
-        c = serial_getc();
+        c = parser_getc();
         switch (c)
         {
         case '0':
@@ -474,6 +706,7 @@ static uint8_t parser_grbl_command(void)
             {
                 return STATUS_INVALID_STATEMENT;
             }
+            startup_block = parser_line;
             break;
         case EOL:
             return GRBL_SEND_STARTUP_BLOCKS;
@@ -506,7 +739,7 @@ static uint8_t parser_grbl_command(void)
     switch (c)
     {
     case 'R':
-        c = serial_getc();
+        c = parser_getc();
         switch (c)
         {
         case '$':
@@ -534,20 +767,20 @@ static uint8_t parser_grbl_command(void)
         {
             return error;
         }
-        //everything ok reverts string and saves it
-        do
+        //the block must fit the startup block storage (chars, line terminator and crc)
+        if (strlen((char *)startup_block) > (STARTUP_BLOCK_SIZE - 2))
         {
-            serial_ungetc();
-        } while (serial_peek() != '=');
-        serial_getc();
-        settings_save_startup_gcode(block_address);
+            return STATUS_LINE_LENGTH_EXCEEDED;
+        }
+        //everything ok saves the block (from the char after the '=')
+        settings_save_startup_gcode(block_address, startup_block);
         break;
     default:
         if (c >= '0' && c <= '9') //settings
         {
             float val = 0;
             uint8_t setting_num = 0;
-            serial_ungetc();
+            parser_line--;
             error = parser_get_float(&val);
             if (!error)
             {
@@ -642,6 +875,13 @@ static uint8_t parse_grbl_exec_code(uint8_t code)
     case GRBL_HELP:
         protocol_send_string(MSG_HELP);
         return STATUS_OK;
+#ifdef ENABLE_BINARY_PROTOCOL
+    case GRBL_BINARY_MODE:
+        //the delta encoded values restart from 0
+        memset(parser_frame_axis, 0, sizeof(parser_frame_axis));
+        serial_enable_binary();
+        return STATUS_OK;
+#endif
     default:
         return code;
     }
@@ -663,6 +903,12 @@ static uint8_t parser_fetch_command(parser_state_t *new_state, parser_words_t *w
 {
     uint8_t error = STATUS_OK;
     uint8_t wordcount = 0;
+#ifdef ENABLE_BINARY_PROTOCOL
+    if (*parser_line == STX)
+    {
+        return parser_fetch_frame(new_state, words, cmd);
+    }
+#endif
     for (;;)
     {
         unsigned char word = 0;
@@ -684,47 +930,203 @@ static uint8_t parser_fetch_command(parser_state_t *new_state, parser_words_t *w
 #endif
             return error;
         }
-        uint8_t code = (uint8_t)floorf(value);
-        //check mantissa
-        uint8_t mantissa = (uint8_t)roundf((value - code) * 100.0f);
 
-        switch (word)
+        if (word == EOL)
         {
-        case EOL:
 #ifdef ECHO_CMD
             protocol_send_string(MSG_END);
 #endif
             return STATUS_OK;
-        case 'G':
-            error = parser_gcode_word(code, mantissa, new_state, cmd);
+        }
+
+        error = parser_fetch_word(word, value, wordcount, new_state, words, cmd);
+        if (error)
+        {
+            parser_discard_command();
+#ifdef ECHO_CMD
+            protocol_send_string(MSG_END);
+#endif
+            return error;
+        }
+
+        wordcount++;
+    }
+    //Never should reach
+    return STATUS_CRITICAL_FAIL;
+}
+
+static uint8_t parser_fetch_word(unsigned char word, float value, uint8_t wordcount, parser_state_t *new_state, parser_words_t *words, parser_cmd_explicit_t *cmd)
+{
+    uint8_t code = (uint8_t)floorf(value);
+    //check mantissa
+    uint8_t mantissa = (uint8_t)roundf((value - code) * 100.0f);
+
+    switch (word)
+    {
+    case 'G':
+        return parser_gcode_word(code, mantissa, new_state, cmd);
+    case 'M':
+        return parser_mcode_word(code, mantissa, new_state, cmd);
+    default:
+        if (word == 'N' && wordcount != 0)
+        {
+            return STATUS_GCODE_INVALID_LINE_NUMBER;
+        }
+        return parser_letter_word(word, value, mantissa, words, cmd);
+    }
+}
+
+#ifdef ENABLE_BINARY_PROTOCOL
+/*
+	STEP 1 (binary frame)
+	Fetches the next binary frame from the mcu communication buffer
+	Each word is a tag followed by the value
+		The tag lower 5 bits are the word letter ('A' = 1 to 'Z' = 26) and the upper 3 bits are the value format
+			0 - int8
+			1 - int16
+			2 - int24
+			3 - float
+			4 - int8 delta
+			5 - int16 delta
+			6 - int24 delta
+			7 - code and mantissa (2 bytes - G38.2 is sent as 38 and 20)
+		Multi byte values are little endian
+		The integer values of the X, Y, Z, A, B, C, I, J, K and R words are in thousandths of the unit (the other words are not scaled)
+		The delta values are added to the last value of the same axis word (X, Y, Z, A, B or C) sent in a frame
+*/
+static uint8_t parser_fetch_frame(parser_state_t *new_state, parser_words_t *words, parser_cmd_explicit_t *cmd)
+{
+    //the frame slice has the frame start char, the payload length and the payload
+    unsigned char *frame = &parser_line[2];
+    uint8_t length = parser_line[1];
+    uint8_t error;
+    uint8_t wordcount = 0;
+    uint8_t i = 0;
+
+    if (length > SERIAL_FRAME_SIZE)
+    {
+        return STATUS_INVALID_STATEMENT;
+    }
+
+    while (i < length)
+    {
+        uint8_t tag = frame[i++];
+        unsigned char word = '@' + (tag & 0x1F);
+        uint8_t format = tag >> 5;
+        uint8_t size;
+        int8_t axis = -1;
+        int32_t intval = 0;
+        float value;
+
+        switch (format)
+        {
+        case 3:
+            size = 4;
+            break;
+        case 7:
+            size = 2;
+            break;
+        default:
+            //int8, int16 or int24 (with or without delta)
+            size = (format & 0x03) + 1;
+            break;
+        }
+
+        if (word > 'Z' || (i + size) > length)
+        {
+            return STATUS_INVALID_STATEMENT;
+        }
+
+        switch (word)
+        {
+        case 'X':
+        case 'Y':
+        case 'Z':
+            axis = word - 'X';
             break;
-        case 'M':
-            error = parser_mcode_word(code, mantissa, new_state, cmd);
+        case 'A':
+        case 'B':
+        case 'C':
+            axis = word - 'A' + 3;
+            break;
+#ifdef GCODE_ACCEPT_WORD_E
+        case 'E':
+            axis = 3;
+            break;
+#endif
+        }
+
+        switch (format)
+        {
+        case 3:
+            memcpy(&value, &frame[i], sizeof(float));
+            if (axis >= 0)
+            {
+                parser_frame_axis[axis] = (int32_t)lroundf(value * 1000.0f);
+            }
+            break;
+        case 7:
+            if (word != 'G' && word != 'M')
+            {
+                return STATUS_INVALID_STATEMENT;
+            }
+            value = frame[i] + frame[i + 1] * 0.01f;
             break;
         default:
-            if (word == 'N' && wordcount != 0)
+            //sign extends the little endian integer
+            intval = (int8_t)frame[i + size - 1];
+            for (int8_t j = size - 2; j >= 0; j--)
+            {
+                intval = (intval << 8) | frame[i + j];
+            }
+
+            if (format > 3)
+            {
+                if (axis < 0)
+                {
+                    return STATUS_INVALID_STATEMENT;
+                }
+                intval += parser_frame_axis[axis];
+            }
+
+            if (axis >= 0)
             {
-                error = STATUS_GCODE_INVALID_LINE_NUMBER;
+                parser_frame_axis[axis] = intval;
+            }
+
+            value = (float)intval;
+            switch (word)
+            {
+            case 'X':
+            case 'Y':
+            case 'Z':
+            case 'A':
+            case 'B':
+            case 'C':
+            case 'E':
+            case 'I':
+            case 'J':
+            case 'K':
+            case 'R':
+                value *= 0.001f;
                 break;
             }
-            error = parser_letter_word(word, value, mantissa, words, cmd);
             break;
         }
 
+        i += size;
+        error = parser_fetch_word(word, value, wordcount, new_state, words, cmd);
         if (error)
         {
-            parser_discard_command();
-#ifdef ECHO_CMD
-            protocol_send_string(MSG_END);
-#endif
             return error;
         }
 
         wordcount++;
     }
-    //Never should reach
-    return STATUS_CRITICAL_FAIL;
+
+    return STATUS_OK;
 }
+#endif
 
 /*
 	STEP 2
@@ -750,7 +1152,7 @@ static uint8_t parser_validate_command(parser_state_t *new_state, parser_words_t
             return STATUS_INVALID_JOG_COMMAND;
         }
 
-        if (cmd->words & GCODE_JOG_INVALID_WORDS)
+        if ((cmd->words & GCODE_JOG_INVALID_WORDS) || cmd->mcodes)
         {
             return STATUS_INVALID_JOG_COMMAND;
         }
@@ -791,6 +1193,40 @@ static uint8_t parser_validate_command(parser_state_t *new_state, parser_words_t
                 return STATUS_GCODE_NO_AXIS_WORDS;
             }
             break;
+        case G37:
+            //G37 probes in the direction of the target
+            if (!CHECKFLAG(cmd->words, GCODE_ALL_AXIS))
+            {
+                return STATUS_GCODE_NO_AXIS_WORDS;
+            }
+            //P selects the coordinate system that is set with the probe result
+            if (CHECKFLAG(cmd->words, GCODE_WORD_P) && (words->p < 1 || words->p > COORD_SYS_COUNT))
+            {
+                return STATUS_GCODE_UNSUPPORTED_COORD_SYS;
+            }
+#ifndef AXIS_TOOL
+            //without the tool length offset the result can only set a coordinate system
+            if (!CHECKFLAG(cmd->words, GCODE_WORD_P))
+            {
+                return STATUS_GCODE_VALUE_WORD_MISSING;
+            }
+#else
+            //without P the probe result sets the tool length offset and only the tool axis word is allowed
+            if (!CHECKFLAG(cmd->words, GCODE_WORD_P) && CHECKFLAG(cmd->words, GCODE_ALL_AXIS & ~(GCODE_WORD_X << AXIS_TOOL)))
+            {
+                return STATUS_GCODE_G43_DYNAMIC_AXIS_ERROR;
+            }
+#endif
+            break;
+#ifdef ENABLE_MESH_COMPENSATION
+        case G29:
+            //G29 probing needs the grid XY corner and the probe Z target
+            if (CHECKFLAG(cmd->words, GCODE_ALL_AXIS) && ((cmd->words & (GCODE_WORD_X | GCODE_WORD_Y | GCODE_WORD_Z)) != (GCODE_WORD_X | GCODE_WORD_Y | GCODE_WORD_Z)))
+            {
+                return STATUS_GCODE_VALUE_WORD_MISSING;
+            }
+            break;
+#endif
         case G53:
             //G53
             //if no G0 or G1 not active
@@ -895,50 +1331,319 @@ static uint8_t parser_validate_command(parser_state_t *new_state, parser_words_t
             }
         }
     }
-    //group 2 - plane selection (nothing to be checked)
-    //group 3 - distance mode (nothing to be checked)
-
-    //group 6 - units (nothing to be checked)
-    //group 7 - cutter radius compensation (not implemented yet)
-    //group 8 - tool length offset
-    if ((new_state->groups.tool_length_offset == G43_1) && CHECKFLAG(cmd->groups, GCODE_GROUP_TOOLLENGTH))
+    //group 2 - plane selection (nothing to be checked)
+    //group 3 - distance mode (nothing to be checked)
+
+    //group 6 - units (nothing to be checked)
+    //group 7 - cutter radius compensation (not implemented yet)
+    //group 8 - tool length offset
+    if ((new_state->groups.tool_length_offset == G43_1) && CHECKFLAG(cmd->groups, GCODE_GROUP_TOOLLENGTH))
+    {
+        if (!CHECKFLAG(cmd->words, GCODE_WORD_Z))
+        {
+            return STATUS_GCODE_AXIS_WORDS_EXIST;
+        }
+    }
+//group 10 - return mode in canned cycles (not implemented yet)
+//group 12 - coordinate system selection (nothing to be checked)
+//group 13 - path control mode (nothing to be checked)
+
+//RS274NGC v3 - 3.6 Input M Codes
+//group 4 - stopping (nothing to be checked)
+//group 6 - tool change(not implemented yet)
+//group 7 - spindle turning (nothing to be checked)
+//group 8 - coolant (nothing to be checked)
+//group 9 - enable/disable feed and speed override switches (not implemented)
+
+    //G64 P tolerance (P word can't be shared with G4, G10, G37 or M204)
+    if (CHECKFLAG(cmd->groups, GCODE_GROUP_PATH) && (new_state->groups.path_mode == G64) && CHECKFLAG(cmd->words, GCODE_WORD_P))
+    {
+        if (new_state->groups.nonmodal == G4 || new_state->groups.nonmodal == G10 || new_state->groups.nonmodal == G37 || CHECKFLAG(cmd->mcodes, GCODE_MCODE_M204 | GCODE_MCODE_M100))
+        {
+            return STATUS_GCODE_MODAL_GROUP_VIOLATION;
+        }
+    }
+
+    //M204 - feed acceleration factor (P word can't be shared with G4, G10 or G37)
+    if (CHECKFLAG(cmd->mcodes, GCODE_MCODE_M204))
+    {
+        if (new_state->groups.nonmodal == G4 || new_state->groups.nonmodal == G10 || new_state->groups.nonmodal == G37)
+        {
+            return STATUS_GCODE_MODAL_GROUP_VIOLATION;
+        }
+        if (CHECKFLAG(cmd->words, GCODE_WORD_P) && words->p == 0)
+        {
+            return STATUS_INVALID_STATEMENT;
+        }
+    }
+
+    //M100 - auxiliary stepper motion (P word is the target position and can't be shared with G4, G10, G37 or M204)
+    if (CHECKFLAG(cmd->mcodes, GCODE_MCODE_M100))
+    {
+        if (new_state->groups.nonmodal == G4 || new_state->groups.nonmodal == G10 || new_state->groups.nonmodal == G37 || CHECKFLAG(cmd->mcodes, GCODE_MCODE_M204))
+        {
+            return STATUS_GCODE_MODAL_GROUP_VIOLATION;
+        }
+        if (!CHECKFLAG(cmd->words, GCODE_WORD_P))
+        {
+            return STATUS_GCODE_VALUE_WORD_MISSING;
+        }
+    }
+
+    //M52 - adaptive feed (P word is optional and can't be shared with G4, G10, G37, G64, M100 or M204)
+    if (CHECKFLAG(cmd->mcodes, GCODE_MCODE_M52) && CHECKFLAG(cmd->words, GCODE_WORD_P))
+    {
+        if (new_state->groups.nonmodal == G4 || new_state->groups.nonmodal == G10 || new_state->groups.nonmodal == G37 || CHECKFLAG(cmd->mcodes, GCODE_MCODE_M204 | GCODE_MCODE_M100))
+        {
+            return STATUS_GCODE_MODAL_GROUP_VIOLATION;
+        }
+        if (CHECKFLAG(cmd->groups, GCODE_GROUP_PATH) && (new_state->groups.path_mode == G64))
+        {
+            return STATUS_GCODE_MODAL_GROUP_VIOLATION;
+        }
+        if (words->p != 0 && words->p != 1)
+        {
+            return STATUS_INVALID_STATEMENT;
+        }
+    }
+
+#ifdef ENABLE_SYNC_OUTPUTS
+    //M62 to M65 P<output> and M67/M68 P<output> L<value> (P and L words can't be shared with G4, G10, G37, G64, M52, M100 or M204)
+    if (cmd->output)
+    {
+        if (new_state->groups.nonmodal == G4 || new_state->groups.nonmodal == G10 || new_state->groups.nonmodal == G37 || CHECKFLAG(cmd->mcodes, GCODE_MCODE_M204 | GCODE_MCODE_M100 | GCODE_MCODE_M52))
+        {
+            return STATUS_GCODE_MODAL_GROUP_VIOLATION;
+        }
+        if (CHECKFLAG(cmd->groups, GCODE_GROUP_PATH) && (new_state->groups.path_mode == G64))
+        {
+            return STATUS_GCODE_MODAL_GROUP_VIOLATION;
+        }
+        if (!CHECKFLAG(cmd->words, GCODE_WORD_P) || ((cmd->output >= 67) && !CHECKFLAG(cmd->words, GCODE_WORD_L)))
+        {
+            return STATUS_GCODE_VALUE_WORD_MISSING;
+        }
+        if (words->p > 15)
+        {
+            return STATUS_GCODE_MAX_VALUE_EXCEEDED;
+        }
+    }
+#endif
+
+//RS274NGC v3 - 3.7 Other Input Codes
+//Words P (except the M100 position), S and T must be positive
+    if (CHECKFLAG(cmd->words, GCODE_WORD_P) && words->p < 0 && !CHECKFLAG(cmd->mcodes, GCODE_MCODE_M100))
+    {
+        return STATUS_NEGATIVE_VALUE;
+    }
+#ifdef USE_SPINDLE
+    if (words->s < 0)
+    {
+        return STATUS_NEGATIVE_VALUE;
+    }
+#endif
+#ifdef USE_TOOL_CHANGER
+    if (words->t < 0)
+    {
+        return STATUS_NEGATIVE_VALUE;
+    }
+    if (words->t > g_settings.tool_count)
+    {
+        return STATUS_INVALID_TOOL;
+    }
+#endif
+    return STATUS_OK;
+}
+
+/*
+	Retains the position of all axis that are not explicitly declared in the command
+*/
+static void parser_keep_axis_position(float *axis, float *last_pos, uint16_t words)
+{
+#ifdef AXIS_X
+    if (!CHECKFLAG(words, GCODE_WORD_X))
+    {
+        axis[AXIS_X] = last_pos[AXIS_X];
+    }
+#endif
+#ifdef AXIS_Y
+    if (!CHECKFLAG(words, GCODE_WORD_Y))
+    {
+        axis[AXIS_Y] = last_pos[AXIS_Y];
+    }
+#endif
+#ifdef AXIS_Z
+    if (!CHECKFLAG(words, GCODE_WORD_Z))
+    {
+        axis[AXIS_Z] = last_pos[AXIS_Z];
+    }
+#endif
+#ifdef AXIS_A
+    if (!CHECKFLAG(words, GCODE_WORD_A))
+    {
+        axis[AXIS_A] = last_pos[AXIS_A];
+    }
+#endif
+#ifdef AXIS_B
+    if (!CHECKFLAG(words, GCODE_WORD_B))
+    {
+        axis[AXIS_B] = last_pos[AXIS_B];
+    }
+#endif
+#ifdef AXIS_C
+    if (!CHECKFLAG(words, GCODE_WORD_C))
+    {
+        axis[AXIS_C] = last_pos[AXIS_C];
+    }
+#endif
+}
+
+#ifdef ENABLE_PARSER_FAST_PATH
+/*
+	Modal motion fast path
+	Caches the active offsets, units and tools after each line executed by the full RS274NGC order of execution
+	The fast path is available while the motion mode is G0 or G1 in units per minute feed mode and no program stop is active
+*/
+static void parser_fast_path_update(void)
+{
+    parser_fast_ready = false;
+    if (parser_state.groups.motion > G1 || parser_state.groups.feedrate_mode != G94 || parser_state.groups.stopping)
+    {
+        return;
+    }
+
+    parser_fast_units = (parser_state.groups.units == G20) ? 25.4f : 1.0f;
+    //absolute distance mode offsets (relative distance mode uses the current position)
+    for (uint8_t i = AXIS_COUNT; i != 0;)
+    {
+        i--;
+        parser_fast_offset[i] = parser_parameters.coord_system_offset[i] + parser_parameters.g92_offset[i];
+    }
+
+    memset(&parser_fast_block, 0, sizeof(motion_data_t));
+    parser_fast_block.motion_mode = MOTIONCONTROL_MODE_FEED;
+    switch (parser_state.groups.path_mode)
+    {
+    case G61_1:
+        parser_fast_block.motion_mode |= PLANNER_MOTION_EXACT_STOP;
+        break;
+    case G64:
+        parser_fast_block.motion_mode |= PLANNER_MOTION_CONTINUOUS;
+        break;
+    }
+#ifdef USE_SPINDLE
+    switch (parser_state.groups.spindle_turning)
+    {
+    case M3:
+        parser_fast_block.spindle = parser_state.spindle;
+        break;
+    case M4:
+        parser_fast_block.spindle = -parser_state.spindle;
+        break;
+    }
+#endif
+#ifdef USE_COOLANT
+    parser_fast_block.coolant = parser_state.groups.coolant;
+#endif
+    parser_fast_ready = true;
+}
+
+/*
+	Checks if the command is a motion in the current modal state
+	Only axis words with optional G0/G1, F and N words are accepted. All other commands (and all commands that could fail the validation) take the full path
+*/
+static bool parser_fast_path_check(parser_state_t *new_state, parser_words_t *words, parser_cmd_explicit_t *cmd)
+{
+    if (!parser_fast_ready || cnc_get_exec_state(EXEC_JOG))
+    {
+        return false;
+    }
+
+    if ((cmd->groups & ~GCODE_GROUP_MOTION) || cmd->mcodes || new_state->groups.motion > G1)
+    {
+        return false;
+    }
+
+#ifdef ENABLE_SYNC_OUTPUTS
+    if (cmd->output)
+    {
+        return false;
+    }
+#endif
+
+    if (!CHECKFLAG(cmd->words, GCODE_ALL_AXIS) || (cmd->words & ~(GCODE_ALL_AXIS | GCODE_WORD_F)))
+    {
+        return false;
+    }
+
+    if (CHECKFLAG(cmd->words, GCODE_WORD_F))
+    {
+        return (words->f > 0);
+    }
+
+    return (new_state->groups.motion == G0 || new_state->feedrate != 0);
+}
+
+/*
+	Executes the motion with the cached modal state (same result as steps 3, 12, 19 and 20 of the order of execution)
+*/
+static uint8_t parser_fast_path_exec(parser_state_t *new_state, parser_words_t *words, parser_cmd_explicit_t *cmd)
+{
+    float axis[AXIS_COUNT];
+    float last_pos[AXIS_COUNT];
+    motion_data_t block_data;
+
+    memcpy(&block_data, &parser_fast_block, sizeof(motion_data_t));
+#ifdef GCODE_PROCESS_LINE_NUMBERS
+    block_data.line = words->n;
+#endif
+
+    if (CHECKFLAG(cmd->words, GCODE_WORD_F))
+    {
+        new_state->feedrate = words->f * parser_fast_units;
+    }
+
+    mc_get_position(last_pos);
+    if (new_state->groups.distance_mode == G90)
+    {
+        for (uint8_t i = AXIS_COUNT; i != 0;)
+        {
+            i--;
+            axis[i] = words->xyzabc[i] * parser_fast_units + parser_fast_offset[i];
+        }
+#ifdef AXIS_TOOL
+        axis[AXIS_TOOL] += parser_parameters.tool_length_offset;
+#endif
+    }
+    else
     {
-        if (!CHECKFLAG(cmd->words, GCODE_WORD_Z))
+        for (uint8_t i = AXIS_COUNT; i != 0;)
         {
-            return STATUS_GCODE_AXIS_WORDS_EXIST;
+            i--;
+            axis[i] = words->xyzabc[i] * parser_fast_units + last_pos[i];
         }
     }
-//group 10 - return mode in canned cycles (not implemented yet)
-//group 12 - coordinate system selection (nothing to be checked)
-//group 13 - path control mode (nothing to be checked)
+    parser_keep_axis_position(axis, last_pos, cmd->words);
 
-//RS274NGC v3 - 3.6 Input M Codes
-//group 4 - stopping (nothing to be checked)
-//group 6 - tool change(not implemented yet)
-//group 7 - spindle turning (nothing to be checked)
-//group 8 - coolant (nothing to be checked)
-//group 9 - enable/disable feed and speed override switches (not implemented)
-
-//RS274NGC v3 - 3.7 Other Input Codes
-//Words S and T must be positive
-#ifdef USE_SPINDLE
-    if (words->s < 0)
+    if (new_state->groups.motion == G0)
     {
-        return STATUS_NEGATIVE_VALUE;
-    }
+        block_data.feed = FLT_MAX;
+#ifdef LASER_MODE
+        //laser disabled in G0
+        if (g_settings.laser_mode)
+        {
+            block_data.spindle = 0;
+        }
 #endif
-#ifdef USE_TOOL_CHANGER
-    if (words->t < 0)
-    {
-        return STATUS_NEGATIVE_VALUE;
     }
-    if (words->t > g_settings.tool_count)
+    else
     {
-        return STATUS_INVALID_TOOL;
+        block_data.feed = new_state->feedrate;
     }
-#endif
-    return STATUS_OK;
+
+    return mc_line(axis, &block_data);
 }
+#endif
 
 /*
 	STEP 3
@@ -970,7 +1675,7 @@ static uint8_t parser_exec_command(parser_state_t *new_state, parser_words_t *wo
     block_data.line = words->n;
 #endif
 
-    mc_get_position(&planner_last_pos);
+    mc_get_position(planner_last_pos);
 
     //RS274NGC v3 - 3.8 Order of Execution
     //1. comment (ignored - already filtered)
@@ -1022,18 +1727,10 @@ static uint8_t parser_exec_command(parser_state_t *new_state, parser_words_t *wo
         break;
     }
 
-    //spindle speed or direction was changed (force a safety dwell to let the spindle change speed and continue)
+    //spindle speed or direction might have changed (the motion control waits for the spindle speed only if needed)
     if (CHECKFLAG(cmd->words, GCODE_WORD_S) || CHECKFLAG(cmd->groups, GCODE_GROUP_SPINDLE))
     {
         updatetools = true;
-#ifdef LASER_MODE
-        if (!g_settings.laser_mode)
-        {
-#endif
-            block_data.dwell = (uint16_t)roundf(DELAY_ON_SPINDLE_SPEED_CHANGE * 10.0);
-#ifdef LASER_MODE
-        }
-#endif
     }
 #endif
 //8. coolant on/off
@@ -1053,6 +1750,79 @@ static uint8_t parser_exec_command(parser_state_t *new_state, parser_words_t *wo
         planner_toggle_overrides();
     }
 
+    //feed acceleration factor (M204) applies to all the following feed motions (M204 without P restores the default)
+    if (CHECKFLAG(cmd->mcodes, GCODE_MCODE_M204))
+    {
+        planner_set_feed_accel_factor((CHECKFLAG(cmd->words, GCODE_WORD_P)) ? words->p : 1.0f);
+    }
+
+#ifdef ENABLE_SYNC_OUTPUTS
+    //digital and analog outputs (M62, M63 and M67 change with the next motion and M64, M65 and M68 change immediately)
+    switch (cmd->output)
+    {
+    case 62:
+    case 63:
+    case 64:
+    case 65:
+        if (mc_digital_output((uint8_t)words->p, !(cmd->output & 0x01), (cmd->output < 64)))
+        {
+            return STATUS_CRITICAL_FAIL;
+        }
+        break;
+    case 67:
+    case 68:
+        if (mc_analog_output((uint8_t)words->p, words->l, (cmd->output == 67)))
+        {
+            return STATUS_CRITICAL_FAIL;
+        }
+        break;
+    }
+#endif
+
+#ifdef ENABLE_ADAPTIVE_FEED
+    //adaptive feed on (M52 or M52 P1) or off (M52 P0)
+    if (CHECKFLAG(cmd->mcodes, GCODE_MCODE_M52))
+    {
+        planner_adaptive_feed_enable(!CHECKFLAG(cmd->words, GCODE_WORD_P) || words->p != 0);
+    }
+#endif
+
+#ifdef ENABLE_AUX_STEPPER
+    //auxiliary stepper motion (M100) runs asynchronously and M101 waits for it to finish
+    if (CHECKFLAG(cmd->mcodes, GCODE_MCODE_M100))
+    {
+        //the position is converted to mm like the axis words
+        if (mc_aux_move((new_state->groups.units == G20) ? (words->p * 25.4f) : words->p))
+        {
+            return STATUS_CRITICAL_FAIL;
+        }
+    }
+
+    if (CHECKFLAG(cmd->mcodes, GCODE_MCODE_M101))
+    {
+        if (mc_aux_sync())
+        {
+            return STATUS_CRITICAL_FAIL;
+        }
+    }
+#endif
+
+#ifdef ENABLE_THC
+    //torch height control on (M102) and off (M103)
+    if (CHECKFLAG(cmd->mcodes, GCODE_MCODE_M102))
+    {
+        mc_thc_enable();
+    }
+
+    if (CHECKFLAG(cmd->mcodes, GCODE_MCODE_M103))
+    {
+        if (mc_thc_disable())
+        {
+            return STATUS_CRITICAL_FAIL;
+        }
+    }
+#endif
+
     //10. dwell
     if (new_state->groups.nonmodal == G4)
     {
@@ -1139,12 +1909,16 @@ static uint8_t parser_exec_command(parser_state_t *new_state, parser_words_t *wo
 //13. cutter radius compensation on or off (G40, G41, G42) (not implemented yet)
 //14. cutter length compensation on or off (G43.1, G49)
 #ifdef AXIS_TOOL
-    if ((new_state->groups.tool_length_offset == 1) && CHECKFLAG(cmd->groups, GCODE_GROUP_TOOLLENGTH))
+    if ((new_state->groups.tool_length_offset == G43_1) && CHECKFLAG(cmd->groups, GCODE_GROUP_TOOLLENGTH))
     {
         parser_parameters.tool_length_offset = words->xyzabc[AXIS_Z];
         CLEARFLAG(cmd->words, GCODE_WORD_Z);
         words->xyzabc[AXIS_TOOL] = 0; //resets parameter so it it doen't do anything else
     }
+    else if ((new_state->groups.tool_length_offset == G49) && CHECKFLAG(cmd->groups, GCODE_GROUP_TOOLLENGTH))
+    {
+        parser_parameters.tool_length_offset = 0;
+    }
 #endif
     //15. coordinate system selection (G54, G55, G56, G57, G58, G59, G59.1, G59.2, G59.3) (OK nothing to be done)
     if (CHECKFLAG(cmd->groups, GCODE_GROUP_COORDSYS))
@@ -1156,13 +1930,25 @@ static uint8_t parser_exec_command(parser_state_t *new_state, parser_words_t *wo
     //16. set path control mode (G61, G61.1, G64)
     switch (new_state->groups.path_mode)
     {
-    case 1:
+    case G61_1:
         block_data.motion_mode |= PLANNER_MOTION_EXACT_STOP;
         break;
-    case 3:
+    case G64:
         block_data.motion_mode |= PLANNER_MOTION_CONTINUOUS;
         break;
     }
+#ifdef ENABLE_G64_PATH_BLENDING
+    //G64 P sets the path blending tolerance (G64 without P or G61/G61.1 disable path blending)
+    if (CHECKFLAG(cmd->groups, GCODE_GROUP_PATH))
+    {
+        float tolerance = 0;
+        if (new_state->groups.path_mode == G64 && CHECKFLAG(cmd->words, GCODE_WORD_P))
+        {
+            tolerance = (new_state->groups.units == G20) ? (words->p * 25.4f) : words->p;
+        }
+        mc_set_blend_tolerance(tolerance);
+    }
+#endif
 
     //17. set distance mode (G90, G91) (OK nothing to be done)
 
@@ -1264,43 +2050,8 @@ static uint8_t parser_exec_command(parser_state_t *new_state, parser_words_t *wo
         }
     }
 
-//for all not explicitly declared axis retain their position
-#ifdef AXIS_X
-    if (!CHECKFLAG(cmd->words, GCODE_WORD_X))
-    {
-        axis[AXIS_X] = planner_last_pos[AXIS_X];
-    }
-#endif
-#ifdef AXIS_Y
-    if (!CHECKFLAG(cmd->words, GCODE_WORD_Y))
-    {
-        axis[AXIS_Y] = planner_last_pos[AXIS_Y];
-    }
-#endif
-#ifdef AXIS_Z
-    if (!CHECKFLAG(cmd->words, GCODE_WORD_Z))
-    {
-        axis[AXIS_Z] = planner_last_pos[AXIS_Z];
-    }
-#endif
-#ifdef AXIS_A
-    if (!CHECKFLAG(cmd->words, GCODE_WORD_A))
-    {
-        axis[AXIS_A] = planner_last_pos[AXIS_A];
-    }
-#endif
-#ifdef AXIS_B
-    if (!CHECKFLAG(cmd->words, GCODE_WORD_B))
-    {
-        axis[AXIS_B] = planner_last_pos[AXIS_B];
-    }
-#endif
-#ifdef AXIS_C
-    if (!CHECKFLAG(cmd->words, GCODE_WORD_C))
-    {
-        axis[AXIS_C] = planner_last_pos[AXIS_C];
-    }
-#endif
+    //for all not explicitly declared axis retain their position
+    parser_keep_axis_position(axis, planner_last_pos, cmd->words);
 
     //stores G10 L2 command in the right address
     if (index <= G30HOME)
@@ -1344,6 +2095,91 @@ static uint8_t parser_exec_command(parser_state_t *new_state, parser_words_t *wo
             return error;
         }
         break;
+    case G37: //G37
+        if (block_data.feed == 0)
+        {
+            return STATUS_FEED_NOT_SET;
+        }
+
+        error = mc_probe_cycle(axis, &block_data);
+        if (error)
+        {
+            parser_parameters.last_probe_ok = 0;
+            cnc_alarm(error);
+            error = 0;
+            break;
+        }
+
+        parser_update_probe_pos();
+        parser_parameters.last_probe_ok = 1;
+        if (CHECKFLAG(cmd->words, GCODE_WORD_P))
+        {
+            //sets the offset of the probed axis in the coordinate system (P1 to P9)
+            //the probed point takes the coordinate of R (0 if omitted)
+            address = SETTINGS_PARSER_PARAMETERS_ADDRESS_OFFSET + ((uint8_t)(words->p - 1) * PARSER_PARAM_ADDR_OFFSET);
+            float offset[AXIS_COUNT];
+            if (settings_load(address, (uint8_t *)&offset[0], PARSER_PARAM_SIZE))
+            {
+                memset(offset, 0, sizeof(offset));
+            }
+
+            for (uint8_t i = AXIS_COUNT; i != 0;)
+            {
+                i--;
+                if (axis[i] != planner_last_pos[i])
+                {
+                    offset[i] = parser_parameters.last_probe_position[i] - parser_parameters.g92_offset[i] - words->r;
+#ifdef AXIS_TOOL
+                    if (i == AXIS_TOOL)
+                    {
+                        offset[i] -= parser_parameters.tool_length_offset;
+                    }
+#endif
+                }
+            }
+
+            settings_save(address, (uint8_t *)&offset[0], PARSER_PARAM_SIZE);
+            if (parser_parameters.coord_system_index == (uint8_t)(words->p - 1))
+            {
+                memcpy(parser_parameters.coord_system_offset, offset, sizeof(offset));
+            }
+            parser_wco_counter = 0;
+        }
+#ifdef AXIS_TOOL
+        else
+        {
+            //sets the tool length offset so that the probed point takes the coordinate of R (0 if omitted)
+            parser_parameters.tool_length_offset = parser_parameters.last_probe_position[AXIS_TOOL] - parser_parameters.coord_system_offset[AXIS_TOOL] - parser_parameters.g92_offset[AXIS_TOOL] - words->r;
+            new_state->groups.tool_length_offset = G43_1;
+            parser_wco_counter = 0;
+        }
+#endif
+        break;
+#ifdef ENABLE_MESH_COMPENSATION
+    case G29: //G29
+        if (CHECKFLAG(cmd->words, GCODE_ALL_AXIS))
+        {
+            if (block_data.feed == 0)
+            {
+                return STATUS_FEED_NOT_SET;
+            }
+
+            error = mc_probe_mesh(axis, &block_data);
+            if (error)
+            {
+                cnc_alarm(error);
+            }
+        }
+        else
+        {
+            error = mc_clear_mesh();
+            if (error)
+            {
+                return error;
+            }
+        }
+        break;
+#endif
     case G92: //G92
         for (uint8_t i = AXIS_COUNT; i != 0;)
         {
@@ -1467,7 +2303,9 @@ static uint8_t parser_exec_command(parser_state_t *new_state, parser_words_t *wo
                 {
                     cnc_alarm(probe_error);
                 }
+                break;
             }
+            parser_update_probe_pos();
             parser_parameters.last_probe_ok = 1;
         }
     }
@@ -1486,6 +2324,12 @@ static uint8_t parser_exec_command(parser_state_t *new_state, parser_words_t *wo
         break;
     case 3: //M2
     case 4: //M30
+#ifdef ENABLE_THC
+        if (mc_thc_disable())
+        {
+            return STATUS_CRITICAL_FAIL;
+        }
+#endif
         //reset to initial states
         parser_reset();
         protocol_send_feedback(MSG_FEEDBACK_8);
@@ -1532,6 +2376,19 @@ static uint8_t parser_gcode_command(void)
         return result;
     }
 
+#ifdef ENABLE_PARSER_FAST_PATH
+    //motions in the current modal state skip the validation and the full order of execution
+    if (parser_fast_path_check(&next_state, &words, &cmd))
+    {
+        result = parser_fast_path_exec(&next_state, &words, &cmd);
+        if (result == STATUS_OK)
+        {
+            memcpy(&parser_state, &next_state, sizeof(parser_state_t));
+        }
+        return result;
+    }
+#endif
+
     //validates command
     result = parser_validate_command(&next_state, &words, &cmd);
     if (result != STATUS_OK)
@@ -1551,6 +2408,9 @@ static uint8_t parser_gcode_command(void)
     {
         //if everything went ok updates the parser modal groups and position
         memcpy(&parser_state, &next_state, sizeof(parser_state_t));
+#ifdef ENABLE_PARSER_FAST_PATH
+        parser_fast_path_update();
+#endif
     }
 
     return result;
@@ -1578,11 +2438,9 @@ static uint8_t parser_get_float(float *value)
             result |= NUMBER_ISNEGATIVE;
         }
 #ifdef ECHO_CMD
-        serial_putc(serial_getc());
-#else
-        serial_getc();
-
+        serial_putc(c);
 #endif
+        parser_line++;
         c = parser_get_next_preprocessed(true);
     }
 
@@ -1618,11 +2476,9 @@ static uint8_t parser_get_float(float *value)
         }
 
 #ifdef ECHO_CMD
-        serial_putc(serial_getc());
-#else
-        serial_getc();
-
+        serial_putc(c);
 #endif
+        parser_line++;
         c = parser_get_next_preprocessed(true);
     }
 
@@ -1666,12 +2522,12 @@ static uint8_t parser_get_comment(void)
     uint8_t msg_parser = 0;
     for (;;)
     {
-        unsigned char c = serial_peek();
+        unsigned char c = *parser_line;
         switch (c)
         {
             //case '(':	//error under RS274NGC (commented for Grbl compatibility)
         case ')': //OK
-            serial_getc();
+            parser_line++;
 #ifdef PROCESS_COMMENTS
             if (msg_parser == 4)
             {
@@ -1711,7 +2567,7 @@ static uint8_t parser_get_comment(void)
 #endif
         }
 
-        serial_getc();
+        parser_line++;
     }
 
     return STATUS_BAD_COMMENT_FORMAT; //never reached here
@@ -1719,15 +2575,15 @@ static uint8_t parser_get_comment(void)
 
 static uint8_t parser_eat_next_char(unsigned char c)
 {
-    return ((serial_getc() == c) ? STATUS_OK : STATUS_INVALID_STATEMENT);
+    return ((parser_getc() == c) ? STATUS_OK : STATUS_INVALID_STATEMENT);
 }
 
 static uint8_t parser_get_token(unsigned char *word, float *value)
 {
-    unsigned char c = serial_getc();
+    unsigned char c = parser_getc();
 
     //if other char starts tokenization
-    if (c > 'Z')
+    if (c >= 'a' && c <= 'z')
     {
         c -= 32; //uppercase
     }
@@ -1922,6 +2778,28 @@ static uint8_t parser_gcode_word(uint8_t code, uint8_t mantissa, parser_state_t
         new_group |= GCODE_GROUP_PATH;
         new_state->groups.path_mode = code;
         break;
+#ifdef ENABLE_MESH_COMPENSATION
+    //G29 doesn't fit the nonmodal code conversion
+    case 29:
+        if (cmd->group_0_1_useaxis)
+        {
+            return STATUS_GCODE_MODAL_GROUP_VIOLATION;
+        }
+        cmd->group_0_1_useaxis = true;
+        new_group |= GCODE_GROUP_NONMODAL;
+        new_state->groups.nonmodal = G29;
+        break;
+#endif
+    //G37 doesn't fit the nonmodal code conversion
+    case 37:
+        if (cmd->group_0_1_useaxis)
+        {
+            return STATUS_GCODE_MODAL_GROUP_VIOLATION;
+        }
+        cmd->group_0_1_useaxis = true;
+        new_group |= GCODE_GROUP_NONMODAL;
+        new_state->groups.nonmodal = G37;
+        break;
     //de following nonmodal colide with motion groupcodes
     case 10:
     case 28:
@@ -2037,6 +2915,58 @@ static uint8_t parser_mcode_word(uint8_t code, uint8_t mantissa, parser_state_t
         code = (code == 48) ? M48 : M49;
         new_state->groups.feed_speed_override = code;
         break;
+    case 204:
+        if (CHECKFLAG(cmd->mcodes, GCODE_MCODE_M204))
+        {
+            return STATUS_GCODE_MODAL_GROUP_VIOLATION;
+        }
+        cmd->mcodes |= GCODE_MCODE_M204;
+        return STATUS_OK;
+#ifdef ENABLE_SYNC_OUTPUTS
+    case 62:
+    case 63:
+    case 64:
+    case 65:
+    case 67:
+    case 68:
+        if (cmd->output)
+        {
+            return STATUS_GCODE_MODAL_GROUP_VIOLATION;
+        }
+        cmd->output = code;
+        return STATUS_OK;
+#endif
+#ifdef ENABLE_ADAPTIVE_FEED
+    case 52:
+        if (CHECKFLAG(cmd->mcodes, GCODE_MCODE_M52))
+        {
+            return STATUS_GCODE_MODAL_GROUP_VIOLATION;
+        }
+        cmd->mcodes |= GCODE_MCODE_M52;
+        return STATUS_OK;
+#endif
+#ifdef ENABLE_AUX_STEPPER
+    case 100:
+    case 101:
+        code = (code == 100) ? GCODE_MCODE_M100 : GCODE_MCODE_M101;
+        if (CHECKFLAG(cmd->mcodes, code))
+        {
+            return STATUS_GCODE_MODAL_GROUP_VIOLATION;
+        }
+        cmd->mcodes |= code;
+        return STATUS_OK;
+#endif
+#ifdef ENABLE_THC
+    case 102:
+    case 103:
+        code = (code == 102) ? GCODE_MCODE_M102 : GCODE_MCODE_M103;
+        if (CHECKFLAG(cmd->mcodes, GCODE_MCODE_M102 | GCODE_MCODE_M103))
+        {
+            return STATUS_GCODE_MODAL_GROUP_VIOLATION;
+        }
+        cmd->mcodes |= code;
+        return STATUS_OK;
+#endif
     default:
         return STATUS_GCODE_UNSUPPORTED_COMMAND;
     }
@@ -2132,16 +3062,16 @@ static uint8_t parser_letter_word(unsigned char c, float value, uint8_t mantissa
             return STATUS_GCODE_COMMAND_VALUE_NOT_INTEGER;
         }
 
+        if (value > 255)
+        {
+            return STATUS_GCODE_MAX_VALUE_EXCEEDED;
+        }
+
         words->l = (uint8_t)truncf(value);
         break;
     case 'P':
         cmd->words |= GCODE_WORD_P;
-
-        if (value < 0)
-        {
-            return STATUS_NEGATIVE_VALUE;
-        }
-
+        //the sign is checked in the validation (the M100 position can be negative)
         words->p = value;
         break;
     case 'R':
@@ -2183,23 +3113,35 @@ static uint8_t parser_letter_word(unsigned char c, float value, uint8_t mantissa
     return STATUS_OK;
 }
 
+//reads the next char of the line (the cursor stops at the line terminator)
+static unsigned char parser_getc(void)
+{
+    unsigned char c = *parser_line;
+    if (c != EOL)
+    {
+        parser_line++;
+    }
+
+    return c;
+}
+
 static unsigned char parser_get_next_preprocessed(bool peek)
 {
-    unsigned char c = serial_peek();
+    unsigned char c = *parser_line;
 
     while (c == ' ' || c == '(')
     {
-        serial_getc();
+        parser_line++;
         if (c == '(')
         {
             parser_get_comment();
         }
-        c = serial_peek();
+        c = *parser_line;
     }
 
     if (!peek)
     {
-        serial_getc();
+        parser_getc();
     }
 
     return c;
@@ -2213,7 +3155,7 @@ static void parser_discard_command(void)
 #endif
     do
     {
-        c = serial_getc();
+        c = parser_getc();
 #ifdef ECHO_CMD
         serial_putc(c);
 #endif
@@ -2222,6 +3164,9 @@ static void parser_discard_command(void)
 
 static void parser_reset(void)
 {
+#ifdef ENABLE_PARSER_FAST_PATH
+    parser_fast_ready = false;
+#endif
     parser_state.groups.coord_system = G54;               //G54
     parser_state.groups.plane = G17;                      //G17
     parser_state.groups.feed_speed_override = M48;        //M48
@@ -2238,6 +3183,10 @@ static void parser_reset(void)
     parser_state.groups.motion = G1;                                     //G1
     parser_state.groups.units = G21;                                     //G21
     memset(parser_parameters.g92_offset, 0, AXIS_COUNT * sizeof(float)); //G92.2
+    planner_set_feed_accel_factor(1.0f);                                 //M204
+#ifdef ENABLE_ADAPTIVE_FEED
+    planner_adaptive_feed_enable(false); //M52 P0
+#endif
 }
 
 //loads parameters
@@ -2247,6 +3196,9 @@ static void parser_reset(void)
 void parser_parameters_load(void)
 {
     const uint8_t size = PARSER_PARAM_SIZE;
+#ifdef ENABLE_PARSER_FAST_PATH
+    parser_fast_ready = false;
+#endif
 
     //loads G92
     if (settings_load(G92ADDRESS, (uint8_t *)&parser_parameters.g92_offset, PARSER_PARAM_SIZE))
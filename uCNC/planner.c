@@ -41,6 +41,10 @@ typedef struct
 #endif
 #ifdef USE_COOLANT
     uint8_t coolant_override;
+#endif
+#ifdef ENABLE_ADAPTIVE_FEED
+    float adaptive_feed;
+    bool adaptive_feed_enabled;
 #endif
     bool overrides_enabled;
 
@@ -58,14 +62,30 @@ static uint8_t planner_data_write;
 static uint8_t planner_data_read;
 static uint8_t planner_data_slots;
 static planner_overrides_t planner_overrides;
+static float planner_feed_accel_factor;
+#ifdef ENABLE_SYNC_OUTPUTS
+//outputs changed with the next block
+static planner_outputs_t planner_outputs;
+#endif
 static uint8_t planner_ovr_counter;
+#ifdef ENABLE_PARSE_AHEAD
+//motions already computed that wait for a free planner block
+static motion_data_t planner_queue[PARSE_AHEAD_QUEUE_SIZE];
+static uint8_t planner_queue_write;
+static uint8_t planner_queue_read;
+static uint8_t planner_queue_count;
+#endif
 
+static void planner_add_block(motion_data_t *block_data);
 static void planner_buffer_write(void);
 static void planner_buffer_read(void);
 FORCEINLINE static uint8_t planner_buffer_next(uint8_t index);
 FORCEINLINE static uint8_t planner_buffer_prev(uint8_t index);
 FORCEINLINE static void planner_recalculate(void);
 FORCEINLINE static void planner_buffer_clear(void);
+#ifdef ENABLE_PARSE_AHEAD
+FORCEINLINE static void planner_queue_flush(void);
+#endif
 
 /*
 	Adds a new line to the trajectory planner
@@ -83,6 +103,66 @@ FORCEINLINE static void planner_buffer_clear(void);
 */
 void planner_add_line(uint32_t *target, motion_data_t *block_data)
 {
+#ifdef USE_SPINDLE
+    planner_spindle = block_data->spindle;
+#endif
+#ifdef USE_COOLANT
+    planner_coolant = block_data->coolant;
+#endif
+    //updates the current planner coordinates
+    if (target != NULL)
+    {
+        memcpy(planner_step_pos, target, sizeof(planner_step_pos));
+    }
+
+#ifdef ENABLE_PARSE_AHEAD
+    //the motion waits in the queue if the planner is full or if older motions are still waiting
+    planner_queue_run();
+    if (planner_queue_count || !planner_data_slots)
+    {
+        memcpy(&planner_queue[planner_queue_write], block_data, sizeof(motion_data_t));
+        if (++planner_queue_write == PARSE_AHEAD_QUEUE_SIZE)
+        {
+            planner_queue_write = 0;
+        }
+        planner_queue_count++;
+        return;
+    }
+#endif
+
+    planner_add_block(block_data);
+}
+
+#ifdef ENABLE_PARSE_AHEAD
+//moves the queued motions to the planner while it has free blocks
+void planner_queue_run(void)
+{
+    while (planner_queue_count && planner_data_slots)
+    {
+        planner_add_block(&planner_queue[planner_queue_read]);
+        if (++planner_queue_read == PARSE_AHEAD_QUEUE_SIZE)
+        {
+            planner_queue_read = 0;
+        }
+        planner_queue_count--;
+    }
+}
+
+//waits for the queued motions to enter the planner (before changing the planner state applied to them)
+static void planner_queue_flush(void)
+{
+    while (planner_queue_count)
+    {
+        if (!cnc_doevents())
+        {
+            return;
+        }
+    }
+}
+#endif
+
+static void planner_add_block(motion_data_t *block_data)
+{
 #ifdef ENABLE_LINACT_PLANNER
     static float last_dir_vect[STEPPER_COUNT];
 #else
@@ -100,15 +180,26 @@ void planner_add_line(uint32_t *target, motion_data_t *block_data)
     planner_data[planner_data_write].entry_feed_sqr = 0;
     planner_data[planner_data_write].entry_max_feed_sqr = 0;
 #ifdef USE_SPINDLE
-    planner_spindle = planner_data[planner_data_write].spindle = block_data->spindle;
+    planner_data[planner_data_write].spindle = block_data->spindle;
 #endif
 #ifdef USE_COOLANT
-    planner_coolant = planner_data[planner_data_write].coolant = block_data->coolant;
+    planner_data[planner_data_write].coolant = block_data->coolant;
 #endif
 #ifdef GCODE_PROCESS_LINE_NUMBERS
     planner_data[planner_data_write].line = block_data->line;
 #endif
     planner_data[planner_data_write].dwell = block_data->dwell;
+#ifdef SPINDLE_AT_SPEED
+    planner_data[planner_data_write].spindle_wait = block_data->spindle_wait;
+#endif
+#ifdef ENABLE_ADAPTIVE_FEED
+    planner_data[planner_data_write].adaptive_feed = planner_overrides.adaptive_feed_enabled;
+#endif
+#ifdef ENABLE_SYNC_OUTPUTS
+    //the pending outputs change at the start of this block
+    planner_data[planner_data_write].outputs = planner_outputs;
+    memset(&planner_outputs, 0, sizeof(planner_outputs_t));
+#endif
 
 #ifdef ENABLE_BACKLASH_COMPENSATION
     if (CHECKFLAG(block_data->motion_mode, MOTIONCONTROL_MODE_BACKLASH_COMPENSATION))
@@ -176,6 +267,10 @@ void planner_add_line(uint32_t *target, motion_data_t *block_data)
             last_dir_vect[i] = dir_vect[i];
 #endif
             //calculate (per linear actuator) the minimum inverted time of travel (1/min) an acceleration (1/s^2)
+            //the rapid feed and acceleration are clamped per linear actuator so the most limited actuator moves at its own maximum rate and acceleration
+            //a straight line rapid motion is only as fast as independently profiled actuators if the same actuator limits both the feed and the acceleration
+            //otherwise (for example X 5000mm/min 200mm/s^2 and Y 3000mm/min 400mm/s^2) the acceleration ramps of the straight line are slower
+            //ENABLE_RAPID_INDEPENDENT_AXIS splits these rapid motions so each axis moves with its own profile (see motion control)
             float step_ratio = g_settings.step_per_mm[i] / (float)planner_data[planner_data_write].steps[i];
             float stepper_feed = g_settings.max_feed_rate[i] * step_ratio;
             rapid_feed = MIN(rapid_feed, stepper_feed);
@@ -194,6 +289,13 @@ void planner_add_line(uint32_t *target, motion_data_t *block_data)
     rapid_feed *= (float)block_data->total_steps;
     //converts to steps per second^2 (st/s^2)
     planner_data[planner_data_write].acceleration *= (float)block_data->total_steps;
+    //applies the acceleration factor of the motion class (feed, rapid, jog or homing)
+    uint8_t accel_class = (block_data->motion_mode & MOTIONCONTROL_MODE_ACCEL_MASK) >> MOTIONCONTROL_MODE_ACCEL_SHIFT;
+    planner_data[planner_data_write].acceleration *= g_settings.accel_factor[accel_class];
+    if (accel_class == (MOTIONCONTROL_MODE_ACCEL_FEED >> MOTIONCONTROL_MODE_ACCEL_SHIFT))
+    {
+        planner_data[planner_data_write].acceleration *= planner_feed_accel_factor;
+    }
 
     if (block_data->feed > rapid_feed)
     {
@@ -259,11 +361,6 @@ void planner_add_line(uint32_t *target, motion_data_t *block_data)
 
     //advances the buffer
     planner_buffer_write();
-    //updates the current planner coordinates
-    if (target != NULL)
-    {
-        memcpy(planner_step_pos, target, sizeof(planner_step_pos));
-    }
 }
 
 /*
@@ -314,7 +411,20 @@ bool planner_buffer_is_empty(void)
 
 bool planner_buffer_is_full(void)
 {
+#ifdef ENABLE_PARSE_AHEAD
+    return (planner_data_slots == 0 && planner_queue_count == PARSE_AHEAD_QUEUE_SIZE);
+#else
     return (planner_data_slots == 0);
+#endif
+}
+
+uint8_t planner_get_buffer_freeslots(void)
+{
+#ifdef ENABLE_PARSE_AHEAD
+    return planner_data_slots + PARSE_AHEAD_QUEUE_SIZE - planner_queue_count;
+#else
+    return planner_data_slots;
+#endif
 }
 
 static void planner_buffer_clear(void)
@@ -322,6 +432,11 @@ static void planner_buffer_clear(void)
     planner_data_write = 0;
     planner_data_read = 0;
     planner_data_slots = PLANNER_BUFFER_SIZE;
+#ifdef ENABLE_PARSE_AHEAD
+    planner_queue_write = 0;
+    planner_queue_read = 0;
+    planner_queue_count = 0;
+#endif
 #ifdef FORCE_GLOBALS_TO_0
     memset(planner_data, 0, sizeof(planner_data));
 #endif
@@ -335,6 +450,7 @@ void planner_init(void)
     memset(planner_data, 0, sizeof(planner_data));
 #endif
     planner_buffer_clear();
+    planner_feed_accel_factor = 1.0f;
     planner_overrides.overrides_enabled = true;
     planner_feed_ovr_reset();
     planner_rapid_feed_ovr_reset();
@@ -344,6 +460,10 @@ void planner_init(void)
 #ifdef USE_COOLANT
     planner_coolant_ovr_reset();
 #endif
+#ifdef ENABLE_ADAPTIVE_FEED
+    planner_overrides.adaptive_feed = 1.0f;
+    planner_adaptive_feed_enable(false);
+#endif
 }
 
 void planner_clear(void)
@@ -355,6 +475,9 @@ void planner_clear(void)
 #endif
 #ifdef USE_COOLANT
     planner_coolant = 0;
+#endif
+#ifdef ENABLE_SYNC_OUTPUTS
+    memset(&planner_outputs, 0, sizeof(planner_outputs_t));
 #endif
     //resyncs position with interpolator
     planner_resync_position();
@@ -394,6 +517,23 @@ float planner_get_block_exit_speed_sqr(void)
         }
     }
 
+#ifdef ENABLE_ADAPTIVE_FEED
+    //the adaptive feed scales the feed (the rapid feed still limits the speed)
+    //if only one of the motions has adaptive feed the exit speed can only be lowered
+    if ((planner_data[planner_data_read].adaptive_feed || planner_data[next].adaptive_feed) && planner_overrides.adaptive_feed != 1.0f)
+    {
+        float adaptive_speed_sqr = exit_speed_sqr * fast_flt_pow2(planner_overrides.adaptive_feed);
+        if (planner_data[planner_data_read].adaptive_feed && planner_data[next].adaptive_feed)
+        {
+            exit_speed_sqr = adaptive_speed_sqr;
+        }
+        else
+        {
+            exit_speed_sqr = MIN(exit_speed_sqr, adaptive_speed_sqr);
+        }
+    }
+#endif
+
     return MIN(exit_speed_sqr, rapid_feed_sqr);
 }
 
@@ -438,6 +578,14 @@ float planner_get_block_top_speed(void)
         }
     }
 
+#ifdef ENABLE_ADAPTIVE_FEED
+    //the adaptive feed scales the feed (the rapid feed still limits the speed)
+    if (planner_data[planner_data_read].adaptive_feed && planner_overrides.adaptive_feed != 1.0f)
+    {
+        target_speed_sqr *= fast_flt_pow2(planner_overrides.adaptive_feed);
+    }
+#endif
+
     //can't ever exceed rapid move speed
     target_speed_sqr = MIN(target_speed_sqr, rapid_feed_sqr);
     return MIN(junction_speed_sqr, target_speed_sqr);
@@ -510,6 +658,7 @@ static void planner_recalculate(void)
     float entry_feed_sqr = (planner_data[block].dwell == 0) ? (doubledistaccel) : 0;
     planner_data[block].entry_feed_sqr = MIN(planner_data[block].entry_max_feed_sqr, entry_feed_sqr);
     //optimizes entry speeds given the current exit speed (backward pass)
+    //the speed change of each block is computed with its own distance and acceleration
     uint8_t next = block;
     block = planner_buffer_prev(block);
 
@@ -521,6 +670,7 @@ static void planner_recalculate(void)
         }
         else if (planner_data[block].entry_feed_sqr != planner_data[block].entry_max_feed_sqr)
         {
+            doubledistaccel = ((float)(planner_data[block].total_steps << 1)) * planner_data[block].acceleration;
             entry_feed_sqr = planner_data[next].entry_feed_sqr + doubledistaccel;
             planner_data[block].entry_feed_sqr = MIN(planner_data[block].entry_max_feed_sqr, entry_feed_sqr);
         }
@@ -536,6 +686,7 @@ static void planner_recalculate(void)
         if (planner_data[block].entry_feed_sqr < planner_data[next].entry_feed_sqr)
         {
             //check if the next block entry speed can be achieved
+            doubledistaccel = ((float)(planner_data[block].total_steps << 1)) * planner_data[block].acceleration;
             float exit_speed_sqr = planner_data[block].entry_feed_sqr + (doubledistaccel);
             if (exit_speed_sqr < planner_data[next].entry_feed_sqr)
             {
@@ -557,6 +708,49 @@ static void planner_recalculate(void)
     }
 }
 
+#ifdef ENABLE_SYNC_OUTPUTS
+//the digital output (DOUTn) changes at the start of the next block
+void planner_add_digital_output(uint8_t output, uint8_t value)
+{
+    uint16_t mask = (1 << output);
+#ifdef ENABLE_PARSE_AHEAD
+    planner_queue_flush();
+#endif
+    if (value)
+    {
+        planner_outputs.set |= mask;
+        planner_outputs.clear &= ~mask;
+    }
+    else
+    {
+        planner_outputs.clear |= mask;
+        planner_outputs.set &= ~mask;
+    }
+}
+
+//the analog output (PWMn) changes at the start of the next block
+//only one analog output can change in each block (returns false if other analog output is waiting for the next block)
+bool planner_add_analog_output(uint8_t output, uint8_t value)
+{
+#ifdef ENABLE_PARSE_AHEAD
+    planner_queue_flush();
+#endif
+    if (planner_outputs.analog && planner_outputs.analog != (output + 1))
+    {
+        return false;
+    }
+
+    planner_outputs.analog = output + 1;
+    planner_outputs.analog_value = value;
+    return true;
+}
+
+bool planner_has_pending_outputs(void)
+{
+    return (planner_outputs.set || planner_outputs.clear || planner_outputs.analog);
+}
+#endif
+
 void planner_get_position(uint32_t *steps)
 {
     memcpy(steps, planner_step_pos, sizeof(planner_step_pos));
@@ -581,6 +775,15 @@ bool planner_get_overrides(void)
     return planner_overrides.overrides_enabled;
 }
 
+//sets the acceleration factor applied to all new feed motions (M204)
+void planner_set_feed_accel_factor(float factor)
+{
+#ifdef ENABLE_PARSE_AHEAD
+    planner_queue_flush();
+#endif
+    planner_feed_accel_factor = factor;
+}
+
 void planner_feed_ovr_inc(uint8_t value)
 {
     uint8_t ovr_val = planner_overrides.feed_override;
@@ -661,6 +864,42 @@ void planner_coolant_ovr_reset(void)
 }
 #endif
 
+#ifdef ENABLE_ADAPTIVE_FEED
+//enables or disables the adaptive feed (M52) for all the following motions
+void planner_adaptive_feed_enable(bool enable)
+{
+#ifdef ENABLE_PARSE_AHEAD
+    planner_queue_flush();
+#endif
+    planner_overrides.adaptive_feed_enabled = enable;
+}
+
+//samples the load signal and scales the feed to keep the load at the setpoint ($36)
+//called once for each interpolator segment (the sample rate is the integrator rate while moving)
+void planner_adaptive_feed_update(void)
+{
+    //motions without adaptive feed restart at the programmed feed
+    if (planner_data_slots == PLANNER_BUFFER_SIZE || !planner_data[planner_data_read].adaptive_feed)
+    {
+        planner_overrides.adaptive_feed = 1.0f;
+        return;
+    }
+
+    float error = g_settings.adaptive_feed_load - (float)mcu_get_analog(ADAPTIVE_FEED_ANALOG);
+    float change = error * (ADAPTIVE_FEED_GAIN * 0.01f);
+    //the change is rate limited
+    change = MIN(MAX(change, -(ADAPTIVE_FEED_MAX_CHANGE * 0.01f)), (ADAPTIVE_FEED_MAX_CHANGE * 0.01f));
+    float adaptive_feed = planner_overrides.adaptive_feed + change;
+    adaptive_feed = MIN(MAX(adaptive_feed, (ADAPTIVE_FEED_MIN * 0.01f)), (ADAPTIVE_FEED_MAX * 0.01f));
+
+    if (adaptive_feed != planner_overrides.adaptive_feed)
+    {
+        planner_overrides.adaptive_feed = adaptive_feed;
+        itp_update();
+    }
+}
+#endif
+
 bool planner_get_overflows(uint8_t *overflows)
 {
     if (!planner_ovr_counter)
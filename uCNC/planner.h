@@ -33,6 +33,17 @@
 #define PLANNER_MOTION_EXACT_STOP 64
 #define PLANNER_MOTION_CONTINUOUS 128
 
+#ifdef ENABLE_SYNC_OUTPUTS
+//digital and analog outputs changed at the start of a block
+typedef struct
+{
+    uint16_t set;         //DOUTn outputs turned on
+    uint16_t clear;       //DOUTn outputs turned off
+    uint8_t analog;       //PWMn output + 1 (0 - no analog output change)
+    uint8_t analog_value;
+} planner_outputs_t;
+#endif
+
 typedef struct
 {
     #ifdef GCODE_PROCESS_LINE_NUMBERS
@@ -56,9 +67,18 @@ typedef struct
     uint8_t coolant;
 #endif
     uint16_t dwell;
+#ifdef SPINDLE_AT_SPEED
+    bool spindle_wait;
+#endif
 #ifdef ENABLE_BACKLASH_COMPENSATION
     bool backlash_comp;
 #endif
+#ifdef ENABLE_ADAPTIVE_FEED
+    bool adaptive_feed;
+#endif
+#ifdef ENABLE_SYNC_OUTPUTS
+    planner_outputs_t outputs;
+#endif
 
     bool optimal;
 } planner_block_t;
@@ -67,6 +87,7 @@ void planner_init(void);
 void planner_clear(void);
 bool planner_buffer_is_full(void);
 bool planner_buffer_is_empty(void);
+uint8_t planner_get_buffer_freeslots(void);
 planner_block_t *planner_get_block(void);
 float planner_get_block_exit_speed_sqr(void);
 float planner_get_block_top_speed(void);
@@ -80,14 +101,21 @@ uint8_t planner_get_previous_coolant(void);
 #endif
 void planner_discard_block(void);
 void planner_add_line(uint32_t *target, motion_data_t* block_data);
-void planner_add_analog_output(uint8_t output, uint8_t value);
+#ifdef ENABLE_PARSE_AHEAD
+void planner_queue_run(void);
+#endif
+#ifdef ENABLE_SYNC_OUTPUTS
+bool planner_add_analog_output(uint8_t output, uint8_t value);
 void planner_add_digital_output(uint8_t output, uint8_t value);
+bool planner_has_pending_outputs(void);
+#endif
 void planner_get_position(uint32_t *steps);
 void planner_resync_position(void);
 
 //overrides
 void planner_toggle_overrides(void);
 bool planner_get_overrides(void);
+void planner_set_feed_accel_factor(float factor);
 
 void planner_feed_ovr_reset(void);
 void planner_feed_ovr_inc(uint8_t value);
@@ -102,6 +130,10 @@ void planner_spindle_ovr_inc(uint8_t value);
 uint8_t planner_coolant_ovr_toggle(uint8_t value);
 void planner_coolant_ovr_reset(void);
 #endif
+#ifdef ENABLE_ADAPTIVE_FEED
+void planner_adaptive_feed_enable(bool enable);
+void planner_adaptive_feed_update(void);
+#endif
 
 bool planner_get_overflows(uint8_t *overflows);
 
@@ -48,6 +48,15 @@ void protocol_send_error(uint8_t error)
     procotol_send_newline();
 }
 
+#ifdef ENABLE_LINE_CHECKSUM
+void protocol_send_resend(uint32_t line)
+{
+    serial_print_str(__romstr__("Resend: "));
+    serial_print_long(line);
+    procotol_send_newline();
+}
+#endif
+
 void protocol_send_alarm(uint8_t alarm)
 {
     serial_print_str(__romstr__("ALARM:"));
@@ -231,6 +240,15 @@ void protocol_send_status(void)
     serial_print_str(__romstr__("|MPos:"));
     serial_print_fltarr(axis, MAX(AXIS_COUNT, 3));
 
+    //buffer state (free planner blocks and free serial bytes)
+    if (CHECKFLAG(g_settings.status_report_mask, 2))
+    {
+        serial_print_str(__romstr__("|Bf:"));
+        serial_print_int(planner_get_buffer_freeslots());
+        serial_putc(',');
+        serial_print_int(serial_get_rx_freebytes());
+    }
+
 #ifdef USE_SPINDLE
     serial_print_str(__romstr__("|FS:"));
 #else
@@ -502,11 +520,23 @@ void protocol_send_ucnc_settings(void)
     protocol_send_gcode_setting_line_flt(24, g_settings.homing_slow_feed_rate);
     protocol_send_gcode_setting_line_flt(25, g_settings.homing_fast_feed_rate);
     protocol_send_gcode_setting_line_flt(27, g_settings.homing_offset);
+    protocol_send_gcode_setting_line_flt(28, g_settings.probe_slow_feed_rate);
+    protocol_send_gcode_setting_line_flt(29, g_settings.probe_retract);
     protocol_send_gcode_setting_line_flt(30, g_settings.spindle_max_rpm);
     protocol_send_gcode_setting_line_flt(31, g_settings.spindle_min_rpm);
 #ifdef LASER_MODE
     protocol_send_gcode_setting_line_int(32, g_settings.laser_mode);
 #endif
+#ifdef ENABLE_EXTRUDER
+    protocol_send_gcode_setting_line_flt(33, g_settings.extruder_advance);
+#endif
+#ifdef ENABLE_THC
+    protocol_send_gcode_setting_line_flt(34, g_settings.thc_setpoint);
+    protocol_send_gcode_setting_line_flt(35, g_settings.thc_gain);
+#endif
+#ifdef ENABLE_ADAPTIVE_FEED
+    protocol_send_gcode_setting_line_flt(36, g_settings.adaptive_feed_load);
+#endif
 
 #ifdef ENABLE_SKEW_COMPENSATION
     protocol_send_gcode_setting_line_flt(37, g_settings.skew_xy_factor);
@@ -516,6 +546,14 @@ void protocol_send_ucnc_settings(void)
 #endif
 #endif
 
+    for (uint8_t i = 0; i < MOTIONCONTROL_ACCEL_CLASSES; i++)
+    {
+        protocol_send_gcode_setting_line_flt(40 + i, g_settings.accel_factor[i]);
+    }
+#ifdef USE_SPINDLE
+    protocol_send_gcode_setting_line_flt(44, g_settings.spindle_acceleration);
+#endif
+
     for (uint8_t i = 0; i < STEPPER_COUNT; i++)
     {
         protocol_send_gcode_setting_line_flt(100 + i, g_settings.step_per_mm[i]);
@@ -542,4 +580,16 @@ void protocol_send_ucnc_settings(void)
         protocol_send_gcode_setting_line_int(140 + i, g_settings.backlash_steps[i]);
     }
 #endif
+
+#ifdef ENABLE_INPUT_SHAPING
+    for (uint8_t i = 0; i < STEPPER_COUNT; i++)
+    {
+        protocol_send_gcode_setting_line_flt(150 + i, g_settings.shaper_frequency[i]);
+    }
+
+    for (uint8_t i = 0; i < STEPPER_COUNT; i++)
+    {
+        protocol_send_gcode_setting_line_flt(160 + i, g_settings.shaper_damping[i]);
+    }
+#endif
 }
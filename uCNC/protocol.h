@@ -25,6 +25,9 @@
 bool protocol_is_busy(void);
 void protocol_send_ok(void);
 void protocol_send_error(uint8_t error);
+#ifdef ENABLE_LINE_CHECKSUM
+void protocol_send_resend(uint32_t line);
+#endif
 void protocol_send_alarm(uint8_t alarm);
 void protocol_send_status(void);
 void protocol_send_string(const unsigned char *__s);
@@ -25,27 +25,133 @@
 #include "cnc.h"
 #include "serial.h"
 
+//16-bit indexes are only used in buffers larger than 255 chars (not atomic in 8-bit mcus)
+#if (RX_BUFFER_SIZE > 255)
+typedef uint16_t serial_rx_index_t;
+#else
+typedef uint8_t serial_rx_index_t;
+#endif
+#if (TX_BUFFER_SIZE > 255)
+typedef uint16_t serial_tx_index_t;
+#else
+typedef uint8_t serial_tx_index_t;
+#endif
+//power of two buffers wrap with a mask
+#if ((RX_BUFFER_SIZE & (RX_BUFFER_SIZE - 1)) == 0)
+#define SERIAL_RX_NEXT(index) (((index) + 1) & (RX_BUFFER_SIZE - 1))
+#else
+#define SERIAL_RX_NEXT(index) (((index) == (RX_BUFFER_SIZE - 1)) ? 0 : ((index) + 1))
+#endif
+#if ((TX_BUFFER_SIZE & (TX_BUFFER_SIZE - 1)) == 0)
+#define SERIAL_TX_NEXT(index) (((index) + 1) & (TX_BUFFER_SIZE - 1))
+#else
+#define SERIAL_TX_NEXT(index) (((index) == (TX_BUFFER_SIZE - 1)) ? 0 : ((index) + 1))
+#endif
+#if (defined(ENABLE_RTS_FLOW_CONTROL) && !defined(RTS))
+#error "RTS flow control needs the RTS pin to be defined in the board map"
+#endif
+
 static unsigned char serial_rx_buffer[RX_BUFFER_SIZE];
-static volatile uint8_t serial_rx_count;
-static uint8_t serial_rx_read;
-static volatile uint8_t serial_rx_write;
+static volatile serial_rx_index_t serial_rx_count;
+static volatile serial_rx_index_t serial_rx_read;
+static volatile serial_rx_index_t serial_rx_write;
+//the line that didn't fit in the buffer is discarded until the line terminator
+static bool serial_rx_overflow;
+//discarded lines that weren't answered yet (each is answered with an overflow line when there is room)
+static uint8_t serial_rx_dropped;
+#if (defined(ENABLE_XONXOFF_FLOW_CONTROL) || defined(ENABLE_RTS_FLOW_CONTROL))
+static bool serial_rx_stopped;
+#endif
+#ifdef ENABLE_BINARY_PROTOCOL
+#define SERIAL_FRAME_OFF 0
+#define SERIAL_FRAME_IDLE 1
+#define SERIAL_FRAME_LENGTH 2
+#define SERIAL_FRAME_PAYLOAD 3
+#define SERIAL_FRAME_CHECKSUM 4
+static uint8_t serial_rx_frame_state;
+static uint8_t serial_rx_frame_size;
+static uint8_t serial_rx_frame_checksum;
+static serial_rx_index_t serial_rx_frame_write;
+#endif
+#ifdef ENABLE_STREAM_COMPRESSION
+#define SERIAL_Z_OFF 0
+#define SERIAL_Z_IDLE 1
+#define SERIAL_Z_MATCH 2
+#define SERIAL_Z_ESCAPE 3
+static uint8_t serial_rx_z_state;
+static uint8_t serial_rx_z_length;
+//window of the last 256 decoded chars
+static unsigned char serial_rx_z_window[256];
+static uint8_t serial_rx_z_write;
+//chars of the $Z line matched in the current line
+static uint8_t serial_rx_z_command;
+#endif
 
 static unsigned char serial_tx_buffer[TX_BUFFER_SIZE];
-static volatile uint8_t serial_tx_read;
-static uint8_t serial_tx_write;
-static volatile uint8_t serial_tx_count;
+static volatile serial_tx_index_t serial_tx_read;
+static serial_tx_index_t serial_tx_write;
+static volatile serial_tx_index_t serial_tx_count;
+
+#ifdef ENABLE_XONXOFF_FLOW_CONTROL
+//XON/XOFF char sent by the TX ISR ahead of the buffered responses
+static volatile unsigned char serial_tx_flow;
+#endif
+
+#ifdef ENABLE_BAUD_SWITCH
+//baud rate switched after the response is sent
+static uint32_t serial_baud;
+//ms left to receive a line at the new baud rate
+static uint16_t serial_baud_timeout;
+#endif
 
 static uint8_t serial_read_select;
 static uint16_t serial_read_index;
+//the line being parsed (contiguous copy of the next line of the RX buffer or startup block)
+#if (RX_BUFFER_SIZE > STARTUP_BLOCK_SIZE)
+static unsigned char serial_line[RX_BUFFER_SIZE];
+#else
+static unsigned char serial_line[STARTUP_BLOCK_SIZE];
+#endif
 
 //static void serial_rx_clear();
 
+#if (defined(ENABLE_XONXOFF_FLOW_CONTROL) || defined(ENABLE_RTS_FLOW_CONTROL))
+//signals the host to stop or resume sending
+static void serial_rx_flow_control(bool stop)
+{
+    serial_rx_stopped = stop;
+#ifdef ENABLE_XONXOFF_FLOW_CONTROL
+    //the char is sent by the TX ISR before the next buffered char (a pending char that wasn't sent yet is canceled)
+    serial_tx_flow = (serial_tx_flow) ? 0 : ((stop) ? XOFF : XON);
+    mcu_start_send();
+#endif
+#ifdef ENABLE_RTS_FLOW_CONTROL
+    if (stop)
+    {
+        mcu_set_output(RTS);
+    }
+    else
+    {
+        mcu_clear_output(RTS);
+    }
+#endif
+}
+#endif
+
 void serial_init(void)
 {
 #ifdef FORCE_GLOBALS_TO_0
     serial_rx_write = 0;
     serial_rx_read = 0;
     serial_rx_count = 0;
+    serial_rx_overflow = false;
+    serial_rx_dropped = 0;
+#ifdef ENABLE_BINARY_PROTOCOL
+    serial_rx_frame_state = SERIAL_FRAME_OFF;
+#endif
+#if (defined(ENABLE_XONXOFF_FLOW_CONTROL) || defined(ENABLE_RTS_FLOW_CONTROL))
+    serial_rx_stopped = false;
+#endif
 
     serial_tx_read = 0;
     serial_tx_write = 0;
@@ -71,13 +177,50 @@ bool serial_rx_is_empty(void)
     return true;
 }
 
+//free bytes in the buffer (the slot ahead of the write position is always free)
+static serial_rx_index_t serial_rx_free(void)
+{
+    serial_rx_index_t read = serial_rx_read;
+    serial_rx_index_t write = serial_rx_write;
+    return ((read > write) ? (read - write) : (RX_BUFFER_SIZE - write + read)) - 1;
+}
+
+//adds an overflow line (the overflow char and the line terminator) for each discarded line while there is room
+static void serial_rx_add_dropped(void)
+{
+    serial_rx_index_t write = serial_rx_write;
+    while (serial_rx_dropped && serial_rx_free() >= 2)
+    {
+        serial_rx_buffer[write] = OVF;
+        write = SERIAL_RX_NEXT(write);
+        serial_rx_buffer[write] = EOL;
+        write = SERIAL_RX_NEXT(write);
+        //writes the overflow char ahead
+        serial_rx_buffer[write] = OVF;
+        serial_rx_write = write;
+        serial_rx_count++;
+        serial_rx_dropped--;
+    }
+}
+
+//number of chars of a line (including the line terminator) that can be sent without overflowing the buffer
+uint16_t serial_get_rx_freebytes(void)
+{
+    serial_rx_index_t free = serial_rx_free();
+    return (free != 0) ? (free - 1) : 0;
+}
+
 bool serial_tx_is_empty(void)
 {
     return (!serial_tx_count && (serial_tx_write == serial_tx_read));
 }
 
-unsigned char serial_getc(void)
+//returns the next line (or binary frame) in a contiguous slice terminated by EOL and releases it from the RX buffer
+//if there is no complete line returns an empty line
+unsigned char *serial_get_line(void)
 {
+    serial_rx_index_t read = serial_rx_read;
+    serial_rx_index_t i = 0;
     unsigned char c;
 
     switch (serial_read_select)
@@ -85,57 +228,78 @@ unsigned char serial_getc(void)
     case SERIAL_UART:
         if (!serial_rx_count)
         {
-            return EOL;
+            break;
         }
 
-        c = serial_rx_buffer[serial_rx_read];
-        if (++serial_rx_read == RX_BUFFER_SIZE)
+#ifdef ENABLE_BINARY_PROTOCOL
+        //binary frames are copied with the frame start char, the payload length and the payload
+        //the payload of a frame with a bad checksum (or a bad length) is not copied
+        if (serial_rx_buffer[read] == STX)
         {
-            serial_rx_read = 0;
+            uint8_t size = 2;
+            read = SERIAL_RX_NEXT(read);
+            if (serial_rx_buffer[read] <= SERIAL_FRAME_SIZE)
+            {
+                size += serial_rx_buffer[read];
+            }
+            read = serial_rx_read;
+            do
+            {
+                serial_line[i++] = serial_rx_buffer[read];
+                read = SERIAL_RX_NEXT(read);
+            } while (i < size);
         }
-
-        switch (c)
+        else
+#endif
         {
-        case '\r':
-        case '\n':
-        case EOL:
-            serial_rx_count--;
-            return EOL;
-        case '\t':
-            return ' ';
+            //copies the line until the line terminator (the wrap around is only handled here)
+            do
+            {
+                c = serial_rx_buffer[read];
+                serial_line[i++] = c;
+                read = SERIAL_RX_NEXT(read);
+            } while (c != EOL);
         }
 
-        return c;
-        break;
-    case SERIAL_N0:
-    case SERIAL_N1:
-        c = mcu_eeprom_getc(serial_read_index++);
-        if (c)
+        //the line is released from the RX buffer
+        serial_rx_read = read;
+        serial_rx_count--;
+        //the discarded lines are answered as soon as there is room (the host may be waiting for their responses)
+        if (serial_rx_dropped)
         {
-            serial_putc(c);
+            mcu_disable_interrupts();
+            serial_rx_add_dropped();
+            mcu_enable_interrupts();
         }
-        else
+#if (defined(ENABLE_XONXOFF_FLOW_CONTROL) || defined(ENABLE_RTS_FLOW_CONTROL))
+        //the host resumes when the free space recovers (or if there is no complete line left to free it)
+        if (serial_rx_stopped && (!serial_rx_count || serial_rx_free() >= SERIAL_FLOW_CONTROL_RESUME))
         {
-            serial_putc(':');
-            serial_read_select = SERIAL_UART; // resets the serial select
+            mcu_disable_interrupts();
+            serial_rx_flow_control(false);
+            mcu_enable_interrupts();
         }
-        return c;
-    }
-
-    return EOL;
-}
-
-void serial_ungetc(void)
-{
-    if (--serial_rx_read == 0xFF)
-    {
-        serial_rx_read = RX_BUFFER_SIZE - 1;
+#endif
+        break;
+    case SERIAL_N0:
+    case SERIAL_N1:
+        //startup blocks are echoed
+        do
+        {
+            c = mcu_eeprom_getc(serial_read_index++);
+            serial_line[i++] = c;
+            if (c)
+            {
+                serial_putc(c);
+            }
+        } while (c && i < (STARTUP_BLOCK_SIZE - 1));
+        serial_putc(':');
+        serial_read_select = SERIAL_UART; // resets the serial select
+        break;
     }
 
-    if (serial_rx_buffer[serial_rx_read] == EOL)
-    {
-        serial_rx_count++; //recoverd command
-    }
+    serial_line[i] = EOL;
+    return serial_line;
 }
 
 void serial_select(uint8_t source)
@@ -154,31 +318,17 @@ void serial_select(uint8_t source)
     }
 }
 
-unsigned char serial_peek(void)
+uint8_t serial_get_select(void)
 {
-    unsigned char c;
-    switch (serial_read_select)
-    {
-    case SERIAL_UART:
-        c = serial_rx_buffer[serial_rx_read];
-        switch (c)
-        {
-        case '\r':
-        case '\n':
-        case EOL:
-            return EOL;
-        case '\t':
-            return ' ';
-        default:
-            return c;
-        }
-        break;
-    case SERIAL_N0:
-    case SERIAL_N1:
-        return mcu_eeprom_getc(serial_read_index);
-    }
-    return EOL;
+    return serial_read_select;
+}
+
+#ifdef ENABLE_BINARY_PROTOCOL
+void serial_enable_binary(void)
+{
+    serial_rx_frame_state = SERIAL_FRAME_IDLE;
 }
+#endif
 
 void serial_inject_cmd(const unsigned char *__s)
 {
@@ -205,17 +355,12 @@ void serial_putc(unsigned char c)
     } //while buffer is full
 
     serial_tx_buffer[serial_tx_write] = c;
-    serial_tx_write++;
+    serial_tx_write = SERIAL_TX_NEXT(serial_tx_write);
     if (c == '\n' || c == '\r')
     {
         serial_tx_count++;
         mcu_start_send();
     }
-
-    if (serial_tx_write == TX_BUFFER_SIZE)
-    {
-        serial_tx_write = 0;
-    }
 #endif
 }
 
@@ -255,7 +400,7 @@ void serial_print_int(uint16_t num)
         serial_putc('0' + buffer[i]);
     } while (i);
 }
-#ifdef GCODE_PROCESS_LINE_NUMBERS
+#if (defined(GCODE_PROCESS_LINE_NUMBERS) || defined(ENABLE_LINE_CHECKSUM))
 void serial_print_long(uint32_t num)
 {
     if (num == 0)
@@ -386,11 +531,89 @@ void serial_flush(void)
 }
 
 //ISR
-//New char handle strategy
-//All ascii will be sent to buffer and processed later (including comments)
-void serial_rx_isr(unsigned char c)
+#ifdef ENABLE_BINARY_PROTOCOL
+//binary frames are sent as the frame start char, the payload length, the payload and the checksum (xor of the length and payload)
+//and are stored as the frame start char, the payload length and the payload
+static void serial_rx_frame_isr(unsigned char c)
+{
+    serial_rx_index_t write = serial_rx_frame_write;
+    switch (serial_rx_frame_state)
+    {
+    case SERIAL_FRAME_LENGTH:
+        serial_rx_frame_size = c;
+        serial_rx_frame_checksum = c;
+        serial_rx_frame_state = SERIAL_FRAME_PAYLOAD;
+        //the frame is discarded if it doesn't fit in the buffer (as an overflowed line)
+        //the discarded lines are answered first
+        serial_rx_add_dropped();
+        if (serial_rx_overflow || serial_rx_dropped || c > SERIAL_FRAME_SIZE || serial_rx_free() < (c + 2))
+        {
+            serial_rx_overflow = true;
+            return;
+        }
+
+        write = serial_rx_write;
+        serial_rx_buffer[write] = STX;
+        write = SERIAL_RX_NEXT(write);
+        serial_rx_buffer[write] = c;
+        write = SERIAL_RX_NEXT(write);
+        serial_rx_frame_write = write;
+        return;
+    case SERIAL_FRAME_PAYLOAD:
+        serial_rx_frame_checksum ^= c;
+        if (!--serial_rx_frame_size)
+        {
+            serial_rx_frame_state = SERIAL_FRAME_CHECKSUM;
+        }
+
+        if (!serial_rx_overflow)
+        {
+            serial_rx_buffer[write] = c;
+            write = SERIAL_RX_NEXT(write);
+            serial_rx_frame_write = write;
+        }
+        return;
+    }
+
+    //checksum
+    serial_rx_frame_state = SERIAL_FRAME_IDLE;
+    if (serial_rx_overflow)
+    {
+        //the discarded frame is answered with an overflow line (when there is room)
+        serial_rx_overflow = false;
+        serial_rx_dropped++;
+        serial_rx_add_dropped();
+        return;
+    }
+
+    if (serial_rx_frame_checksum != c)
+    {
+        //the frame is kept without payload to be answered with an error
+        write = serial_rx_write;
+        write = SERIAL_RX_NEXT(write);
+        serial_rx_buffer[write] = SERIAL_FRAME_INVALID;
+        write = SERIAL_RX_NEXT(write);
+    }
+
+    serial_rx_count++;
+    //writes the overflow char ahead
+    serial_rx_buffer[write] = OVF;
+    serial_rx_write = write;
+#if (defined(ENABLE_XONXOFF_FLOW_CONTROL) || defined(ENABLE_RTS_FLOW_CONTROL))
+    if (!serial_rx_stopped && serial_rx_free() < SERIAL_FLOW_CONTROL_STOP)
+    {
+        serial_rx_flow_control(true);
+    }
+#endif
+}
+#endif
+
+//stores the ascii chars in the RX buffer and executes the realtime commands
+static void serial_rx_char(unsigned char c)
 {
-    uint8_t write;
+    serial_rx_index_t write;
+    serial_rx_index_t free;
+
     if (c < ((unsigned char)'~')) //ascii (except CMD_CODE_CYCLE_START and DEL)
     {
         switch (c)
@@ -401,21 +624,77 @@ void serial_rx_isr(unsigned char c)
         case CMD_CODE_REPORT:
             cnc_call_rt_command((uint8_t)c);
             return;
+#ifdef ENABLE_XONXOFF_FLOW_CONTROL
+        case XON:
+        case XOFF:
+            return;
+#endif
         case '\r':
         case '\n':
             c = EOL; //replaces CR and LF with EOL and continues
-        case EOL:
-            serial_rx_count++; //continues
         default:
+#ifndef ENABLE_LINE_CHECKSUM
+            if (c == '\t')
+            {
+                c = ' '; //replaces tab with a white space
+            }
+#endif
+#ifdef ENABLE_STREAM_COMPRESSION
+            //the $Z line starts the compressed stream (the char after the line terminator is already compressed)
+            if (serial_rx_z_state == SERIAL_Z_OFF)
+            {
+                if (c == EOL)
+                {
+                    if (serial_rx_z_command == 2)
+                    {
+                        serial_rx_z_state = SERIAL_Z_IDLE;
+                        serial_rx_z_write = 0;
+                    }
+                    serial_rx_z_command = 0;
+                }
+                else
+                {
+                    serial_rx_z_command = ((serial_rx_z_command == 0 && c == '$') ? 1 : ((serial_rx_z_command == 1 && c == 'Z') ? 2 : 3));
+                }
+            }
+#endif
+            //the discarded lines are answered first (in order)
+            serial_rx_add_dropped();
             write = serial_rx_write;
-            serial_rx_buffer[write] = c;
-            if (++write == RX_BUFFER_SIZE)
+            //a char is only added if there is room for the overflow char and the line terminator
+            //the line terminator is only added if there is room for it
+            free = serial_rx_free();
+            if (serial_rx_overflow || serial_rx_dropped || free < ((c == EOL) ? 1 : 3))
+            {
+                //the line is discarded until the line terminator and is answered with an overflow line (the chars already stored followed by an overflow char and the line terminator)
+                //while there is no room for it the next lines are discarded too and are answered in order when there is room
+                serial_rx_overflow = (c != EOL);
+                if (c == EOL)
+                {
+                    serial_rx_dropped++;
+                    serial_rx_add_dropped();
+                }
+                return;
+            }
+
+            if (c == EOL)
             {
-                write = 0;
+                serial_rx_count++;
             }
+
+            serial_rx_buffer[write] = c;
+            write = SERIAL_RX_NEXT(write);
             //writes the overflow char ahead
             serial_rx_buffer[write] = OVF;
             serial_rx_write = write;
+#if (defined(ENABLE_XONXOFF_FLOW_CONTROL) || defined(ENABLE_RTS_FLOW_CONTROL))
+            //the host is stopped only if there is a complete line to free the buffer
+            //(a line that doesn't fit is discarded as an overflow)
+            if (!serial_rx_stopped && serial_rx_count && serial_rx_free() < SERIAL_FLOW_CONTROL_STOP)
+            {
+                serial_rx_flow_control(true);
+            }
+#endif
             break;
         }
     }
@@ -425,14 +704,137 @@ void serial_rx_isr(unsigned char c)
     }
 }
 
+#ifdef ENABLE_STREAM_COMPRESSION
+//compressed stream (see config.h)
+//each decoded char is added to the window and passed to the ascii chars handling
+static void serial_rx_z_isr(unsigned char c)
+{
+    uint8_t read;
+    switch (serial_rx_z_state)
+    {
+    case SERIAL_Z_MATCH:
+        //the match is copied from the window (c is the distance)
+        //the copy stops if the decoder is turned off (serial_rx_clear)
+        serial_rx_z_state = SERIAL_Z_IDLE;
+        read = serial_rx_z_write - c;
+        if (serial_rx_z_length > STREAM_COMPRESSION_MAX_MATCH)
+        {
+            //a longer match only keeps the window in sync with the host and discards the lines it touches
+            //only the line terminators are handled (each discarded line is answered with an overflow error)
+            for (uint8_t i = serial_rx_z_length; i != 0; i--)
+            {
+                c = serial_rx_z_window[read++];
+                serial_rx_z_window[serial_rx_z_write++] = c;
+                serial_rx_overflow = true;
+                if (c == '\n' || c == '\r')
+                {
+                    serial_rx_char(c);
+                }
+            }
+            return;
+        }
+
+        for (uint8_t i = serial_rx_z_length; i != 0 && serial_rx_z_state == SERIAL_Z_IDLE; i--)
+        {
+            c = serial_rx_z_window[read++];
+            serial_rx_z_window[serial_rx_z_write++] = c;
+            //the realtime commands in the window were already executed
+            if (c < ((unsigned char)'~') && c != CMD_CODE_RESET && c != CMD_CODE_FEED_HOLD && c != CMD_CODE_REPORT)
+            {
+                serial_rx_char(c);
+            }
+        }
+        return;
+    case SERIAL_Z_ESCAPE:
+        //an escaped EOL returns to the ascii G-code
+        if (c == EOL)
+        {
+            serial_rx_z_state = SERIAL_Z_OFF;
+            return;
+        }
+        serial_rx_z_state = SERIAL_Z_IDLE;
+        break;
+    default:
+        if (c & 0x80)
+        {
+            serial_rx_z_length = (c & 0x7F);
+            serial_rx_z_state = (serial_rx_z_length) ? SERIAL_Z_MATCH : SERIAL_Z_ESCAPE;
+            return;
+        }
+        break;
+    }
+
+    serial_rx_z_window[serial_rx_z_write++] = c;
+    serial_rx_char(c);
+}
+#endif
+
+//New char handle strategy
+//All ascii will be sent to buffer and processed later (including comments)
+void serial_rx_isr(unsigned char c)
+{
+#ifdef ENABLE_STREAM_COMPRESSION
+    if (serial_rx_z_state != SERIAL_Z_OFF)
+    {
+        serial_rx_z_isr(c);
+        return;
+    }
+#endif
+#ifdef ENABLE_BINARY_PROTOCOL
+    switch (serial_rx_frame_state)
+    {
+    case SERIAL_FRAME_OFF:
+        break;
+    case SERIAL_FRAME_IDLE:
+        //between frames only the frame start and the realtime commands are accepted
+        if (c == STX)
+        {
+            serial_rx_frame_state = SERIAL_FRAME_LENGTH;
+            return;
+        }
+
+        if (c < ((unsigned char)'~') && c != CMD_CODE_RESET && c != CMD_CODE_FEED_HOLD && c != CMD_CODE_REPORT)
+        {
+            return;
+        }
+        break;
+    case SERIAL_FRAME_LENGTH:
+        if (!c)
+        {
+            //an empty frame returns to the ASCII G-code (and is answered as an empty line)
+            serial_rx_frame_state = SERIAL_FRAME_OFF;
+            c = '\n';
+            break;
+        }
+    default:
+        serial_rx_frame_isr(c);
+        return;
+    }
+#endif
+
+    serial_rx_char(c);
+}
+
 void serial_tx_isr(void)
 {
 #ifndef ENABLE_SYNC_TX
+#ifdef ENABLE_XONXOFF_FLOW_CONTROL
+    if (serial_tx_flow)
+    {
+        mcu_putc(serial_tx_flow);
+        serial_tx_flow = 0;
+        if (!serial_tx_count)
+        {
+            mcu_stop_send();
+        }
+        return;
+    }
+#endif
     if (!serial_tx_count)
     {
         return;
     }
-    uint8_t read = serial_tx_read;
+    serial_tx_index_t read = serial_tx_read;
     unsigned char c = serial_tx_buffer[read];
     mcu_putc(c);
     if (c == '\n' || c == '\r')
@@ -442,20 +844,86 @@ void serial_tx_isr(void)
             mcu_stop_send();
         }
     }
-    if (++read == TX_BUFFER_SIZE)
-    {
-        read = 0;
-    }
+    read = SERIAL_TX_NEXT(read);
     serial_tx_read = read;
 #endif
 }
 
+#ifdef ENABLE_BAUD_SWITCH
+//checks if the mcu can generate the baud rate (with less than 2.5% error) and switches to it after the response is sent
+bool serial_set_baudrate(uint32_t baud)
+{
+    if (baud < 1200)
+    {
+        return false;
+    }
+
+    uint32_t actual = mcu_get_baudrate(baud);
+    uint32_t error = (actual > baud) ? (actual - baud) : (baud - actual);
+    if (!actual || error > (baud / 40))
+    {
+        return false;
+    }
+
+    serial_baud = baud;
+    return true;
+}
+
+//switches the baud rate and waits for a line from the host at the new baud rate
+//the wait doesn't block the main loop (each pass waits 1ms) and if the host doesn't send a valid line in time the baud rate returns to the default
+void serial_switch_baudrate(void)
+{
+    if (serial_baud_timeout)
+    {
+        mcu_delay_ms(1);
+        if (!--serial_baud_timeout)
+        {
+            mcu_set_baudrate(BAUD);
+            //discards the chars received at the wrong baud rate
+            serial_rx_clear();
+        }
+        return;
+    }
+
+    //the lines received before the switch are executed first
+    if (!serial_baud || !serial_tx_is_empty() || serial_rx_count)
+    {
+        return;
+    }
+
+    mcu_set_baudrate(serial_baud);
+    serial_baud = 0;
+    serial_baud_timeout = BAUD_SWITCH_TIMEOUT;
+}
+
+//a line from the host was executed without errors at the new baud rate (the chars received at the wrong baud rate can still form a line)
+void serial_confirm_baudrate(void)
+{
+    serial_baud_timeout = 0;
+}
+#endif
+
 void serial_rx_clear(void)
 {
     serial_rx_write = 0;
     serial_rx_read = 0;
     serial_rx_count = 0;
+    serial_rx_overflow = false;
+    serial_rx_dropped = 0;
+#ifdef ENABLE_BINARY_PROTOCOL
+    serial_rx_frame_state = SERIAL_FRAME_OFF;
+#endif
+#ifdef ENABLE_STREAM_COMPRESSION
+    serial_rx_z_state = SERIAL_Z_OFF;
+    serial_rx_z_command = 0;
+#endif
     serial_rx_buffer[0] = EOL;
+#if (defined(ENABLE_XONXOFF_FLOW_CONTROL) || defined(ENABLE_RTS_FLOW_CONTROL))
+    if (serial_rx_stopped)
+    {
+        serial_rx_flow_control(false);
+    }
+#endif
     /*serial_tx_write = 0;
     serial_tx_read = 0;
     serial_tx_count = 0;*/
@@ -21,12 +21,48 @@
 
 #define EOL 0x00		   //end of line char
 #define OVF 0x7F		   //overflow char
+#define STX 0x02		   //binary frame start char
+#define XON 0x11		   //software flow control resume char
+#define XOFF 0x13		   //software flow control stop char
 #define SAFEMARGIN 2
-#define RX_BUFFER_SIZE 128 + SAFEMARGIN//buffer sizes
+//buffer sizes (can be set by the mcu or in the config file)
+#ifndef RX_BUFFER_SIZE
+#define RX_BUFFER_SIZE (128 + SAFEMARGIN)
+#endif
 #ifdef ENABLE_SYNC_TX
+#undef TX_BUFFER_SIZE
 #define TX_BUFFER_SIZE 1
-#else
-#define TX_BUFFER_SIZE 112 + SAFEMARGIN//buffer sizes
+#elif !defined(TX_BUFFER_SIZE)
+#define TX_BUFFER_SIZE (112 + SAFEMARGIN)
+#endif
+
+//flow control watermarks (RX buffer free chars that stop and resume the host)
+//the stop watermark holds the chars the host still sends after it's stopped
+//(the host UART FIFO, the chars sent during the host latency and the XOFF char and the char being sent before it)
+#ifndef SERIAL_FLOW_CONTROL_HOST_FIFO
+#define SERIAL_FLOW_CONTROL_HOST_FIFO 16
+#endif
+#ifndef SERIAL_FLOW_CONTROL_HOST_LATENCY
+#define SERIAL_FLOW_CONTROL_HOST_LATENCY 1
+#endif
+#ifndef SERIAL_FLOW_CONTROL_STOP
+#define SERIAL_FLOW_CONTROL_STOP (SERIAL_FLOW_CONTROL_HOST_FIFO + ((BAUD / 10) * SERIAL_FLOW_CONTROL_HOST_LATENCY) / 1000 + 2 + SAFEMARGIN)
+#endif
+#ifndef SERIAL_FLOW_CONTROL_RESUME
+#define SERIAL_FLOW_CONTROL_RESUME (SERIAL_FLOW_CONTROL_STOP + (RX_BUFFER_SIZE - SERIAL_FLOW_CONTROL_STOP) / 2)
+#endif
+#if (defined(ENABLE_XONXOFF_FLOW_CONTROL) || defined(ENABLE_RTS_FLOW_CONTROL))
+#if (SERIAL_FLOW_CONTROL_RESUME >= RX_BUFFER_SIZE)
+#error The RX buffer is too small for the flow control stop margin
+#endif
+#if (defined(ENABLE_XONXOFF_FLOW_CONTROL) && defined(ENABLE_SYNC_TX))
+#error XON/XOFF flow control needs the async TX (the XOFF char is sent ahead of the buffered responses)
+#endif
+#endif
+
+#ifdef ENABLE_BINARY_PROTOCOL
+#define SERIAL_FRAME_SIZE 48		//max binary frame payload
+#define SERIAL_FRAME_INVALID 0xFF //length stored for a frame with a bad checksum
 #endif
 
 #define SERIAL_UART 0
@@ -40,19 +76,27 @@
 void serial_init();
 
 bool serial_rx_is_empty(void);
-unsigned char serial_getc(void);
-void serial_ungetc(void);
-unsigned char serial_peek(void);
+uint16_t serial_get_rx_freebytes(void);
+unsigned char *serial_get_line(void);
 void serial_inject_cmd(const unsigned char *__s);
 void serial_restore_line(void);
 void serial_rx_clear(void);
+#ifdef ENABLE_BAUD_SWITCH
+bool serial_set_baudrate(uint32_t baud);
+void serial_switch_baudrate(void);
+void serial_confirm_baudrate(void);
+#endif
 void serial_select(uint8_t source);
+uint8_t serial_get_select(void);
+#ifdef ENABLE_BINARY_PROTOCOL
+void serial_enable_binary(void);
+#endif
 
 bool serial_tx_is_empty(void);
 void serial_putc(unsigned char c);
 void serial_print_str(const unsigned char *__s);
 void serial_print_int(uint16_t num);
-#ifdef GCODE_PROCESS_LINE_NUMBERS
+#if (defined(GCODE_PROCESS_LINE_NUMBERS) || defined(ENABLE_LINE_CHECKSUM))
 void serial_print_long(uint32_t num);
 #endif
 void serial_print_flt(float num);
@@ -28,7 +28,7 @@
 #include "cnc.h"
 
 //if settings struct is changed this version has to change too
-#define SETTINGS_VERSION "V02"
+#define SETTINGS_VERSION "V04"
 
 settings_t g_settings;
 
@@ -126,6 +126,10 @@ const settings_t __rom__ default_settings =
 #ifdef ENABLE_BACKLASH_COMPENSATION
         .backlash_steps[0] = 0,
 #endif
+#ifdef ENABLE_INPUT_SHAPING
+        .shaper_frequency[0] = DEFAULT_SHAPER_FREQ,
+        .shaper_damping[0] = DEFAULT_SHAPER_DAMPING,
+#endif
 #endif
 #if STEPPER_COUNT > 1
         .step_per_mm[1] = DEFAULT_1_STEP_PER_MM,
@@ -134,6 +138,10 @@ const settings_t __rom__ default_settings =
 #ifdef ENABLE_BACKLASH_COMPENSATION
         .backlash_steps[1] = 0,
 #endif
+#ifdef ENABLE_INPUT_SHAPING
+        .shaper_frequency[1] = DEFAULT_SHAPER_FREQ,
+        .shaper_damping[1] = DEFAULT_SHAPER_DAMPING,
+#endif
 #endif
 #if STEPPER_COUNT > 2
         .step_per_mm[2] = DEFAULT_2_STEP_PER_MM,
@@ -142,6 +150,10 @@ const settings_t __rom__ default_settings =
 #ifdef ENABLE_BACKLASH_COMPENSATION
         .backlash_steps[2] = 0,
 #endif
+#ifdef ENABLE_INPUT_SHAPING
+        .shaper_frequency[2] = DEFAULT_SHAPER_FREQ,
+        .shaper_damping[2] = DEFAULT_SHAPER_DAMPING,
+#endif
 #endif
 #if STEPPER_COUNT > 3
         .step_per_mm[3] = DEFAULT_3_STEP_PER_MM,
@@ -150,6 +162,10 @@ const settings_t __rom__ default_settings =
 #ifdef ENABLE_BACKLASH_COMPENSATION
         .backlash_steps[3] = 0,
 #endif
+#ifdef ENABLE_INPUT_SHAPING
+        .shaper_frequency[3] = DEFAULT_SHAPER_FREQ,
+        .shaper_damping[3] = DEFAULT_SHAPER_DAMPING,
+#endif
 #endif
 #if STEPPER_COUNT > 4
         .step_per_mm[4] = DEFAULT_4_STEP_PER_MM,
@@ -158,6 +174,10 @@ const settings_t __rom__ default_settings =
 #ifdef ENABLE_BACKLASH_COMPENSATION
         .backlash_steps[4] = 0,
 #endif
+#ifdef ENABLE_INPUT_SHAPING
+        .shaper_frequency[4] = DEFAULT_SHAPER_FREQ,
+        .shaper_damping[4] = DEFAULT_SHAPER_DAMPING,
+#endif
 #endif
 #if STEPPER_COUNT > 5
         .step_per_mm[5] = DEFAULT_5_STEP_PER_MM,
@@ -166,10 +186,31 @@ const settings_t __rom__ default_settings =
 #ifdef ENABLE_BACKLASH_COMPENSATION
         .backlash_steps[5] = 0,
 #endif
+#ifdef ENABLE_INPUT_SHAPING
+        .shaper_frequency[5] = DEFAULT_SHAPER_FREQ,
+        .shaper_damping[5] = DEFAULT_SHAPER_DAMPING,
+#endif
+#endif
+#ifdef USE_SPINDLE
+        .spindle_acceleration = DEFAULT_SPINDLE_ACCELERATION,
 #endif
 #ifdef LASER_MODE
         .laser_mode = 0,
 #endif
+#ifdef ENABLE_EXTRUDER
+        .extruder_advance = DEFAULT_EXTRUDER_ADVANCE,
+#endif
+#ifdef ENABLE_THC
+        .thc_setpoint = DEFAULT_THC_SETPOINT,
+        .thc_gain = DEFAULT_THC_GAIN,
+#endif
+#ifdef ENABLE_ADAPTIVE_FEED
+        .adaptive_feed_load = DEFAULT_ADAPTIVE_FEED_LOAD,
+#endif
+        .accel_factor[MOTIONCONTROL_MODE_ACCEL_FEED >> MOTIONCONTROL_MODE_ACCEL_SHIFT] = DEFAULT_FEED_ACCEL_FACTOR,
+        .accel_factor[MOTIONCONTROL_MODE_ACCEL_RAPID >> MOTIONCONTROL_MODE_ACCEL_SHIFT] = DEFAULT_RAPID_ACCEL_FACTOR,
+        .accel_factor[MOTIONCONTROL_MODE_ACCEL_JOG >> MOTIONCONTROL_MODE_ACCEL_SHIFT] = DEFAULT_JOG_ACCEL_FACTOR,
+        .accel_factor[MOTIONCONTROL_MODE_ACCEL_HOMING >> MOTIONCONTROL_MODE_ACCEL_SHIFT] = DEFAULT_HOMING_ACCEL_FACTOR,
         .step_enable_invert = DEFAULT_STEP_ENA_INV,
         .step_invert_mask = DEFAULT_STEP_INV_MASK,
         .dir_invert_mask = DEFAULT_DIR_INV_MASK,
@@ -178,6 +219,8 @@ const settings_t __rom__ default_settings =
         .homing_fast_feed_rate = DEFAULT_HOMING_FAST,
         .homing_slow_feed_rate = DEFAULT_HOMING_SLOW,
         .homing_offset = DEFAULT_HOMING_OFFSET,
+        .probe_slow_feed_rate = DEFAULT_PROBE_SLOW,
+        .probe_retract = DEFAULT_PROBE_RETRACT,
         .arc_tolerance = DEFAULT_ARC_TOLERANCE,
         .tool_count = DEFAULT_TOOL_COUNT,
         .limits_invert_mask = DEFAULT_LIMIT_INV_MASK,
@@ -360,6 +403,12 @@ uint8_t settings_change(uint8_t setting, float value)
     case 27:
         g_settings.homing_offset = value;
         break;
+    case 28:
+        g_settings.probe_slow_feed_rate = value;
+        break;
+    case 29:
+        g_settings.probe_retract = value;
+        break;
     case 30:
         g_settings.spindle_max_rpm = value;
         break;
@@ -371,6 +420,24 @@ uint8_t settings_change(uint8_t setting, float value)
         g_settings.laser_mode = value8;
         break;
 #endif
+#ifdef ENABLE_EXTRUDER
+    case 33:
+        g_settings.extruder_advance = value;
+        break;
+#endif
+#ifdef ENABLE_THC
+    case 34:
+        g_settings.thc_setpoint = value;
+        break;
+    case 35:
+        g_settings.thc_gain = value;
+        break;
+#endif
+#ifdef ENABLE_ADAPTIVE_FEED
+    case 36:
+        g_settings.adaptive_feed_load = value;
+        break;
+#endif
 #ifdef ENABLE_SKEW_COMPENSATION
     case 37:
         g_settings.skew_xy_factor = value;
@@ -383,6 +450,21 @@ uint8_t settings_change(uint8_t setting, float value)
         g_settings.skew_yz_factor = value;
         break;
 #endif
+#endif
+    case 40:
+    case 41:
+    case 42:
+    case 43:
+        if (value == 0)
+        {
+            return STATUS_INVALID_STATEMENT;
+        }
+        g_settings.accel_factor[setting - 40] = value;
+        break;
+#ifdef USE_SPINDLE
+    case 44:
+        g_settings.spindle_acceleration = value;
+        break;
 #endif
 #if (AXIS_COUNT > 0)
     case 130:
@@ -429,6 +511,22 @@ uint8_t settings_change(uint8_t setting, float value)
         g_settings.backlash_steps[0] = value;
         break;
 #endif
+#ifdef ENABLE_INPUT_SHAPING
+    case 150:
+        if (value < 0)
+        {
+            return STATUS_INVALID_STATEMENT;
+        }
+        g_settings.shaper_frequency[0] = value;
+        break;
+    case 160:
+        if (value < 0 || value >= 1)
+        {
+            return STATUS_INVALID_STATEMENT;
+        }
+        g_settings.shaper_damping[0] = value;
+        break;
+#endif
 #endif
 #if (STEPPER_COUNT > 1)
     case 101:
@@ -445,6 +543,22 @@ uint8_t settings_change(uint8_t setting, float value)
         g_settings.backlash_steps[1] = value;
         break;
 #endif
+#ifdef ENABLE_INPUT_SHAPING
+    case 151:
+        if (value < 0)
+        {
+            return STATUS_INVALID_STATEMENT;
+        }
+        g_settings.shaper_frequency[1] = value;
+        break;
+    case 161:
+        if (value < 0 || value >= 1)
+        {
+            return STATUS_INVALID_STATEMENT;
+        }
+        g_settings.shaper_damping[1] = value;
+        break;
+#endif
 #endif
 #if (STEPPER_COUNT > 2)
     case 102:
@@ -461,6 +575,22 @@ uint8_t settings_change(uint8_t setting, float value)
         g_settings.backlash_steps[2] = value;
         break;
 #endif
+#ifdef ENABLE_INPUT_SHAPING
+    case 152:
+        if (value < 0)
+        {
+            return STATUS_INVALID_STATEMENT;
+        }
+        g_settings.shaper_frequency[2] = value;
+        break;
+    case 162:
+        if (value < 0 || value >= 1)
+        {
+            return STATUS_INVALID_STATEMENT;
+        }
+        g_settings.shaper_damping[2] = value;
+        break;
+#endif
 #endif
 #if (STEPPER_COUNT > 3)
     case 103:
@@ -477,6 +607,22 @@ uint8_t settings_change(uint8_t setting, float value)
         g_settings.backlash_steps[3] = value;
         break;
 #endif
+#ifdef ENABLE_INPUT_SHAPING
+    case 153:
+        if (value < 0)
+        {
+            return STATUS_INVALID_STATEMENT;
+        }
+        g_settings.shaper_frequency[3] = value;
+        break;
+    case 163:
+        if (value < 0 || value >= 1)
+        {
+            return STATUS_INVALID_STATEMENT;
+        }
+        g_settings.shaper_damping[3] = value;
+        break;
+#endif
 #endif
 #if (STEPPER_COUNT > 4)
     case 104:
@@ -493,6 +639,22 @@ uint8_t settings_change(uint8_t setting, float value)
         g_settings.backlash_steps[4] = value;
         break;
 #endif
+#ifdef ENABLE_INPUT_SHAPING
+    case 154:
+        if (value < 0)
+        {
+            return STATUS_INVALID_STATEMENT;
+        }
+        g_settings.shaper_frequency[4] = value;
+        break;
+    case 164:
+        if (value < 0 || value >= 1)
+        {
+            return STATUS_INVALID_STATEMENT;
+        }
+        g_settings.shaper_damping[4] = value;
+        break;
+#endif
 #endif
 #if (STEPPER_COUNT > 5)
     case 105:
@@ -509,6 +671,22 @@ uint8_t settings_change(uint8_t setting, float value)
         g_settings.backlash_steps[5] = value;
         break;
 #endif
+#ifdef ENABLE_INPUT_SHAPING
+    case 155:
+        if (value < 0)
+        {
+            return STATUS_INVALID_STATEMENT;
+        }
+        g_settings.shaper_frequency[5] = value;
+        break;
+    case 165:
+        if (value < 0 || value >= 1)
+        {
+            return STATUS_INVALID_STATEMENT;
+        }
+        g_settings.shaper_damping[5] = value;
+        break;
+#endif
 #endif
     default:
         return STATUS_INVALID_STATEMENT;
@@ -547,7 +725,7 @@ void settings_erase(uint16_t address, uint8_t size)
 
 bool settings_check_startup_gcode(uint16_t address)
 {
-    uint8_t size = (RX_BUFFER_SIZE - 1); //defined in serial.h
+    uint8_t size = (STARTUP_BLOCK_SIZE - 1);
     uint8_t crc = 0;
     unsigned char c;
     uint16_t cmd_address = address;
@@ -576,14 +754,14 @@ bool settings_check_startup_gcode(uint16_t address)
     return true;
 }
 
-void settings_save_startup_gcode(uint16_t address)
+void settings_save_startup_gcode(uint16_t address, unsigned char *line)
 {
-    uint8_t size = (RX_BUFFER_SIZE - 1);
+    uint8_t size = (STARTUP_BLOCK_SIZE - 1);
     uint8_t crc = 0;
     unsigned char c;
     do
     {
-        c = serial_getc();
+        c = *line++;
         crc = crc7(c, crc);
         mcu_eeprom_putc(address++, (uint8_t)c);
         size--;
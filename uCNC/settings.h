@@ -23,6 +23,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "config.h"
+#include "motion_control.h"
 
 typedef struct
 {
@@ -47,17 +48,27 @@ typedef struct
     float homing_slow_feed_rate;
     //debouncing not used
     float homing_offset;
+    float probe_slow_feed_rate;
+    float probe_retract;
     float spindle_max_rpm;
     float spindle_min_rpm;
+#ifdef USE_SPINDLE
+    float spindle_acceleration;
+#endif
 
     float step_per_mm[STEPPER_COUNT];
     float max_feed_rate[STEPPER_COUNT];
     float acceleration[STEPPER_COUNT];
+    float accel_factor[MOTIONCONTROL_ACCEL_CLASSES];
     float max_distance[AXIS_COUNT];
     uint8_t tool_count;
 #ifdef ENABLE_BACKLASH_COMPENSATION
     uint16_t backlash_steps[STEPPER_COUNT];
 #endif
+#ifdef ENABLE_INPUT_SHAPING
+    float shaper_frequency[STEPPER_COUNT];
+    float shaper_damping[STEPPER_COUNT];
+#endif
 #ifdef ENABLE_SKEW_COMPENSATION
     float skew_xy_factor;
 #ifndef SKEW_COMPENSATION_XY_ONLY
@@ -68,12 +79,25 @@ typedef struct
 #ifdef LASER_MODE
     uint8_t laser_mode;
 #endif
+#ifdef ENABLE_EXTRUDER
+    float extruder_advance;
+#endif
+#ifdef ENABLE_THC
+    float thc_setpoint;
+    float thc_gain;
+#endif
+#ifdef ENABLE_ADAPTIVE_FEED
+    float adaptive_feed_load;
+#endif
 } settings_t;
 
+//startup blocks storage size (block chars, line terminator and crc)
+#define STARTUP_BLOCK_SIZE 130
 #define SETTINGS_ADDRESS_OFFSET 0
 #define SETTINGS_PARSER_PARAMETERS_ADDRESS_OFFSET (SETTINGS_ADDRESS_OFFSET + sizeof(settings_t) + 1)
 #define STARTUP_BLOCK0_ADDRESS_OFFSET (SETTINGS_PARSER_PARAMETERS_ADDRESS_OFFSET + (((AXIS_COUNT * sizeof(float)) + 1) * (COORD_SYS_COUNT + 3)))
-#define STARTUP_BLOCK1_ADDRESS_OFFSET (STARTUP_BLOCK0_ADDRESS_OFFSET + RX_BUFFER_SIZE)
+#define STARTUP_BLOCK1_ADDRESS_OFFSET (STARTUP_BLOCK0_ADDRESS_OFFSET + STARTUP_BLOCK_SIZE)
+#define MESH_ADDRESS_OFFSET (STARTUP_BLOCK1_ADDRESS_OFFSET + STARTUP_BLOCK_SIZE)
 
 extern settings_t g_settings;
 
@@ -85,6 +109,6 @@ void settings_reset(void);
 uint8_t settings_change(uint8_t setting, float value);
 void settings_erase(uint16_t address, uint8_t size);
 bool settings_check_startup_gcode(uint16_t address);
-void settings_save_startup_gcode(uint16_t address);
+void settings_save_startup_gcode(uint16_t address, unsigned char *line);
 
 #endif
@@ -99,7 +99,7 @@ typedef union {
 #define fast_flt_mul4(x) ((x)*4.0f)
 #define fast_flt_sqrt(x) (sqrtf(x))
 #define fast_flt_invsqrt(x) (1.0f / sqrtf(x))
-#define fast_flt_pow2(x) (x * x)
+#define fast_flt_pow2(x) ((x) * (x))
 #ifndef fast_int_mul10
 #define fast_int_mul10(x) (x * 10)
 #endif